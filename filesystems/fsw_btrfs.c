@@ -116,7 +116,11 @@ struct btrfs_header
 {
     btrfs_checksum_t checksum;
     btrfs_uuid_t uuid;
-    uint8_t dummy[0x30];
+    uint64_t bytenr;
+    uint64_t flags;
+    btrfs_uuid_t chunk_tree_uuid;
+    uint64_t generation;
+    uint64_t owner;
     uint32_t nitems;
     uint8_t level;
 } __attribute__ ((__packed__));
@@ -136,6 +140,15 @@ struct fsw_btrfs_recover_cache
     BOOLEAN valid;
 };
 
+#define NODE_CACHE_SIZE 32
+struct fsw_btrfs_node_cache
+{
+    uint64_t addr;      /* logical address of the node, valid if node != NULL */
+    uint64_t generation;
+    uint32_t stamp;     /* value of node_stamp at the last use */
+    struct btrfs_header *node;
+};
+
 struct fsw_btrfs_volume
 {
     struct fsw_volume g;            //!< Generic volume structure
@@ -151,6 +164,7 @@ struct fsw_btrfs_volume
     unsigned num_devices;
     unsigned sectorshift;
     unsigned sectorsize;
+    unsigned nodesize;
     int is_master;
     int rescan_once;
 
@@ -166,6 +180,10 @@ struct fsw_btrfs_volume
     uint32_t extsize;
     struct btrfs_extent_data *extent;
     struct fsw_btrfs_recover_cache *rcache;
+
+    /* Cached tree nodes.  */
+    struct fsw_btrfs_node_cache *ncache;
+    uint32_t node_stamp;
 };
 
 enum
@@ -224,7 +242,7 @@ struct btrfs_internal_node
 {
     struct btrfs_key key;
     uint64_t addr;
-    uint64_t dummy;
+    uint64_t generation;
 } __attribute__ ((__packed__));
 
 struct btrfs_dir_item
@@ -380,6 +398,7 @@ static fsw_status_t btrfs_set_superblock_info(struct fsw_btrfs_volume *vol, stru
 
     vol->sectorshift = 0;
     vol->sectorsize = fsw_u32_le_swap(sb->sectorsize);
+    vol->nodesize = fsw_u32_le_swap(sb->nodesize);
     for(i=9; i<20; i++) {
         if((1UL<<i) == vol->sectorsize) {
             vol->sectorshift = i;
@@ -473,6 +492,98 @@ static int key_cmp (const struct btrfs_key *a, const struct btrfs_key *b)
     return 0;
 }
 
+/*
+ * Get a tree node from the per-volume node cache, reading it if necessary.
+ * Nodes are looked up by their logical address. If generation is not zero, it
+ * is the generation recorded in the parent's pointer, and a cached node with a
+ * different generation is read again. The nodes read are checked against both,
+ * and their item array must fit the node. The returned node stays valid until
+ * the next call.
+ *
+ * When the cache is full, the least recently used node is replaced, but each
+ * tree level above the leaves counts as NODE_CACHE_SIZE more recent uses, so
+ * the upper levels of the trees stay resident while walking through leaves.
+ */
+static fsw_status_t fsw_btrfs_get_node (struct fsw_btrfs_volume *vol,
+        uint64_t addr, uint64_t generation,
+        int rdepth, int cache_level,
+        struct btrfs_header **node_out)
+{
+    struct fsw_btrfs_node_cache *nc, *victim;
+    struct btrfs_header *node;
+    fsw_s64 age, victim_age;
+    uint64_t item_size;
+    fsw_status_t err;
+    unsigned i;
+
+    if(vol->ncache == NULL) {
+        err = fsw_alloc_zero(sizeof(struct fsw_btrfs_node_cache) * NODE_CACHE_SIZE, (void **)&vol->ncache);
+        if (err)
+            return err;
+    }
+    vol->node_stamp++;
+
+    for (i = 0; i < NODE_CACHE_SIZE; i++)
+    {
+        nc = &vol->ncache[i];
+        if (nc->node && nc->addr == addr
+                && (generation == 0 || nc->generation == generation))
+        {
+            nc->stamp = vol->node_stamp;
+            *node_out = nc->node;
+            return FSW_SUCCESS;
+        }
+    }
+
+    err = fsw_alloc(vol->nodesize, (void **)&node);
+    if (err)
+        return err;
+    err = fsw_btrfs_read_logical (vol, addr, node, vol->nodesize, rdepth, cache_level);
+    if (err)
+    {
+        FreePool (node);
+        return err;
+    }
+    item_size = node->level ? sizeof (struct btrfs_internal_node) : sizeof (struct btrfs_leaf_node);
+    if (fsw_u64_le_swap (node->bytenr) != addr
+            || (generation != 0 && fsw_u64_le_swap (node->generation) != generation)
+            || sizeof (struct btrfs_header) + fsw_u32_le_swap (node->nitems) * item_size > vol->nodesize)
+    {
+        DPRINT (L"btrfs: bad tree node at %lx\n", addr);
+        FreePool (node);
+        return FSW_VOLUME_CORRUPTED;
+    }
+
+    /* choose the slot only now, reading the node may have used the cache */
+    victim = NULL;
+    victim_age = 0;
+    for (i = 0; i < NODE_CACHE_SIZE; i++)
+    {
+        nc = &vol->ncache[i];
+        if (nc->node == NULL || nc->addr == addr)
+        {
+            victim = nc;
+            break;
+        }
+        age = (fsw_s64)(uint32_t)(vol->node_stamp - nc->stamp)
+            - (fsw_s64)nc->node->level * NODE_CACHE_SIZE;
+        if (victim == NULL || age > victim_age)
+        {
+            victim = nc;
+            victim_age = age;
+        }
+    }
+    if (victim->node)
+        FreePool (victim->node);
+    victim->addr = addr;
+    victim->generation = fsw_u64_le_swap (node->generation);
+    victim->stamp = vol->node_stamp;
+    victim->node = node;
+
+    *node_out = node;
+    return FSW_SUCCESS;
+}
+
 static void free_iterator (struct fsw_btrfs_leaf_descriptor *desc)
 {
     fsw_free (desc->data);
@@ -507,7 +618,8 @@ static int next (struct fsw_btrfs_volume *vol,
         struct btrfs_key *key_out)
 {
     fsw_status_t err;
-    struct btrfs_leaf_node leaf;
+    struct btrfs_header *head;
+    struct btrfs_leaf_node *leaf;
 
     for (; desc->depth > 0; desc->depth--)
     {
@@ -520,37 +632,35 @@ static int next (struct fsw_btrfs_volume *vol,
         return 0;
     while (!desc->data[desc->depth - 1].leaf)
     {
-        struct btrfs_internal_node node;
-        struct btrfs_header head;
-        fsw_memzero(&node, sizeof(node));
-
-        err = fsw_btrfs_read_logical (vol, desc->data[desc->depth - 1].iter
-                * sizeof (node)
-                + sizeof (struct btrfs_header)
-                + desc->data[desc->depth - 1].addr,
-                &node, sizeof (node), 0, 1);
+        struct btrfs_internal_node *node;
+        uint64_t addr, generation;
+
+        err = fsw_btrfs_get_node (vol, desc->data[desc->depth - 1].addr, 0,
+                0, 1, &head);
         if (err)
             return -err;
+        node = (struct btrfs_internal_node *) (head + 1)
+            + desc->data[desc->depth - 1].iter;
+        addr = fsw_u64_le_swap (node->addr);
+        generation = fsw_u64_le_swap (node->generation);
 
-        err = fsw_btrfs_read_logical (vol, fsw_u64_le_swap (node.addr),
-                &head, sizeof (head), 0, 1);
+        err = fsw_btrfs_get_node (vol, addr, generation, 0, 1, &head);
         if (err)
             return -err;
 
-        save_ref (desc, fsw_u64_le_swap (node.addr), 0,
-                fsw_u32_le_swap (head.nitems), !head.level);
+        save_ref (desc, addr, 0,
+                fsw_u32_le_swap (head->nitems), !head->level);
     }
-    err = fsw_btrfs_read_logical (vol, desc->data[desc->depth - 1].iter
-            * sizeof (leaf)
-            + sizeof (struct btrfs_header)
-            + desc->data[desc->depth - 1].addr, &leaf,
-            sizeof (leaf), 0, 1);
+    err = fsw_btrfs_get_node (vol, desc->data[desc->depth - 1].addr, 0,
+            0, 1, &head);
     if (err)
         return -err;
-    *outsize = fsw_u32_le_swap (leaf.size);
+    leaf = (struct btrfs_leaf_node *) (head + 1)
+        + desc->data[desc->depth - 1].iter;
+    *outsize = fsw_u32_le_swap (leaf->size);
     *outaddr = desc->data[desc->depth - 1].addr + sizeof (struct btrfs_header)
-        + fsw_u32_le_swap (leaf.offset);
-    *key_out = leaf.key;
+        + fsw_u32_le_swap (leaf->offset);
+    *key_out = leaf->key;
     return 1;
 }
 
@@ -564,6 +674,7 @@ static fsw_status_t lower_bound (struct fsw_btrfs_volume *vol,
         int rdepth)
 {
     uint64_t addr = fsw_u64_le_swap (root);
+    uint64_t generation = 0;
     int depth = -1;
 
     if (desc)
@@ -586,117 +697,107 @@ static fsw_status_t lower_bound (struct fsw_btrfs_volume *vol,
     while (1)
     {
         fsw_status_t err;
-        struct btrfs_header head;
-        fsw_memzero(&head, sizeof(head));
+        struct btrfs_header *head;
 
 reiter:
         depth++;
-        /* FIXME: preread few nodes into buffer. */
-        err = fsw_btrfs_read_logical (vol, addr, &head, sizeof (head),
-                rdepth + 1, depth2cache(rdepth));
+        err = fsw_btrfs_get_node (vol, addr, generation,
+                rdepth + 1, depth2cache(rdepth), &head);
         if (err)
             return err;
-        addr += sizeof (head);
-        if (head.level)
+        if (head->level)
         {
             unsigned i;
-            struct btrfs_internal_node node, node_last;
-            int have_last = 0;
-            fsw_memzero (&node_last, sizeof (node_last));
-            for (i = 0; i < fsw_u32_le_swap (head.nitems); i++)
+            struct btrfs_internal_node *node, *node_last = NULL;
+            for (i = 0; i < fsw_u32_le_swap (head->nitems); i++)
             {
-                err = fsw_btrfs_read_logical (vol, addr + i * sizeof (node),
-                        &node, sizeof (node), rdepth + 1, depth2cache(rdepth));
-                if (err)
-                    return err;
+                node = (struct btrfs_internal_node *) (head + 1) + i;
 
                 DPRINT (L"btrfs: internal node (depth %d) %lx %x %lx\n", depth,
-                        node.key.object_id, node.key.type,
-                        node.key.offset);
+                        node->key.object_id, node->key.type,
+                        node->key.offset);
 
-                if (key_cmp (&node.key, key_in) == 0)
+                if (key_cmp (&node->key, key_in) == 0)
                 {
                     err = FSW_SUCCESS;
                     if (desc)
-                        err = save_ref (desc, addr - sizeof (head), i,
-                                fsw_u32_le_swap (head.nitems), 0);
+                        err = save_ref (desc, addr, i,
+                                fsw_u32_le_swap (head->nitems), 0);
                     if (err)
                         return err;
-                    addr = fsw_u64_le_swap (node.addr);
+                    addr = fsw_u64_le_swap (node->addr);
+                    generation = fsw_u64_le_swap (node->generation);
                     goto reiter;
                 }
-                if (key_cmp (&node.key, key_in) > 0)
+                if (key_cmp (&node->key, key_in) > 0)
                     break;
                 node_last = node;
-                have_last = 1;
             }
-            if (have_last)
+            if (node_last)
             {
                 err = FSW_SUCCESS;
                 if (desc)
-                    err = save_ref (desc, addr - sizeof (head), i - 1,
-                            fsw_u32_le_swap (head.nitems), 0);
+                    err = save_ref (desc, addr, i - 1,
+                            fsw_u32_le_swap (head->nitems), 0);
                 if (err)
                     return err;
-                addr = fsw_u64_le_swap (node_last.addr);
+                addr = fsw_u64_le_swap (node_last->addr);
+                generation = fsw_u64_le_swap (node_last->generation);
                 goto reiter;
             }
             *outsize = 0;
             *outaddr = 0;
             fsw_memzero (key_out, sizeof (*key_out));
             if (desc)
-                return save_ref (desc, addr - sizeof (head), -1,
-                        fsw_u32_le_swap (head.nitems), 0);
+                return save_ref (desc, addr, -1,
+                        fsw_u32_le_swap (head->nitems), 0);
             return FSW_SUCCESS;
         }
         {
             unsigned i;
-            struct btrfs_leaf_node leaf, leaf_last;
-            int have_last = 0;
-            for (i = 0; i < fsw_u32_le_swap (head.nitems); i++)
+            struct btrfs_leaf_node *leaf, *leaf_last = NULL;
+            for (i = 0; i < fsw_u32_le_swap (head->nitems); i++)
             {
-                err = fsw_btrfs_read_logical (vol, addr + i * sizeof (leaf),
-                        &leaf, sizeof (leaf), rdepth + 1, depth2cache(rdepth));
-                if (err)
-                    return err;
+                leaf = (struct btrfs_leaf_node *) (head + 1) + i;
 
                 DPRINT (L"btrfs: leaf (depth %d) %lx %x %lx\n", depth,
-                        leaf.key.object_id, leaf.key.type, leaf.key.offset);
+                        leaf->key.object_id, leaf->key.type, leaf->key.offset);
 
-                if (key_cmp (&leaf.key, key_in) == 0)
+                if (key_cmp (&leaf->key, key_in) == 0)
                 {
-                    fsw_memcpy (key_out, &leaf.key, sizeof (*key_out));
-                    *outsize = fsw_u32_le_swap (leaf.size);
-                    *outaddr = addr + fsw_u32_le_swap (leaf.offset);
+                    fsw_memcpy (key_out, &leaf->key, sizeof (*key_out));
+                    *outsize = fsw_u32_le_swap (leaf->size);
+                    *outaddr = addr + sizeof (struct btrfs_header)
+                        + fsw_u32_le_swap (leaf->offset);
                     if (desc)
-                        return save_ref (desc, addr - sizeof (head), i,
-                                fsw_u32_le_swap (head.nitems), 1);
+                        return save_ref (desc, addr, i,
+                                fsw_u32_le_swap (head->nitems), 1);
                     return FSW_SUCCESS;
                 }
 
-                if (key_cmp (&leaf.key, key_in) > 0)
+                if (key_cmp (&leaf->key, key_in) > 0)
                     break;
 
-                have_last = 1;
                 leaf_last = leaf;
             }
 
-            if (have_last)
+            if (leaf_last)
             {
-                fsw_memcpy (key_out, &leaf_last.key, sizeof (*key_out));
-                *outsize = fsw_u32_le_swap (leaf_last.size);
-                *outaddr = addr + fsw_u32_le_swap (leaf_last.offset);
+                fsw_memcpy (key_out, &leaf_last->key, sizeof (*key_out));
+                *outsize = fsw_u32_le_swap (leaf_last->size);
+                *outaddr = addr + sizeof (struct btrfs_header)
+                    + fsw_u32_le_swap (leaf_last->offset);
                 if (desc)
-                    return save_ref (desc, addr - sizeof (head), i - 1,
-                            fsw_u32_le_swap (head.nitems), 1);
+                    return save_ref (desc, addr, i - 1,
+                            fsw_u32_le_swap (head->nitems), 1);
                 return FSW_SUCCESS;
             }
             *outsize = 0;
             *outaddr = 0;
             fsw_memzero (key_out, sizeof (*key_out));
             if (desc)
-                return save_ref (desc, addr - sizeof (head), -1,
-                        fsw_u32_le_swap (head.nitems), 1);
+                return save_ref (desc, addr, -1,
+                        fsw_u32_le_swap (head->nitems), 1);
             return FSW_SUCCESS;
         }
     }
@@ -1306,6 +1407,9 @@ static fsw_status_t fsw_btrfs_volume_mount(struct fsw_volume *volg) {
     if(vol->sectorshift == 0)
         return FSW_UNSUPPORTED;
 
+    if(vol->nodesize < vol->sectorsize || vol->nodesize > 0x10000 || (vol->nodesize & (vol->nodesize - 1)))
+        return FSW_UNSUPPORTED;
+
     if(vol->num_devices >= BTRFS_MAX_NUM_DEVICES)
         return FSW_UNSUPPORTED;
 
@@ -1388,6 +1492,12 @@ static void fsw_btrfs_volume_free(struct fsw_volume *volg)
 		FreePool(vol->rcache->buffer);
         FreePool (vol->rcache);
     }
+    if(vol->ncache) {
+        for(i = 0; i < NODE_CACHE_SIZE; i++)
+            if(vol->ncache[i].node)
+                FreePool(vol->ncache[i].node);
+        FreePool (vol->ncache);
+    }
 }
 
 static fsw_status_t fsw_btrfs_volume_stat(struct fsw_volume *volg, struct fsw_volume_stat *sb)
@@ -1975,6 +2085,7 @@ static fsw_status_t fsw_btrfs_dir_lookup(struct fsw_volume *volg, struct fsw_dno
     struct fsw_btrfs_dnode *dno = (struct fsw_btrfs_dnode *)dnog;
     fsw_status_t err;
     struct fsw_string s;
+    struct fsw_arena_mark mark;
 
     *child_dno_out = NULL;
 
@@ -1982,14 +2093,16 @@ static fsw_status_t fsw_btrfs_dir_lookup(struct fsw_volume *volg, struct fsw_dno
     if (!vol->is_master)
         return FSW_NOT_FOUND;
 
-    err = fsw_strdup_coerce(&s, FSW_STRING_TYPE_UTF8, lookup_name);
+    /* the converted name is only needed during the lookup */
+    fsw_arena_mark(&volg->arena, &mark);
+    err = fsw_strdup_coerce_arena(&volg->arena, &s, FSW_STRING_TYPE_UTF8, lookup_name);
     if(err)
         return err;
 
     /* treat '...' under root as top root */
     if(dnog == volg->root && s.size == 3 && ((char *)s.data)[0]=='.' && ((char *)s.data)[1]=='.' && ((char *)s.data)[2]=='.')
     {
-        fsw_strfree (&s);
+        fsw_arena_release(&volg->arena, &mark);
         if(dnog->tree_id == vol->top_tree) {
             fsw_dnode_retain(dnog);
             *child_dno_out = dnog;
@@ -2005,7 +2118,7 @@ static fsw_status_t fsw_btrfs_dir_lookup(struct fsw_volume *volg, struct fsw_dno
         err = fsw_btrfs_get_sub_dnode(vol, dno, cdirel, lookup_name, child_dno_out);
     if(direl)
         FreePool (direl);
-    fsw_strfree (&s);
+    fsw_arena_release(&volg->arena, &mark);
     return err;
 }
 
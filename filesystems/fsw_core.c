@@ -38,14 +38,36 @@
  */
 
 #include "fsw_core.h"
-#include "fsw_efi.h"
 
 
 // functions
 
 static void fsw_blockcache_free(struct fsw_volume *vol);
-
-#define MAX_CACHE_LEVEL (5)
+static fsw_u32 fsw_blockcache_find(struct fsw_volume *vol, fsw_u64 phys_bno);
+static void fsw_blockcache_hash_insert(struct fsw_volume *vol, fsw_u32 i);
+static void fsw_blockcache_unhash(struct fsw_volume *vol, fsw_u32 i);
+static void fsw_blockcache_rehash(struct fsw_volume *vol);
+static void fsw_blockcache_reset(struct fsw_volume *vol);
+static fsw_status_t fsw_blockcache_get_entry(struct fsw_volume *vol, fsw_u32 *index_out);
+static fsw_status_t fsw_blockcache_grow(struct fsw_volume *vol);
+static void fsw_blockcache_lru_unlink(struct fsw_volume *vol, fsw_u32 i);
+static void fsw_blockcache_lru_append(struct fsw_volume *vol, fsw_u32 i);
+static fsw_u32 fsw_dnode_hash(struct fsw_volume *vol, fsw_u64 tree_id, fsw_u64 dnode_id);
+static void fsw_dnode_hash_resize(struct fsw_volume *vol, fsw_u32 new_size);
+static fsw_status_t fsw_dnode_lookup_cached(struct fsw_dnode *dno,
+                                            struct fsw_string *lookup_name, struct fsw_dnode **child_dno_out);
+static void fsw_dcache_remove(struct fsw_volume *vol, struct fsw_dentry *dent);
+static void fsw_dcache_flush(struct fsw_volume *vol);
+static int fsw_dnode_find_extent(struct fsw_dnode *dno, fsw_u64 log_bno, struct fsw_extent *extent);
+static fsw_status_t fsw_shandle_readahead(struct fsw_shandle *shand, fsw_u64 phys_bno, fsw_u32 count,
+                                          fsw_u64 avail);
+static fsw_status_t fsw_shandle_read_locked(struct fsw_shandle *shand, fsw_u32 *buffer_size_inout, void *buffer_in);
+
+/** Marks the end of a block cache hash chain. */
+#define FSW_BCACHE_NONE (0xFFFFFFFF)
+
+/** Initial number of chains in the dnode hash table. */
+#define FSW_DNODE_HASH_MIN (64)
 
 /**
  * Mount a volume with a given file system driver. This function is called by the
@@ -82,6 +104,11 @@ fsw_status_t fsw_mount(void *host_data,
     vol->host_table     = host_table;
     vol->fstype_table   = fstype_table;
     vol->host_string_type = host_table->native_string_type;
+    vol->bcache_budget  = FSW_BCACHE_BUDGET;
+    FSW_LOCK_INIT(&vol->lock);
+    fsw_blockcache_reset(vol);
+    fsw_slab_init(&vol->dnode_slab, fstype_table->dnode_struct_size, FSW_SLAB_CHUNK_OBJECTS);
+    fsw_slab_init(&vol->dentry_slab, sizeof(struct fsw_dentry), FSW_SLAB_CHUNK_OBJECTS);
 
     // let the fs driver mount the file system
     status = vol->fstype_table->volume_mount(vol);
@@ -108,14 +135,23 @@ errorexit:
 
 void fsw_unmount(struct fsw_volume *vol)
 {
+    // the lookup cache holds references to dnodes
+    fsw_dcache_flush(vol);
+
     if (vol->root)
         fsw_dnode_release(vol->root);
     // TODO: check that no other dnodes are still around
 
     vol->fstype_table->volume_free(vol);
 
+    if (vol->dnode_hash != NULL)
+        fsw_free(vol->dnode_hash);
+    fsw_slab_destroy(&vol->dnode_slab);
+    fsw_slab_destroy(&vol->dentry_slab);
+    fsw_arena_destroy(&vol->arena);
     fsw_blockcache_free(vol);
     fsw_strfree(&vol->label);
+    FSW_LOCK_DESTROY(&vol->lock);
     fsw_free(vol);
 }
 
@@ -126,7 +162,36 @@ void fsw_unmount(struct fsw_volume *vol)
 
 fsw_status_t fsw_volume_stat(struct fsw_volume *vol, struct fsw_volume_stat *sb)
 {
-    return vol->fstype_table->volume_stat(vol, sb);
+    fsw_status_t    status;
+
+    FSW_VOLUME_LOCK(vol);
+    status = vol->fstype_table->volume_stat(vol, sb);
+    FSW_VOLUME_UNLOCK(vol);
+    return status;
+}
+
+/**
+ * Get the I/O and cache statistics of a volume. This function can be called by the
+ * host driver to find out where time goes when accessing the volume. The counters
+ * run from the time the volume was mounted or last reset.
+ */
+
+void fsw_volume_get_io_stats(struct fsw_volume *vol, struct fsw_io_stats *stats)
+{
+    FSW_VOLUME_LOCK(vol);
+    *stats = vol->io_stats;
+    FSW_VOLUME_UNLOCK(vol);
+}
+
+/**
+ * Reset the I/O and cache statistics of a volume to zero.
+ */
+
+void fsw_volume_reset_io_stats(struct fsw_volume *vol)
+{
+    FSW_VOLUME_LOCK(vol);
+    fsw_memzero(&vol->io_stats, sizeof(struct fsw_io_stats));
+    FSW_VOLUME_UNLOCK(vol);
 }
 
 /**
@@ -174,109 +239,399 @@ void fsw_set_blocksize(struct fsw_volume *vol, fsw_u32 phys_blocksize, fsw_u32 l
  *  - 2: File system metadata
  *  - 3..5: File system metadata with a high rate of access
  *
+ * The cache grows until it reaches vol->bcache_budget bytes. After that, the least
+ * recently released block of the lowest level that has unreferenced blocks is replaced,
+ * so streaming file data never pushes out metadata.
+ *
+ * Blocks that are not in the cache are first offered to the host's borrow_block
+ * function, if it has one. A host that already holds the block in memory, such as a
+ * mapped image or a disk cache, lends a pointer to its copy and the block is neither
+ * copied nor entered into the cache.
+ *
  * If this function returns successfully, the returned data pointer is valid until the
  * caller calls fsw_block_release.
+ *
+ * Like the other block functions, this one expects the volume lock to be held, which
+ * is the case for all file system driver code called through the core.
  */
 
 fsw_status_t fsw_block_get(struct VOLSTRUCTNAME *vol, fsw_u64 phys_bno, fsw_u32 cache_level, void **buffer_out)
 {
     fsw_status_t    status;
-    fsw_u32         i, discard_level, new_bcache_size;
-    struct fsw_blockcache *new_bcache;
-
-    // TODO: allow the host driver to do its own caching; just call through if
-    //  the appropriate function pointers are set
+    fsw_u32         i;
 
     if (cache_level > MAX_CACHE_LEVEL)
         cache_level = MAX_CACHE_LEVEL;
 
     // check block cache
-    for (i = 0; i < vol->bcache_size; i++) {
-        if (vol->bcache[i].phys_bno == phys_bno) {
-            // cache hit!
-            if (vol->bcache[i].cache_level < cache_level)
-                vol->bcache[i].cache_level = cache_level;  // promote the entry
-            vol->bcache[i].refcount++;
-            *buffer_out = vol->bcache[i].data;
-            return FSW_SUCCESS;
-        }
+    i = fsw_blockcache_find(vol, phys_bno);
+    if (i != FSW_BCACHE_NONE) {
+        // cache hit!
+        vol->io_stats.bcache_hits[cache_level]++;
+        if (vol->bcache[i].refcount == 0)
+            fsw_blockcache_lru_unlink(vol, i);
+        if (vol->bcache[i].cache_level < cache_level)
+            vol->bcache[i].cache_level = cache_level;  // promote the entry
+        vol->bcache[i].refcount++;
+        *buffer_out = vol->bcache[i].data;
+        return FSW_SUCCESS;
     }
 
-    // find a free entry in the cache table
-    for (i = 0; i < vol->bcache_size; i++) {
-        if (vol->bcache[i].phys_bno == (fsw_u64)FSW_INVALID_BNO)
-            break;
-    }
-    if (i >= vol->bcache_size) {
-        for (discard_level = 0; discard_level <= MAX_CACHE_LEVEL; discard_level++) {
-            for (i = 0; i < vol->bcache_size; i++) {
-                if (vol->bcache[i].refcount == 0 && vol->bcache[i].cache_level <= discard_level)
-                    break;
-            }
-            if (i < vol->bcache_size)
-                break;
-        }
+    // let the host lend its own copy
+    vol->io_stats.bcache_misses[cache_level]++;
+    if (vol->host_table->borrow_block != NULL &&
+        vol->host_table->borrow_block(vol, phys_bno, buffer_out) == FSW_SUCCESS) {
+        vol->io_stats.bcache_borrowed++;
+        return FSW_SUCCESS;
     }
-    if (i >= vol->bcache_size) {
-        // enlarge / create the cache
-        if (vol->bcache_size < 16)
-            new_bcache_size = 16;
-        else
-            new_bcache_size = vol->bcache_size << 1;
-        status = fsw_alloc(new_bcache_size * sizeof(struct fsw_blockcache), &new_bcache);
-        if (status)
-            return status;
-        if (vol->bcache_size > 0)
-            fsw_memcpy(new_bcache, vol->bcache, vol->bcache_size * sizeof(struct fsw_blockcache));
-        for (i = vol->bcache_size; i < new_bcache_size; i++) {
-            new_bcache[i].refcount = 0;
-            new_bcache[i].cache_level = 0;
-            new_bcache[i].phys_bno = (fsw_u64)FSW_INVALID_BNO;
-            new_bcache[i].data = NULL;
-        }
-        i = vol->bcache_size;
 
-        // switch caches
-        if (vol->bcache != NULL)
-            fsw_free(vol->bcache);
-        vol->bcache = new_bcache;
-        vol->bcache_size = new_bcache_size;
-    }
-    vol->bcache[i].phys_bno = (fsw_u64)FSW_INVALID_BNO;
+    // get an empty or replaceable entry
+    status = fsw_blockcache_get_entry(vol, &i);
+    if (status)
+        return status;
 
     // read the data
     if (vol->bcache[i].data == NULL) {
         status = fsw_alloc(vol->phys_blocksize, &vol->bcache[i].data);
         if (status)
-            return status;
+            goto errorexit;
     }
+    vol->io_stats.read_block_calls++;
+    vol->io_stats.read_block_bytes += vol->phys_blocksize;
     status = vol->host_table->read_block(vol, phys_bno, vol->bcache[i].data);
     if (status)
-        return status;
+        goto errorexit;
 
     vol->bcache[i].phys_bno = phys_bno;
     vol->bcache[i].cache_level = cache_level;
     vol->bcache[i].refcount = 1;
+    fsw_blockcache_hash_insert(vol, i);
     *buffer_out = vol->bcache[i].data;
     return FSW_SUCCESS;
+
+errorexit:
+    // give the entry back to the free list
+    vol->bcache[i].lru_next = vol->bcache_free;
+    vol->bcache_free = i;
+    return status;
 }
 
 /**
  * Releases a disk block. This function must be called to release disk blocks returned
- * from fsw_block_get.
+ * from fsw_block_get, passing the same buffer pointer. Pointers that are not the data
+ * of the cache entry for the block were borrowed from the host and are returned to it.
  */
 
 void fsw_block_release(struct VOLSTRUCTNAME *vol, fsw_u64 phys_bno, void *buffer)
 {
     fsw_u32 i;
 
-    // TODO: allow the host driver to do its own caching; just call through if
-    //  the appropriate function pointers are set
-
     // update block cache
-    for (i = 0; i < vol->bcache_size; i++) {
-        if (vol->bcache[i].phys_bno == phys_bno && vol->bcache[i].refcount > 0)
+    i = fsw_blockcache_find(vol, phys_bno);
+    if (i != FSW_BCACHE_NONE && vol->bcache[i].data == buffer) {
+        if (vol->bcache[i].refcount > 0) {
             vol->bcache[i].refcount--;
+            if (vol->bcache[i].refcount == 0)
+                fsw_blockcache_lru_append(vol, i);
+        }
+    } else if (vol->host_table->return_block != NULL) {
+        vol->host_table->return_block(vol, phys_bno, buffer);
+    }
+}
+
+/**
+ * Read a run of consecutive disk blocks directly into a caller-provided buffer,
+ * bypassing the block cache. This is meant for bulk file data that would only
+ * displace more useful blocks from the cache. The buffer must be large enough
+ * for count physical blocks.
+ *
+ * If the host provides a read_blocks function, the whole run is read in a single
+ * request. Otherwise, the blocks are read one by one through read_block. The volume
+ * lock is dropped during the transfer, which only touches the caller's buffer, so
+ * other threads can work on the volume meanwhile.
+ */
+
+fsw_status_t fsw_block_read_direct(struct VOLSTRUCTNAME *vol, fsw_u64 phys_bno, fsw_u32 count, void *buffer)
+{
+    fsw_status_t    status;
+    fsw_u8          *p = buffer;
+
+    if (count == 0)
+        return FSW_SUCCESS;
+    vol->io_stats.read_block_bytes += (fsw_u64)count * vol->phys_blocksize;
+    if (vol->host_table->read_blocks != NULL) {
+        vol->io_stats.read_block_calls++;
+        FSW_VOLUME_UNLOCK(vol);
+        status = vol->host_table->read_blocks(vol, phys_bno, count, buffer);
+        FSW_VOLUME_LOCK(vol);
+        return status;
+    }
+
+    vol->io_stats.read_block_calls += count;
+    status = FSW_SUCCESS;
+    FSW_VOLUME_UNLOCK(vol);
+    for (; count > 0 && status == FSW_SUCCESS; count--, phys_bno++, p += vol->phys_blocksize)
+        status = vol->host_table->read_block(vol, phys_bno, p);
+    FSW_VOLUME_LOCK(vol);
+    return status;
+}
+
+/**
+ * Start reading count consecutive physical blocks into a caller-supplied buffer
+ * without waiting for the data. Every successful call must be paired with a call
+ * to fsw_block_read_wait with the returned token before the buffer is used or
+ * freed. If the host has no read_blocks_async function, the read is done right
+ * here and the token is NULL.
+ */
+
+fsw_status_t fsw_block_read_async(struct VOLSTRUCTNAME *vol, fsw_u64 phys_bno, fsw_u32 count, void *buffer,
+                                  void **token_out)
+{
+    *token_out = NULL;
+    if (vol->host_table->read_blocks_async == NULL || count == 0)
+        return fsw_block_read_direct(vol, phys_bno, count, buffer);
+
+    vol->io_stats.read_block_calls++;
+    vol->io_stats.read_block_bytes += (fsw_u64)count * vol->phys_blocksize;
+    vol->io_stats.async_read_calls++;
+    return vol->host_table->read_blocks_async(vol, phys_bno, count, buffer, token_out);
+}
+
+/**
+ * Wait for a read started by fsw_block_read_async to complete and return its status.
+ * Like fsw_block_read_direct, this drops the volume lock while waiting.
+ */
+
+fsw_status_t fsw_block_read_wait(struct VOLSTRUCTNAME *vol, void *token)
+{
+    fsw_status_t    status;
+    fsw_u64         ticks;
+
+    if (token == NULL)
+        return FSW_SUCCESS;
+    ticks = FSW_GET_TICKS();
+    FSW_VOLUME_UNLOCK(vol);
+    status = vol->host_table->read_wait(vol, token);
+    FSW_VOLUME_LOCK(vol);
+    vol->io_stats.async_wait_ticks += FSW_GET_TICKS() - ticks;
+    return status;
+}
+
+/**
+ * Find a block cache entry to hold a new block. Unused entries are taken first.
+ * The cache is enlarged while it stays within the volume's budget; beyond that,
+ * the least recently used unreferenced entry of the lowest possible cache level
+ * is replaced. If every entry is referenced, the cache must grow regardless of
+ * the budget. The entry returned is unhashed and marked as empty.
+ */
+
+static fsw_status_t fsw_blockcache_get_entry(struct fsw_volume *vol, fsw_u32 *index_out)
+{
+    fsw_status_t    status;
+    fsw_u32         i, level;
+
+    if (vol->bcache_free == FSW_BCACHE_NONE &&
+        (vol->bcache_size < 16 ||
+         (fsw_u64)(vol->bcache_size << 1) * vol->phys_blocksize <= vol->bcache_budget)) {
+        status = fsw_blockcache_grow(vol);
+        if (status)
+            return status;
+    }
+
+    if (vol->bcache_free == FSW_BCACHE_NONE) {
+        // replace the oldest entry of the least important level
+        for (level = 0; level <= MAX_CACHE_LEVEL; level++) {
+            i = vol->bcache_lru_head[level];
+            if (i != FSW_BCACHE_NONE) {
+                fsw_blockcache_lru_unlink(vol, i);
+                fsw_blockcache_unhash(vol, i);
+                vol->bcache[i].phys_bno = (fsw_u64)FSW_INVALID_BNO;
+                vol->io_stats.bcache_evictions++;
+                *index_out = i;
+                return FSW_SUCCESS;
+            }
+        }
+
+        // all entries are in use
+        status = fsw_blockcache_grow(vol);
+        if (status)
+            return status;
+    }
+
+    i = vol->bcache_free;
+    vol->bcache_free = vol->bcache[i].lru_next;
+    *index_out = i;
+    return FSW_SUCCESS;
+}
+
+/**
+ * Double the size of the block cache array. The new entries are put on the
+ * free list.
+ */
+
+static fsw_status_t fsw_blockcache_grow(struct fsw_volume *vol)
+{
+    fsw_status_t    status;
+    fsw_u32         i, new_bcache_size;
+    struct fsw_blockcache *new_bcache;
+    fsw_u32         *new_bcache_hash;
+
+    if (vol->bcache_size < 16)
+        new_bcache_size = 16;
+    else
+        new_bcache_size = vol->bcache_size << 1;
+    status = fsw_alloc(new_bcache_size * sizeof(struct fsw_blockcache), &new_bcache);
+    if (status)
+        return status;
+    status = fsw_alloc(new_bcache_size * sizeof(fsw_u32), &new_bcache_hash);
+    if (status) {
+        fsw_free(new_bcache);
+        return status;
+    }
+    if (vol->bcache_size > 0)
+        fsw_memcpy(new_bcache, vol->bcache, vol->bcache_size * sizeof(struct fsw_blockcache));
+    for (i = new_bcache_size; i > vol->bcache_size; i--) {
+        new_bcache[i - 1].refcount = 0;
+        new_bcache[i - 1].cache_level = 0;
+        new_bcache[i - 1].phys_bno = (fsw_u64)FSW_INVALID_BNO;
+        new_bcache[i - 1].data = NULL;
+        new_bcache[i - 1].lru_prev = FSW_BCACHE_NONE;
+        new_bcache[i - 1].lru_next = vol->bcache_free;
+        vol->bcache_free = i - 1;
+    }
+
+    // switch caches
+    if (vol->bcache != NULL)
+        fsw_free(vol->bcache);
+    if (vol->bcache_hash != NULL)
+        fsw_free(vol->bcache_hash);
+    vol->bcache = new_bcache;
+    vol->bcache_hash = new_bcache_hash;
+    vol->bcache_size = new_bcache_size;
+
+    // the hash table size follows the cache size, so rebuild all chains
+    fsw_blockcache_rehash(vol);
+    return FSW_SUCCESS;
+}
+
+/**
+ * Remove an unreferenced entry from the LRU list of its cache level.
+ */
+
+static void fsw_blockcache_lru_unlink(struct fsw_volume *vol, fsw_u32 i)
+{
+    struct fsw_blockcache *e = &vol->bcache[i];
+
+    if (e->lru_prev != FSW_BCACHE_NONE)
+        vol->bcache[e->lru_prev].lru_next = e->lru_next;
+    else
+        vol->bcache_lru_head[e->cache_level] = e->lru_next;
+    if (e->lru_next != FSW_BCACHE_NONE)
+        vol->bcache[e->lru_next].lru_prev = e->lru_prev;
+    else
+        vol->bcache_lru_tail[e->cache_level] = e->lru_prev;
+    e->lru_prev = e->lru_next = FSW_BCACHE_NONE;
+}
+
+/**
+ * Add an entry that just became unreferenced as the newest member of the LRU
+ * list of its cache level.
+ */
+
+static void fsw_blockcache_lru_append(struct fsw_volume *vol, fsw_u32 i)
+{
+    struct fsw_blockcache *e = &vol->bcache[i];
+
+    e->lru_next = FSW_BCACHE_NONE;
+    e->lru_prev = vol->bcache_lru_tail[e->cache_level];
+    if (e->lru_prev != FSW_BCACHE_NONE)
+        vol->bcache[e->lru_prev].lru_next = i;
+    else
+        vol->bcache_lru_head[e->cache_level] = i;
+    vol->bcache_lru_tail[e->cache_level] = i;
+}
+
+/**
+ * Compute the hash chain for a physical block number. The hash table always has
+ * as many chains as there are cache entries, which is a power of two.
+ */
+
+static fsw_u32 fsw_blockcache_hash(struct fsw_volume *vol, fsw_u64 phys_bno)
+{
+    fsw_u32 h;
+
+    h = (fsw_u32)phys_bno ^ (fsw_u32)FSW_U64_SHR(phys_bno, 32);
+    h ^= h >> 16;
+    h *= 0x45d9f3b;
+    h ^= h >> 16;
+    return h & (vol->bcache_size - 1);
+}
+
+/**
+ * Look up a physical block number in the block cache. Returns the index of the
+ * entry holding the block, or FSW_BCACHE_NONE if the block is not cached.
+ */
+
+static fsw_u32 fsw_blockcache_find(struct fsw_volume *vol, fsw_u64 phys_bno)
+{
+    fsw_u32 i;
+
+    if (vol->bcache_size == 0)
+        return FSW_BCACHE_NONE;
+
+    for (i = vol->bcache_hash[fsw_blockcache_hash(vol, phys_bno)];
+         i != FSW_BCACHE_NONE; i = vol->bcache[i].hash_next) {
+        if (vol->bcache[i].phys_bno == phys_bno)
+            return i;
+    }
+    return FSW_BCACHE_NONE;
+}
+
+/**
+ * Link a block cache entry into the hash chain for its phys_bno.
+ */
+
+static void fsw_blockcache_hash_insert(struct fsw_volume *vol, fsw_u32 i)
+{
+    fsw_u32 h = fsw_blockcache_hash(vol, vol->bcache[i].phys_bno);
+
+    vol->bcache[i].hash_next = vol->bcache_hash[h];
+    vol->bcache_hash[h] = i;
+}
+
+/**
+ * Unlink a block cache entry from the hash chain for its phys_bno. Chains are
+ * short, so walking the singly-linked chain is cheap.
+ */
+
+static void fsw_blockcache_unhash(struct fsw_volume *vol, fsw_u32 i)
+{
+    fsw_u32 *link = &vol->bcache_hash[fsw_blockcache_hash(vol, vol->bcache[i].phys_bno)];
+
+    while (*link != FSW_BCACHE_NONE) {
+        if (*link == i) {
+            *link = vol->bcache[i].hash_next;
+            break;
+        }
+        link = &vol->bcache[*link].hash_next;
+    }
+    vol->bcache[i].hash_next = FSW_BCACHE_NONE;
+}
+
+/**
+ * Rebuild all hash chains from scratch. Called after the cache array was resized.
+ */
+
+static void fsw_blockcache_rehash(struct fsw_volume *vol)
+{
+    fsw_u32 i;
+
+    for (i = 0; i < vol->bcache_size; i++)
+        vol->bcache_hash[i] = FSW_BCACHE_NONE;
+    for (i = 0; i < vol->bcache_size; i++) {
+        vol->bcache[i].hash_next = FSW_BCACHE_NONE;
+        if (vol->bcache[i].phys_bno != (fsw_u64)FSW_INVALID_BNO)
+            fsw_blockcache_hash_insert(vol, i);
     }
 }
 
@@ -297,23 +652,145 @@ static void fsw_blockcache_free(struct fsw_volume *vol)
         fsw_free(vol->bcache);
         vol->bcache = NULL;
     }
+    if (vol->bcache_hash != NULL) {
+        fsw_free(vol->bcache_hash);
+        vol->bcache_hash = NULL;
+    }
     vol->bcache_size = 0;
-    fsw_efi_clear_cache();
+    fsw_blockcache_reset(vol);
+}
+
+/**
+ * Initialize the list heads of an empty block cache.
+ */
+
+static void fsw_blockcache_reset(struct fsw_volume *vol)
+{
+    fsw_u32 level;
+
+    vol->bcache_free = FSW_BCACHE_NONE;
+    for (level = 0; level <= MAX_CACHE_LEVEL; level++)
+        vol->bcache_lru_head[level] = vol->bcache_lru_tail[level] = FSW_BCACHE_NONE;
+}
+
+/**
+ * Compute the hash chain for a dnode id. The hash table size is a power of two.
+ */
+
+static fsw_u32 fsw_dnode_hash(struct fsw_volume *vol, fsw_u64 tree_id, fsw_u64 dnode_id)
+{
+    fsw_u32 h;
+
+    h = (fsw_u32)dnode_id ^ (fsw_u32)FSW_U64_SHR(dnode_id, 32);
+    h ^= ((fsw_u32)tree_id ^ (fsw_u32)FSW_U64_SHR(tree_id, 32)) * 0x9e3779b1;
+    h ^= h >> 16;
+    h *= 0x45d9f3b;
+    h ^= h >> 16;
+    return h & (vol->dnode_hash_size - 1);
+}
+
+/**
+ * Resize the dnode hash table and rehash all dnodes on the volume's list. If the
+ * allocation fails, the old table is kept; it still works, only with longer chains.
+ */
+
+static void fsw_dnode_hash_resize(struct fsw_volume *vol, fsw_u32 new_size)
+{
+    struct fsw_dnode **new_hash;
+    struct fsw_dnode *dno;
+    fsw_u32         i;
+
+    if (fsw_alloc(new_size * sizeof(struct fsw_dnode *), &new_hash))
+        return;
+    for (i = 0; i < new_size; i++)
+        new_hash[i] = NULL;
+
+    if (vol->dnode_hash != NULL)
+        fsw_free(vol->dnode_hash);
+    vol->dnode_hash = new_hash;
+    vol->dnode_hash_size = new_size;
+
+    for (dno = vol->dnode_head; dno; dno = dno->next) {
+        i = fsw_dnode_hash(vol, dno->tree_id, dno->dnode_id);
+        dno->hash_next = vol->dnode_hash[i];
+        vol->dnode_hash[i] = dno;
+    }
 }
 
 /**
  * Add a new dnode to the list of known dnodes. This internal function is used when a
- * dnode is created to add it to the dnode list that is used to search for existing
- * dnodes by id.
+ * dnode is created to add it to the dnode list and to the hash table that is used to
+ * search for existing dnodes by id.
  */
 
 static void fsw_dnode_register(struct fsw_volume *vol, struct fsw_dnode *dno)
 {
+    fsw_u32 i;
+
+    // keep the average chain length at one or below
+    vol->dnode_count++;
+    if (vol->dnode_count > vol->dnode_hash_size)
+        fsw_dnode_hash_resize(vol, vol->dnode_hash_size ? vol->dnode_hash_size << 1 : FSW_DNODE_HASH_MIN);
+
     dno->next = vol->dnode_head;
     if (vol->dnode_head != NULL)
         vol->dnode_head->prev = dno;
     dno->prev = NULL;
     vol->dnode_head = dno;
+
+    dno->hash_next = NULL;
+    if (vol->dnode_hash != NULL) {
+        i = fsw_dnode_hash(vol, dno->tree_id, dno->dnode_id);
+        dno->hash_next = vol->dnode_hash[i];
+        vol->dnode_hash[i] = dno;
+    }
+}
+
+/**
+ * Remove a dnode from the list of known dnodes and from the hash table.
+ */
+
+static void fsw_dnode_unregister(struct fsw_volume *vol, struct fsw_dnode *dno)
+{
+    struct fsw_dnode **link;
+
+    if (dno->next)
+        dno->next->prev = dno->prev;
+    if (dno->prev)
+        dno->prev->next = dno->next;
+    if (vol->dnode_head == dno)
+        vol->dnode_head = dno->next;
+    vol->dnode_count--;
+
+    if (vol->dnode_hash != NULL) {
+        for (link = &vol->dnode_hash[fsw_dnode_hash(vol, dno->tree_id, dno->dnode_id)];
+             *link != NULL; link = &(*link)->hash_next) {
+            if (*link == dno) {
+                *link = dno->hash_next;
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * Find an existing dnode by id. Returns NULL if there is no such dnode.
+ */
+
+static struct fsw_dnode *fsw_dnode_find(struct fsw_volume *vol, fsw_u64 tree_id, fsw_u64 dnode_id)
+{
+    struct fsw_dnode *dno;
+
+    if (vol->dnode_hash != NULL)
+        dno = vol->dnode_hash[fsw_dnode_hash(vol, tree_id, dnode_id)];
+    else
+        dno = vol->dnode_head;     // no hash table, fall back to the plain list
+
+    for (; dno; dno = (vol->dnode_hash != NULL) ? dno->hash_next : dno->next) {
+        if (dno->dnode_id == dnode_id && dno->tree_id == tree_id)
+            return dno;
+    }
+    return NULL;
 }
 
 /**
@@ -329,7 +806,7 @@ fsw_status_t fsw_dnode_create_root_with_tree(struct fsw_volume *vol, fsw_u64 tre
     struct fsw_dnode *dno;
 
     // allocate memory for the structure
-    status = fsw_alloc_zero(vol->fstype_table->dnode_struct_size, (void **)&dno);
+    status = fsw_slab_alloc(&vol->dnode_slab, (void **)&dno);
     if (status)
         return status;
 
@@ -379,16 +856,15 @@ fsw_status_t fsw_dnode_create_with_tree(struct fsw_dnode *parent_dno, fsw_u64 tr
     struct fsw_dnode *dno;
 
     // check if we already have a dnode with the same id
-    for (dno = vol->dnode_head; dno; dno = dno->next) {
-        if (dno->dnode_id == dnode_id && dno->tree_id == tree_id) {
-            fsw_dnode_retain(dno);
-            *dno_out = dno;
-            return FSW_SUCCESS;
-        }
+    dno = fsw_dnode_find(vol, tree_id, dnode_id);
+    if (dno != NULL) {
+        fsw_dnode_retain(dno);
+        *dno_out = dno;
+        return FSW_SUCCESS;
     }
 
     // allocate memory for the structure
-    status = fsw_alloc_zero(vol->fstype_table->dnode_struct_size, (void **)&dno);
+    status = fsw_slab_alloc(&vol->dnode_slab, (void **)&dno);
     if (status)
         return status;
 
@@ -402,7 +878,7 @@ fsw_status_t fsw_dnode_create_with_tree(struct fsw_dnode *parent_dno, fsw_u64 tr
     dno->refcount = 1;
     status = fsw_strdup_coerce(&dno->name, vol->host_table->native_string_type, name);
     if (status) {
-        fsw_free(dno);
+        fsw_slab_free(&vol->dnode_slab, dno);
         return status;
     }
 
@@ -426,7 +902,9 @@ fsw_status_t fsw_dnode_create(struct fsw_dnode *parent_dno, fsw_u64 dnode_id, in
 
 void fsw_dnode_retain(struct fsw_dnode *dno)
 {
+    FSW_VOLUME_LOCK(dno->vol);
     dno->refcount++;
+    FSW_VOLUME_UNLOCK(dno->vol);
 }
 
 /**
@@ -441,29 +919,28 @@ void fsw_dnode_release(struct fsw_dnode *dno)
     struct fsw_volume *vol = dno->vol;
     struct fsw_dnode *parent_dno;
 
+    FSW_VOLUME_LOCK(vol);
     dno->refcount--;
 
     if (dno->refcount == 0) {
         parent_dno = dno->parent;
 
-        // de-register from volume's list
-        if (dno->next)
-            dno->next->prev = dno->prev;
-        if (dno->prev)
-            dno->prev->next = dno->next;
-        if (vol->dnode_head == dno)
-            vol->dnode_head = dno->next;
+        // de-register from volume's list and hash table
+        fsw_dnode_unregister(vol, dno);
 
         // run fstype-specific cleanup
         vol->fstype_table->dnode_free(vol, dno);
 
+        if (dno->extent_map != NULL)
+            fsw_free(dno->extent_map);
         fsw_strfree(&dno->name);
-        fsw_free(dno);
+        fsw_slab_free(&vol->dnode_slab, dno);
 
         // release our pointer to the parent, possibly deallocating it, too
         if (parent_dno)
             fsw_dnode_release(parent_dno);
     }
+    FSW_VOLUME_UNLOCK(vol);
 }
 
 /**
@@ -479,9 +956,14 @@ void fsw_dnode_release(struct fsw_dnode *dno)
 
 fsw_status_t fsw_dnode_fill(struct fsw_dnode *dno)
 {
+    fsw_status_t    status;
+
     // TODO: check a flag right here, call fstype's dnode_fill only once per dnode
 
-    return dno->vol->fstype_table->dnode_fill(dno->vol, dno);
+    FSW_VOLUME_LOCK(dno->vol);
+    status = dno->vol->fstype_table->dnode_fill(dno->vol, dno);
+    FSW_VOLUME_UNLOCK(dno->vol);
+    return status;
 }
 
 /**
@@ -498,14 +980,15 @@ fsw_status_t fsw_dnode_stat(struct fsw_dnode *dno, struct fsw_dnode_stat *sb)
 {
     fsw_status_t    status;
 
+    FSW_VOLUME_LOCK(dno->vol);
     status = fsw_dnode_fill(dno);
-    if (status)
-        return status;
-
-    sb->used_bytes = 0;
-    status = dno->vol->fstype_table->dnode_stat(dno->vol, dno, sb);
-    if (!status && !sb->used_bytes)
-        sb->used_bytes = FSW_U64_DIV(dno->size + dno->vol->log_blocksize - 1, dno->vol->log_blocksize);
+    if (!status) {
+        sb->used_bytes = 0;
+        status = dno->vol->fstype_table->dnode_stat(dno->vol, dno, sb);
+        if (!status && !sb->used_bytes)
+            sb->used_bytes = FSW_U64_DIV(dno->size + dno->vol->log_blocksize - 1, dno->vol->log_blocksize);
+    }
+    FSW_VOLUME_UNLOCK(dno->vol);
     return status;
 }
 
@@ -526,13 +1009,162 @@ fsw_status_t fsw_dnode_lookup(struct fsw_dnode *dno,
 {
     fsw_status_t    status;
 
+    FSW_VOLUME_LOCK(dno->vol);
     status = fsw_dnode_fill(dno);
-    if (status)
+    if (!status && dno->type != FSW_DNODE_TYPE_DIR)
+        status = FSW_UNSUPPORTED;
+    if (!status)
+        status = fsw_dnode_lookup_cached(dno, lookup_name, child_dno_out);
+    FSW_VOLUME_UNLOCK(dno->vol);
+    return status;
+}
+
+/**
+ * Compute the hash value of a directory id and a name for the path lookup cache.
+ */
+
+static fsw_u32 fsw_dcache_hash(fsw_u64 tree_id, fsw_u64 dnode_id, struct fsw_string *name)
+{
+    fsw_u32 h;
+    fsw_u8  *p;
+    int     i;
+
+    // FNV-1a over the name bytes, seeded with the directory id
+    h = 2166136261U ^ (fsw_u32)dnode_id ^ (fsw_u32)FSW_U64_SHR(dnode_id, 32) ^ ((fsw_u32)tree_id * 0x9e3779b1);
+    h ^= (fsw_u32)name->type;
+    for (i = 0, p = (fsw_u8 *)name->data; i < name->size; i++) {
+        h ^= p[i];
+        h *= 16777619U;
+    }
+    return h;
+}
+
+/**
+ * Remove an entry from the path lookup cache and free it.
+ */
+
+static void fsw_dcache_remove(struct fsw_volume *vol, struct fsw_dentry *dent)
+{
+    struct fsw_dentry **link;
+
+    for (link = &vol->dcache_hash[dent->hash % FSW_DCACHE_HASH_SIZE]; *link != NULL; link = &(*link)->hash_next) {
+        if (*link == dent) {
+            *link = dent->hash_next;
+            break;
+        }
+    }
+
+    if (dent->lru_prev)
+        dent->lru_prev->lru_next = dent->lru_next;
+    else
+        vol->dcache_lru_head = dent->lru_next;
+    if (dent->lru_next)
+        dent->lru_next->lru_prev = dent->lru_prev;
+    else
+        vol->dcache_lru_tail = dent->lru_prev;
+    vol->dcache_count--;
+
+    if (dent->dnode != NULL)
+        fsw_dnode_release(dent->dnode);
+    fsw_strfree(&dent->name);
+    fsw_slab_free(&vol->dentry_slab, dent);
+}
+
+/**
+ * Remove all entries from the path lookup cache, releasing the dnodes they hold.
+ */
+
+static void fsw_dcache_flush(struct fsw_volume *vol)
+{
+    while (vol->dcache_lru_head != NULL)
+        fsw_dcache_remove(vol, vol->dcache_lru_head);
+}
+
+/**
+ * Look up a name in a directory through the volume's path lookup cache. The directory
+ * dnode must already be filled. Successful lookups and FSW_NOT_FOUND results from the
+ * file system driver are remembered, so that repeated probes for the same names skip
+ * the directory scan. Names are compared exactly (same encoding, same bytes).
+ */
+
+static fsw_status_t fsw_dnode_lookup_cached(struct fsw_dnode *dno,
+                                            struct fsw_string *lookup_name, struct fsw_dnode **child_dno_out)
+{
+    fsw_status_t    status;
+    struct fsw_volume *vol = dno->vol;
+    struct fsw_dentry *dent;
+    fsw_u32         hash;
+    fsw_u64         ticks;
+
+    hash = fsw_dcache_hash(dno->tree_id, dno->dnode_id, lookup_name);
+    for (dent = vol->dcache_hash[hash % FSW_DCACHE_HASH_SIZE]; dent; dent = dent->hash_next) {
+        if (dent->hash == hash && dent->parent_dnode_id == dno->dnode_id &&
+            dent->parent_tree_id == dno->tree_id && dent->name.type == lookup_name->type &&
+            dent->name.size == lookup_name->size &&
+            fsw_memeq(dent->name.data, lookup_name->data, lookup_name->size))
+            break;
+    }
+
+    if (dent != NULL) {
+        // move to the most recently used end of the LRU list
+        if (dent != vol->dcache_lru_tail) {
+            if (dent->lru_prev)
+                dent->lru_prev->lru_next = dent->lru_next;
+            else
+                vol->dcache_lru_head = dent->lru_next;
+            dent->lru_next->lru_prev = dent->lru_prev;
+            dent->lru_prev = vol->dcache_lru_tail;
+            dent->lru_next = NULL;
+            vol->dcache_lru_tail->lru_next = dent;
+            vol->dcache_lru_tail = dent;
+        }
+
+        vol->io_stats.dcache_hits++;
+        if (dent->dnode == NULL)
+            return FSW_NOT_FOUND;
+        fsw_dnode_retain(dent->dnode);
+        *child_dno_out = dent->dnode;
+        return FSW_SUCCESS;
+    }
+
+    ticks = FSW_GET_TICKS();
+    status = vol->fstype_table->dir_lookup(vol, dno, lookup_name, child_dno_out);
+    vol->io_stats.dir_lookup_calls++;
+    vol->io_stats.dir_lookup_ticks += FSW_GET_TICKS() - ticks;
+    if (status != FSW_SUCCESS && status != FSW_NOT_FOUND)
         return status;
-    if (dno->type != FSW_DNODE_TYPE_DIR)
-        return FSW_UNSUPPORTED;
 
-    return dno->vol->fstype_table->dir_lookup(dno->vol, dno, lookup_name, child_dno_out);
+    // remember the result; failing to do so is not an error
+    if (fsw_slab_alloc(&vol->dentry_slab, (void **)&dent))
+        return status;
+    if (fsw_strdup_coerce(&dent->name, lookup_name->type, lookup_name)) {
+        fsw_slab_free(&vol->dentry_slab, dent);
+        return status;
+    }
+    dent->parent_tree_id = dno->tree_id;
+    dent->parent_dnode_id = dno->dnode_id;
+    dent->hash = hash;
+    dent->dnode = NULL;
+    if (status == FSW_SUCCESS) {
+        dent->dnode = *child_dno_out;
+        fsw_dnode_retain(dent->dnode);
+    }
+
+    if (vol->dcache_count >= FSW_DCACHE_SIZE)
+        fsw_dcache_remove(vol, vol->dcache_lru_head);
+
+    dent->hash_next = vol->dcache_hash[hash % FSW_DCACHE_HASH_SIZE];
+    vol->dcache_hash[hash % FSW_DCACHE_HASH_SIZE] = dent;
+    dent->lru_prev = vol->dcache_lru_tail;
+    dent->lru_next = NULL;
+    if (vol->dcache_lru_tail)
+        vol->dcache_lru_tail->lru_next = dent;
+    else
+        vol->dcache_lru_head = dent;
+    vol->dcache_lru_tail = dent;
+    vol->dcache_count++;
+
+    return status;
 }
 
 /**
@@ -557,6 +1189,7 @@ fsw_status_t fsw_dnode_lookup_path(struct fsw_dnode *dno,
     struct fsw_string remaining_path;
     int             root_if_empty;
 
+    FSW_VOLUME_LOCK(vol);
     remaining_path = *lookup_path;
     fsw_dnode_retain(dno);
 
@@ -603,7 +1236,7 @@ fsw_status_t fsw_dnode_lookup_path(struct fsw_dnode *dno,
 
             // make sure we operate on a directory
             if (dno->type != FSW_DNODE_TYPE_DIR) {
-                return FSW_UNSUPPORTED;
+                status = FSW_UNSUPPORTED;
                 goto errorexit;
             }
 
@@ -624,7 +1257,7 @@ fsw_status_t fsw_dnode_lookup_path(struct fsw_dnode *dno,
 
             } else {
                 // do an actual lookup
-                status = vol->fstype_table->dir_lookup(vol, dno, &lookup_name, &child_dno);
+                status = fsw_dnode_lookup_cached(dno, &lookup_name, &child_dno);
                 if (status)
                     goto errorexit;
             }
@@ -639,6 +1272,7 @@ fsw_status_t fsw_dnode_lookup_path(struct fsw_dnode *dno,
     }
 
     *child_dno_out = dno;
+    FSW_VOLUME_UNLOCK(vol);
     return FSW_SUCCESS;
 
 errorexit:
@@ -646,6 +1280,7 @@ errorexit:
     fsw_dnode_release(dno);
     if (child_dno != NULL)
         fsw_dnode_release(child_dno);
+    FSW_VOLUME_UNLOCK(vol);
     return status;
 }
 
@@ -665,13 +1300,21 @@ fsw_status_t fsw_dnode_dir_read(struct fsw_shandle *shand, struct fsw_dnode **ch
 {
     fsw_status_t    status;
     struct fsw_dnode *dno = shand->dnode;
-    fsw_u64         saved_pos;
+    struct fsw_volume *vol = dno->vol;
+    fsw_u64         saved_pos, ticks;
 
-    if (dno->type != FSW_DNODE_TYPE_DIR)
+    FSW_VOLUME_LOCK(vol);
+    if (dno->type != FSW_DNODE_TYPE_DIR) {
+        FSW_VOLUME_UNLOCK(vol);
         return FSW_UNSUPPORTED;
+    }
 
     saved_pos = shand->pos;
-    status = dno->vol->fstype_table->dir_read(dno->vol, dno, shand, child_dno_out);
+    ticks = FSW_GET_TICKS();
+    status = vol->fstype_table->dir_read(vol, dno, shand, child_dno_out);
+    vol->io_stats.dir_read_calls++;
+    vol->io_stats.dir_read_ticks += FSW_GET_TICKS() - ticks;
+    FSW_VOLUME_UNLOCK(vol);
     if (status)
         shand->pos = saved_pos;
     return status;
@@ -691,13 +1334,14 @@ fsw_status_t fsw_dnode_readlink(struct fsw_dnode *dno, struct fsw_string *target
 {
     fsw_status_t    status;
 
+    FSW_VOLUME_LOCK(dno->vol);
     status = fsw_dnode_fill(dno);
-    if (status)
-        return status;
-    if (dno->type != FSW_DNODE_TYPE_SYMLINK)
-        return FSW_UNSUPPORTED;
-
-    return dno->vol->fstype_table->readlink(dno->vol, dno, target_name);
+    if (!status && dno->type != FSW_DNODE_TYPE_SYMLINK)
+        status = FSW_UNSUPPORTED;
+    if (!status)
+        status = dno->vol->fstype_table->readlink(dno->vol, dno, target_name);
+    FSW_VOLUME_UNLOCK(dno->vol);
+    return status;
 }
 
 /**
@@ -764,7 +1408,9 @@ fsw_status_t fsw_dnode_resolve(struct fsw_dnode *dno, struct fsw_dnode **target_
     struct fsw_dnode *target_dno;
     /* Linux kernel max link count is 40 */
     int link_count = 40;
+    struct fsw_volume *vol = dno->vol;
 
+    FSW_VOLUME_LOCK(vol);
     fsw_dnode_retain(dno);
 
     while (--link_count > 0) {
@@ -775,6 +1421,7 @@ fsw_status_t fsw_dnode_resolve(struct fsw_dnode *dno, struct fsw_dnode **target_
         if (dno->type != FSW_DNODE_TYPE_SYMLINK) {
             // found a non-symlink target, return it
             *target_dno_out = dno;
+            FSW_VOLUME_UNLOCK(vol);
             return FSW_SUCCESS;
         }
         if (dno->parent == NULL) {    // safety measure, cannot happen in theory
@@ -802,9 +1449,100 @@ fsw_status_t fsw_dnode_resolve(struct fsw_dnode *dno, struct fsw_dnode **target_
 
 errorexit:
     fsw_dnode_release(dno);
+    FSW_VOLUME_UNLOCK(vol);
     return status;
 }
 
+/**
+ * Remember an extent in the dnode's extent map. This function is called by the core for
+ * every extent returned by the file system's get_extent function, and may be called by
+ * file system drivers to add further extents of the same dnode that they have already
+ * decoded, e.g. all extents of an extent tree leaf or of a run list. Only PHYSBLOCK and
+ * SPARSE extents are remembered. Extents that overlap an entry already in the map are
+ * ignored. When the map is full or cannot be enlarged, it is started over.
+ */
+
+void fsw_dnode_cache_extent(struct fsw_dnode *dno, struct fsw_extent *extent)
+{
+    struct fsw_extent *new_map;
+    fsw_u32         lo, hi, mid, new_size;
+
+    if ((extent->type != FSW_EXTENT_TYPE_PHYSBLOCK && extent->type != FSW_EXTENT_TYPE_SPARSE) ||
+        extent->log_count == 0)
+        return;
+
+    if (dno->extent_map_count >= FSW_EXTENT_MAP_MAX)
+        dno->extent_map_count = 0;
+    if (dno->extent_map_count == dno->extent_map_size) {
+        new_size = dno->extent_map_size ? dno->extent_map_size << 1 : 16;
+        if (new_size > FSW_EXTENT_MAP_MAX)
+            new_size = FSW_EXTENT_MAP_MAX;
+        if (fsw_alloc(new_size * sizeof(struct fsw_extent), &new_map)) {
+            dno->extent_map_count = 0;
+            if (dno->extent_map_size == 0)
+                return;
+        } else {
+            if (dno->extent_map != NULL) {
+                fsw_memcpy(new_map, dno->extent_map, dno->extent_map_count * sizeof(struct fsw_extent));
+                fsw_free(dno->extent_map);
+            }
+            dno->extent_map = new_map;
+            dno->extent_map_size = new_size;
+        }
+    }
+
+    // find the first entry starting after the new extent
+    lo = 0;
+    hi = dno->extent_map_count;
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (dno->extent_map[mid].log_start <= extent->log_start)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    // reject overlaps with the neighbours
+    if (lo > 0 &&
+        dno->extent_map[lo - 1].log_start + dno->extent_map[lo - 1].log_count > extent->log_start)
+        return;
+    if (lo < dno->extent_map_count &&
+        extent->log_start + extent->log_count > dno->extent_map[lo].log_start)
+        return;
+
+    for (hi = dno->extent_map_count; hi > lo; hi--)
+        dno->extent_map[hi] = dno->extent_map[hi - 1];
+    dno->extent_map[lo] = *extent;
+    dno->extent_map[lo].buffer = NULL;
+    dno->extent_map_count++;
+}
+
+/**
+ * Look up a logical block in the dnode's extent map. If an extent covering the block
+ * is found, it is copied to *extent and boolean true is returned.
+ */
+
+static int fsw_dnode_find_extent(struct fsw_dnode *dno, fsw_u64 log_bno, struct fsw_extent *extent)
+{
+    fsw_u32         lo, hi, mid;
+
+    // find the last entry starting at or before log_bno
+    lo = 0;
+    hi = dno->extent_map_count;
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (dno->extent_map[mid].log_start <= log_bno)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == 0 || log_bno >= dno->extent_map[lo - 1].log_start + dno->extent_map[lo - 1].log_count)
+        return 0;
+
+    *extent = dno->extent_map[lo - 1];
+    return 1;
+}
+
 /**
  * Set up a shandle (storage handle) to access a file's data. This function is called
  * by the host driver and by the core when they need to access a file's data. It is also
@@ -825,16 +1563,29 @@ fsw_status_t fsw_shandle_open(struct fsw_dnode *dno, struct fsw_shandle *shand)
     struct fsw_volume *vol = dno->vol;
 
     // read full dnode information into memory
+    FSW_VOLUME_LOCK(vol);
     status = vol->fstype_table->dnode_fill(vol, dno);
-    if (status)
+    if (status) {
+        FSW_VOLUME_UNLOCK(vol);
         return status;
+    }
 
     // setup shandle
-    fsw_dnode_retain(dno);
+    dno->refcount++;
+    FSW_VOLUME_UNLOCK(vol);
 
     shand->dnode = dno;
     shand->pos = 0;
     shand->extent.type = FSW_EXTENT_TYPE_INVALID;
+    shand->ra_buffer = NULL;
+    shand->ra_size = 0;
+    shand->ra_count = 0;
+    shand->ra_window = 0;
+    shand->ra_next_pos = 0;
+    shand->ra_async_buffer = NULL;
+    shand->ra_async_size = 0;
+    shand->ra_async_count = 0;
+    shand->ra_async_token = NULL;
 
     return FSW_SUCCESS;
 }
@@ -848,17 +1599,138 @@ fsw_status_t fsw_shandle_open(struct fsw_dnode *dno, struct fsw_shandle *shand)
 
 void fsw_shandle_close(struct fsw_shandle *shand)
 {
+    struct fsw_volume *vol = shand->dnode->vol;
+
+    FSW_VOLUME_LOCK(vol);
     if (shand->extent.type == FSW_EXTENT_TYPE_BUFFER)
         fsw_free(shand->extent.buffer);
+    if (shand->ra_buffer != NULL)
+        fsw_free(shand->ra_buffer);
+    if (shand->ra_async_count > 0)
+        fsw_block_read_wait(shand->dnode->vol, shand->ra_async_token);
+    if (shand->ra_async_buffer != NULL)
+        fsw_free(shand->ra_async_buffer);
     fsw_dnode_release(shand->dnode);
+    FSW_VOLUME_UNLOCK(vol);
+}
+
+/**
+ * Fill a shandle's read-ahead buffer with count physical blocks starting at phys_bno,
+ * using a single host request where possible, and widen the window for the next time.
+ * avail is the number of blocks from phys_bno on that belong to the same extent and
+ * lie within the file.
+ *
+ * If the host can read asynchronously, the buffer is double-buffered: after each fill,
+ * the next window of the extent is requested in the background, and the following
+ * call swaps that buffer in instead of reading, so the host's transfer overlaps with
+ * the caller consuming the current window.
+ */
+
+static fsw_status_t fsw_shandle_readahead(struct fsw_shandle *shand, fsw_u64 phys_bno, fsw_u32 count,
+                                          fsw_u64 avail)
+{
+    fsw_status_t    status;
+    struct fsw_volume *vol = shand->dnode->vol;
+    fsw_u32         size = count * vol->phys_blocksize;
+    fsw_u8          *swap_buffer;
+    fsw_u32         swap_size;
+    fsw_u64         next_count;
+
+    shand->ra_count = 0;
+
+    // collect the background read, and use it if it starts where we need it
+    if (shand->ra_async_count > 0) {
+        status = fsw_block_read_wait(vol, shand->ra_async_token);
+        if (status == FSW_SUCCESS && shand->ra_async_start == phys_bno) {
+            swap_buffer = shand->ra_buffer;
+            swap_size = shand->ra_size;
+            shand->ra_buffer = shand->ra_async_buffer;
+            shand->ra_size = shand->ra_async_size;
+            shand->ra_async_buffer = swap_buffer;
+            shand->ra_async_size = swap_size;
+            shand->ra_phys_start = phys_bno;
+            shand->ra_count = shand->ra_async_count;
+        }
+        shand->ra_async_count = 0;
+    }
+
+    if (shand->ra_count == 0) {
+        if (shand->ra_size < size) {
+            if (shand->ra_buffer != NULL)
+                fsw_free(shand->ra_buffer);
+            shand->ra_size = 0;
+            status = fsw_alloc(size, &shand->ra_buffer);
+            if (status) {
+                shand->ra_buffer = NULL;
+                return status;
+            }
+            shand->ra_size = size;
+        }
+
+        status = fsw_block_read_direct(vol, phys_bno, count, shand->ra_buffer);
+        if (status)
+            return status;
+        shand->ra_phys_start = phys_bno;
+        shand->ra_count = count;
+    }
+
+    shand->ra_window <<= 1;
+    if (shand->ra_window > FSW_READAHEAD_MAX)
+        shand->ra_window = FSW_READAHEAD_MAX;
+
+    // request the next window of the extent in the background
+    if (vol->host_table->read_blocks_async != NULL && avail > shand->ra_count) {
+        next_count = FSW_U64_DIV(shand->ra_window, vol->phys_blocksize);
+        if (next_count > avail - shand->ra_count)
+            next_count = avail - shand->ra_count;
+        size = (fsw_u32)next_count * vol->phys_blocksize;
+        if (shand->ra_async_size < size) {
+            if (shand->ra_async_buffer != NULL)
+                fsw_free(shand->ra_async_buffer);
+            shand->ra_async_size = 0;
+            if (fsw_alloc(size, &shand->ra_async_buffer)) {
+                shand->ra_async_buffer = NULL;
+                return FSW_SUCCESS;     // no background read this time
+            }
+            shand->ra_async_size = size;
+        }
+        if (fsw_block_read_async(vol, shand->ra_phys_start + shand->ra_count, (fsw_u32)next_count,
+                                 shand->ra_async_buffer, &shand->ra_async_token) == FSW_SUCCESS) {
+            shand->ra_async_start = shand->ra_phys_start + shand->ra_count;
+            shand->ra_async_count = (fsw_u32)next_count;
+        }
+    }
+    return FSW_SUCCESS;
 }
 
 /**
  * Read data from a shandle (storage handle for a dnode). This function is called by the
  * host driver or internally when data is read from a file. TODO: more
+ *
+ * When a shandle reads file data sequentially in pieces smaller than the read-ahead
+ * window, the following blocks of the current extent are fetched into a per-shandle
+ * buffer in one request. The window starts at FSW_READAHEAD_MIN, doubles with every
+ * read-ahead up to FSW_READAHEAD_MAX, and is dropped when the file pointer is moved.
+ * On hosts with asynchronous reads, the window after the current one is already in
+ * flight while the caller consumes the current one.
  */
 
 fsw_status_t fsw_shandle_read(struct fsw_shandle *shand, fsw_u32 *buffer_size_inout, void *buffer_in)
+{
+    fsw_status_t    status;
+    struct fsw_volume *vol = shand->dnode->vol;
+
+    FSW_VOLUME_LOCK(vol);
+    status = fsw_shandle_read_locked(shand, buffer_size_inout, buffer_in);
+    FSW_VOLUME_UNLOCK(vol);
+    return status;
+}
+
+/**
+ * Body of fsw_shandle_read, called with the volume lock held.
+ */
+
+static fsw_status_t fsw_shandle_read_locked(struct fsw_shandle *shand, fsw_u32 *buffer_size_inout, void *buffer_in)
 {
     fsw_status_t    status;
     struct fsw_dnode *dno = shand->dnode;
@@ -866,6 +1738,7 @@ fsw_status_t fsw_shandle_read(struct fsw_shandle *shand, fsw_u32 *buffer_size_in
     fsw_u8          *buffer, *block_buffer;
     fsw_u64         buflen, copylen, pos;
     fsw_u64         log_bno, pos_in_extent, phys_bno, pos_in_physblock;
+    fsw_u64         extent_left, ra_count, ra_avail, ticks;
     fsw_u32         cache_level;
 
     if (shand->pos >= dno->size) {   // already at EOF
@@ -878,6 +1751,11 @@ fsw_status_t fsw_shandle_read(struct fsw_shandle *shand, fsw_u32 *buffer_size_in
     buflen = *buffer_size_inout;
     pos = (fsw_u32)shand->pos;
     cache_level = (dno->type != FSW_DNODE_TYPE_FILE) ? 1 : 0;
+    // detect sequential access for read-ahead
+    if (pos != shand->ra_next_pos)
+        shand->ra_window = 0;
+    else if (shand->ra_window == 0)
+        shand->ra_window = FSW_READAHEAD_MIN;
     // restrict read to file size
     if (buflen > dno->size - pos)
         buflen = (fsw_u32)(dno->size - pos);
@@ -892,12 +1770,20 @@ fsw_status_t fsw_shandle_read(struct fsw_shandle *shand, fsw_u32 *buffer_size_in
             if (shand->extent.type == FSW_EXTENT_TYPE_BUFFER)
                 fsw_free(shand->extent.buffer);
 
-            // ask the file system for the proper extent
-            shand->extent.log_start = log_bno;
-            status = vol->fstype_table->get_extent(vol, dno, &shand->extent);
-            if (status) {
-                shand->extent.type = FSW_EXTENT_TYPE_INVALID;
-                return status;
+            if (fsw_dnode_find_extent(dno, log_bno, &shand->extent)) {
+                vol->io_stats.extent_map_hits++;
+            } else {
+                // ask the file system for the proper extent
+                shand->extent.log_start = log_bno;
+                ticks = FSW_GET_TICKS();
+                status = vol->fstype_table->get_extent(vol, dno, &shand->extent);
+                vol->io_stats.get_extent_calls++;
+                vol->io_stats.get_extent_ticks += FSW_GET_TICKS() - ticks;
+                if (status) {
+                    shand->extent.type = FSW_EXTENT_TYPE_INVALID;
+                    return status;
+                }
+                fsw_dnode_cache_extent(dno, &shand->extent);
             }
         }
 
@@ -908,18 +1794,65 @@ fsw_status_t fsw_shandle_read(struct fsw_shandle *shand, fsw_u32 *buffer_size_in
             // convert to physical block number and offset
             phys_bno = shand->extent.phys_start + FSW_U64_DIV(pos_in_extent, vol->phys_blocksize);
             pos_in_physblock = pos_in_extent & (vol->phys_blocksize - 1);
-            copylen = vol->phys_blocksize - pos_in_physblock;
-            if (copylen > buflen)
-                copylen = buflen;
+            extent_left = (fsw_u64)shand->extent.log_count * vol->log_blocksize - pos_in_extent;
+
+            if (cache_level == 0 && buflen < shand->ra_window &&
+                (shand->ra_count == 0 || phys_bno < shand->ra_phys_start ||
+                 phys_bno >= shand->ra_phys_start + shand->ra_count)) {
+                // small sequential read: fetch the next window of this extent in one go,
+                //  but not past the end of the file
+                ra_avail = FSW_U64_DIV(pos_in_physblock + extent_left + vol->phys_blocksize - 1, vol->phys_blocksize);
+                if (ra_avail > FSW_U64_DIV(dno->size - pos + pos_in_physblock + vol->phys_blocksize - 1, vol->phys_blocksize))
+                    ra_avail = FSW_U64_DIV(dno->size - pos + pos_in_physblock + vol->phys_blocksize - 1, vol->phys_blocksize);
+                if (ra_avail == 0)
+                    ra_avail = 1;
+                ra_count = FSW_U64_DIV(shand->ra_window, vol->phys_blocksize);
+                if (ra_count > ra_avail)
+                    ra_count = ra_avail;
+                if (ra_count == 0)
+                    ra_count = 1;
+                if (fsw_shandle_readahead(shand, phys_bno, (fsw_u32)ra_count, ra_avail))
+                    shand->ra_window = 0;   // fall back to the normal path below
+            }
 
-            // get one physical block
-            status = fsw_block_get(vol, phys_bno, cache_level, (void **)&block_buffer);
-            if (status)
-                return status;
+            if (cache_level == 0 && shand->ra_count > 0 &&
+                phys_bno >= shand->ra_phys_start && phys_bno < shand->ra_phys_start + shand->ra_count) {
+                // data is in the read-ahead buffer
+                copylen = (shand->ra_phys_start + shand->ra_count - phys_bno) * vol->phys_blocksize - pos_in_physblock;
+                if (copylen > extent_left)
+                    copylen = extent_left;
+                if (copylen > buflen)
+                    copylen = buflen;
+                fsw_memcpy(buffer, shand->ra_buffer + (phys_bno - shand->ra_phys_start) * vol->phys_blocksize + pos_in_physblock,
+                           copylen);
+
+            } else if (cache_level == 0 && pos_in_physblock == 0 && buflen >= vol->phys_blocksize) {
+                // whole blocks of file data: read them straight into the caller's buffer,
+                //  as far as this extent goes, without going through the block cache
+                copylen = extent_left;
+                if (copylen > buflen)
+                    copylen = buflen;
+                copylen &= ~(fsw_u64)(vol->phys_blocksize - 1);
+
+                status = fsw_block_read_direct(vol, phys_bno,
+                                               (fsw_u32)FSW_U64_DIV(copylen, vol->phys_blocksize), buffer);
+                if (status)
+                    return status;
 
-            // copy data from it
-            fsw_memcpy(buffer, block_buffer + pos_in_physblock, copylen);
-            fsw_block_release(vol, phys_bno, block_buffer);
+            } else {
+                copylen = vol->phys_blocksize - pos_in_physblock;
+                if (copylen > buflen)
+                    copylen = buflen;
+
+                // get one physical block
+                status = fsw_block_get(vol, phys_bno, cache_level, (void **)&block_buffer);
+                if (status)
+                    return status;
+
+                // copy data from it
+                fsw_memcpy(buffer, block_buffer + pos_in_physblock, copylen);
+                fsw_block_release(vol, phys_bno, block_buffer);
+            }
 
         } else if (shand->extent.type == FSW_EXTENT_TYPE_BUFFER) {
             copylen = shand->extent.log_count * vol->log_blocksize - pos_in_extent;
@@ -942,6 +1875,7 @@ fsw_status_t fsw_shandle_read(struct fsw_shandle *shand, fsw_u32 *buffer_size_in
 
     *buffer_size_inout = (fsw_u32)(pos - shand->pos);
     shand->pos = pos;
+    shand->ra_next_pos = pos;
 
     return FSW_SUCCESS;
 }
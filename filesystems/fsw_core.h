@@ -45,6 +45,28 @@
 #include "fsw_efi_base.h"
 #endif
 
+#ifndef FSW_GET_TICKS
+/** Time stamp source for the I/O statistics; hosts without one report zero times. */
+#define FSW_GET_TICKS() (0)
+#endif
+
+/*
+ * Lock hooks for hosts that call into the core from several threads. Such a host
+ * defines FSW_LOCK_TYPE and the four FSW_LOCK_ operations for a recursive lock, see
+ * fsw_posix_base.h. Everywhere else, including the EFI builds, they expand to nothing.
+ */
+#ifdef FSW_LOCK_TYPE
+/** Take the lock of a volume; may be nested. */
+#define FSW_VOLUME_LOCK(vol) FSW_LOCK_ACQUIRE(&(vol)->lock)
+/** Release the lock of a volume, once for every FSW_VOLUME_LOCK. */
+#define FSW_VOLUME_UNLOCK(vol) FSW_LOCK_RELEASE(&(vol)->lock)
+#else
+#define FSW_LOCK_INIT(lock)
+#define FSW_LOCK_DESTROY(lock)
+#define FSW_VOLUME_LOCK(vol) ((void)(vol))
+#define FSW_VOLUME_UNLOCK(vol) ((void)(vol))
+#endif
+
 /** Maximum size for a path, specifically symlink target paths. */
 #define FSW_PATH_MAX (4096)
 
@@ -56,6 +78,47 @@
 /** Indicates that the block cache entry is empty. */
 #define FSW_INVALID_BNO 0xFFFFFFFFFFFFFFFF
 
+/** Highest cache_level accepted by fsw_block_get. */
+#define MAX_CACHE_LEVEL (5)
+
+#ifndef FSW_BCACHE_BUDGET
+/**
+ * Default upper bound for the size of a volume's block cache in bytes. Can be
+ * overridden at build time; the host may also change vol->bcache_budget after
+ * mounting.
+ */
+#define FSW_BCACHE_BUDGET (4 * 1024 * 1024)
+#endif
+
+#ifndef FSW_DCACHE_SIZE
+/** Maximum number of entries in a volume's path lookup (dentry) cache. */
+#define FSW_DCACHE_SIZE (128)
+#endif
+
+/** Number of hash chains in the path lookup cache. */
+#define FSW_DCACHE_HASH_SIZE (64)
+
+#ifndef FSW_EXTENT_MAP_MAX
+/** Maximum number of extents remembered per dnode in its extent map. */
+#define FSW_EXTENT_MAP_MAX (512)
+#endif
+
+/** Number of objects allocated at once by a slab cache. */
+#define FSW_SLAB_CHUNK_OBJECTS (32)
+
+/** Default chunk size of an arena in bytes; larger requests get a chunk of their own. */
+#define FSW_ARENA_CHUNK_SIZE (4096)
+
+#ifndef FSW_READAHEAD_MIN
+/** Size of the first read-ahead on a shandle once its reads turn out to be sequential. */
+#define FSW_READAHEAD_MIN (16 * 1024)
+#endif
+
+#ifndef FSW_READAHEAD_MAX
+/** Upper bound for the read-ahead window of a shandle; the window doubles up to this size. */
+#define FSW_READAHEAD_MAX (512 * 1024)
+#endif
+
 
 //
 // Byte-swapping macros
@@ -205,6 +268,8 @@ enum {
 /* forward declarations */
 
 struct fsw_dnode;
+struct fsw_dentry;
+struct fsw_arena_chunk;
 struct fsw_host_table;
 struct fsw_fstype_table;
 
@@ -213,10 +278,76 @@ struct fsw_blockcache {
     fsw_u32     cache_level;        //!< Level of importance of this block
     fsw_u64     phys_bno;           //!< Physical block number
     void        *data;              //!< Block data buffer
+    fsw_u32     hash_next;          //!< Index of the next entry in the same hash chain
+    fsw_u32     lru_prev;           //!< Index of the previous (older) entry in the LRU or free list
+    fsw_u32     lru_next;           //!< Index of the next (newer) entry in the LRU or free list
+};
+
+/**
+ * Core: A cache of equally sized objects. Objects are carved out of larger chunks
+ * and recycled through a free list; the chunks are only returned to the host
+ * when the slab is destroyed.
+ */
+
+struct fsw_slab {
+    fsw_u32     obj_size;           //!< Size of one object in bytes, rounded up for alignment
+    fsw_u32     chunk_objects;      //!< Number of objects per chunk
+    void        *free_list;         //!< Singly-linked list of free objects
+    void        *chunks;            //!< Singly-linked list of allocated chunks
+};
+
+/**
+ * Core: A bump allocator for short-lived data. Allocations are not freed one by
+ * one; instead, the caller records a mark and later rewinds the arena to it. The
+ * chunks are kept for reuse until the arena is destroyed.
+ */
+
+struct fsw_arena {
+    struct fsw_arena_chunk *first;  //!< Oldest chunk
+    struct fsw_arena_chunk *current;    //!< Chunk that allocations are taken from, NULL if none yet
+    fsw_u32     used;               //!< Bytes used in the current chunk
+};
+
+/**
+ * Core: A position in an arena, as recorded by fsw_arena_mark.
+ */
+
+struct fsw_arena_mark {
+    struct fsw_arena_chunk *chunk;  //!< Current chunk at the time of the mark
+    fsw_u32     used;               //!< Bytes used in that chunk at the time of the mark
+};
+
+/**
+ * Core: I/O and cache statistics of a volume, see fsw_volume_get_io_stats. Times are
+ * in the units of FSW_GET_TICKS, i.e. CPU time stamp counter ticks under EFI and
+ * nanoseconds on POSIX hosts.
+ */
+
+struct fsw_io_stats {
+    fsw_u64     bcache_hits[MAX_CACHE_LEVEL + 1];   //!< Block cache hits by cache level
+    fsw_u64     bcache_misses[MAX_CACHE_LEVEL + 1]; //!< Block cache misses by cache level
+    fsw_u64     bcache_evictions;   //!< Cached blocks replaced to make room for others
+    fsw_u64     read_block_calls;   //!< Requests to the host's read_block/read_blocks functions
+    fsw_u64     read_block_bytes;   //!< Bytes requested from the host
+    fsw_u64     get_extent_calls;   //!< Calls to the file system's get_extent function
+    fsw_u64     get_extent_ticks;   //!< Time spent in get_extent
+    fsw_u64     extent_map_hits;    //!< Extents found in a dnode's extent map instead
+    fsw_u64     dir_lookup_calls;   //!< Calls to the file system's dir_lookup function
+    fsw_u64     dir_lookup_ticks;   //!< Time spent in dir_lookup
+    fsw_u64     dcache_hits;        //!< Lookups answered by the path lookup cache instead
+    fsw_u64     dir_read_calls;     //!< Calls to the file system's dir_read function
+    fsw_u64     dir_read_ticks;     //!< Time spent in dir_read
+    fsw_u64     async_read_calls;   //!< Background reads started through read_blocks_async
+    fsw_u64     async_wait_ticks;   //!< Time spent waiting for background reads to complete
+    fsw_u64     bcache_borrowed;    //!< Block cache misses served by a pointer borrowed from the host
 };
 
 /**
  * Core: Represents a mounted volume.
+ *
+ * If the host defines FSW_LOCK_TYPE, the core functions it calls take the volume's
+ * lock, so several threads may work on the same volume. Each shandle must still be
+ * used by one thread at a time, and fsw_unmount must not race with anything else.
  */
 
 struct fsw_volume {
@@ -227,14 +358,37 @@ struct fsw_volume {
     struct fsw_string label;        //!< Volume label
 
     struct fsw_dnode *dnode_head;   //!< List of all dnodes allocated for this volume
+    struct fsw_dnode **dnode_hash;  //!< Hash table of all dnodes, keyed on (tree_id, dnode_id)
+    fsw_u32     dnode_hash_size;    //!< Number of chains in the dnode hash table (a power of two)
+    fsw_u32     dnode_count;        //!< Number of dnodes currently allocated for this volume
+
+    struct fsw_dentry *dcache_hash[FSW_DCACHE_HASH_SIZE];   //!< Hash chains of the path lookup cache
+    struct fsw_dentry *dcache_lru_head; //!< Path lookup cache: least recently used entry
+    struct fsw_dentry *dcache_lru_tail; //!< Path lookup cache: most recently used entry
+    fsw_u32     dcache_count;       //!< Number of entries in the path lookup cache
+
+    struct fsw_slab dnode_slab;     //!< Allocator for the volume's dnode structures
+    struct fsw_slab dentry_slab;    //!< Allocator for the path lookup cache entries
+    struct fsw_arena arena;         //!< Allocator for short-lived lookup strings, see fsw_strdup_coerce_arena
+
+    struct fsw_io_stats io_stats;   //!< I/O and cache statistics
 
     struct fsw_blockcache *bcache;  //!< Array of block cache entries
     fsw_u32     bcache_size;        //!< Number of entries in the block cache array
+    fsw_u32     *bcache_hash;       //!< Hash table with chain heads into bcache, keyed on phys_bno
+    fsw_u32     bcache_free;        //!< Head of the list of unused block cache entries
+    fsw_u32     bcache_lru_head[MAX_CACHE_LEVEL + 1];   //!< Per-level LRU lists of unreferenced entries: oldest
+    fsw_u32     bcache_lru_tail[MAX_CACHE_LEVEL + 1];   //!< Per-level LRU lists of unreferenced entries: newest
+    fsw_u32     bcache_budget;      //!< Upper bound for the block cache size in bytes
 
     void        *host_data;         //!< Hook for a host-specific data structure
     struct fsw_host_table *host_table;      //!< Dispatch table for host-specific functions
     struct fsw_fstype_table *fstype_table;  //!< Dispatch table for file system specific functions
     int         host_string_type;   //!< String type used by the host environment
+
+#ifdef FSW_LOCK_TYPE
+    FSW_LOCK_TYPE lock;             //!< Serializes calls into the core and the driver, see FSW_VOLUME_LOCK
+#endif
 };
 
 /**
@@ -255,6 +409,11 @@ struct fsw_dnode {
 
     struct fsw_dnode *next;         //!< Doubly-linked list of all dnodes: previous dnode
     struct fsw_dnode *prev;         //!< Doubly-linked list of all dnodes: next dnode
+    struct fsw_dnode *hash_next;    //!< Next dnode in the same chain of the volume's dnode hash table
+
+    struct fsw_extent *extent_map;  //!< Extents resolved so far, sorted by log_start (PHYSBLOCK and SPARSE only)
+    fsw_u32     extent_map_count;   //!< Number of valid entries in extent_map
+    fsw_u32     extent_map_size;    //!< Number of allocated entries in extent_map
 };
 
 /**
@@ -269,6 +428,23 @@ enum {
     FSW_DNODE_TYPE_SPECIAL
 };
 
+/**
+ * Core: Remembers the result of looking up a name in a directory. Entries with
+ * a NULL dnode record that the name does not exist.
+ */
+
+struct fsw_dentry {
+    fsw_u64     parent_tree_id;     //!< Tree id of the directory the name was looked up in
+    fsw_u64     parent_dnode_id;    //!< Dnode id of the directory the name was looked up in
+    struct fsw_string name;         //!< Name that was looked up (private copy)
+    fsw_u32     hash;               //!< Full hash value of parent and name
+    struct fsw_dnode *dnode;        //!< Retained result of the lookup, or NULL if not found
+
+    struct fsw_dentry *hash_next;   //!< Next entry in the same hash chain
+    struct fsw_dentry *lru_prev;    //!< Previous (older) entry in the LRU list
+    struct fsw_dentry *lru_next;    //!< Next (newer) entry in the LRU list
+};
+
 /**
  * Core: Stores the mapping of a region of a file to the data on disk.
  */
@@ -302,6 +478,18 @@ struct fsw_shandle {
 
     fsw_u64     pos;                //!< Current file pointer in bytes
     struct fsw_extent extent;       //!< Current extent
+
+    fsw_u8      *ra_buffer;         //!< Read-ahead buffer for sequential reads of file data
+    fsw_u32     ra_size;            //!< Allocated size of the read-ahead buffer in bytes
+    fsw_u64     ra_phys_start;      //!< First physical block held in the read-ahead buffer
+    fsw_u32     ra_count;           //!< Number of physical blocks held in the read-ahead buffer
+    fsw_u32     ra_window;          //!< Size of the next read-ahead in bytes, 0 while reads are not sequential
+    fsw_u64     ra_next_pos;        //!< File position where the next sequential read starts
+    fsw_u8      *ra_async_buffer;   //!< Second read-ahead buffer, filled in the background
+    fsw_u32     ra_async_size;      //!< Allocated size of the second buffer in bytes
+    fsw_u64     ra_async_start;     //!< First physical block of the background read
+    fsw_u32     ra_async_count;     //!< Number of physical blocks in the background read, 0 if none is pending
+    void        *ra_async_token;    //!< Host token for the background read
 };
 
 /**
@@ -343,6 +531,17 @@ struct fsw_host_table
                                      fsw_u32 old_phys_blocksize, fsw_u32 old_log_blocksize,
                                      fsw_u32 new_phys_blocksize, fsw_u32 new_log_blocksize);
     fsw_status_t EFIAPI (*read_block)(struct fsw_volume *vol, fsw_u64 phys_bno, void *buffer);
+    fsw_status_t EFIAPI (*read_blocks)(struct fsw_volume *vol, fsw_u64 phys_bno, fsw_u32 count, void *buffer);
+                                    //!< Optional: read count consecutive blocks in one request, may be NULL
+    fsw_status_t EFIAPI (*read_blocks_async)(struct fsw_volume *vol, fsw_u64 phys_bno, fsw_u32 count, void *buffer,
+                                             void **token_out);
+                                    //!< Optional: start reading count blocks without waiting, may be NULL
+    fsw_status_t EFIAPI (*read_wait)(struct fsw_volume *vol, void *token);
+                                    //!< Wait for a read_blocks_async request and return its status; required with it
+    fsw_status_t EFIAPI (*borrow_block)(struct fsw_volume *vol, fsw_u64 phys_bno, void **buffer_out);
+                                    //!< Optional: lend a pointer to a copy of the block the host already holds, may be NULL
+    void         EFIAPI (*return_block)(struct fsw_volume *vol, fsw_u64 phys_bno, void *buffer);
+                                    //!< Optional: give back a pointer from borrow_block, may be NULL
 };
 
 /**
@@ -386,10 +585,16 @@ fsw_status_t fsw_mount(void *host_data,
                        struct fsw_volume **vol_out);
 void         fsw_unmount(struct fsw_volume *vol);
 fsw_status_t fsw_volume_stat(struct fsw_volume *vol, struct fsw_volume_stat *sb);
+void         fsw_volume_get_io_stats(struct fsw_volume *vol, struct fsw_io_stats *stats);
+void         fsw_volume_reset_io_stats(struct fsw_volume *vol);
 
 void         fsw_set_blocksize(struct VOLSTRUCTNAME *vol, fsw_u32 phys_blocksize, fsw_u32 log_blocksize);
 fsw_status_t fsw_block_get(struct VOLSTRUCTNAME *vol, fsw_u64 phys_bno, fsw_u32 cache_level, void **buffer_out);
 void         fsw_block_release(struct VOLSTRUCTNAME *vol, fsw_u64 phys_bno, void *buffer);
+fsw_status_t fsw_block_read_direct(struct VOLSTRUCTNAME *vol, fsw_u64 phys_bno, fsw_u32 count, void *buffer);
+fsw_status_t fsw_block_read_async(struct VOLSTRUCTNAME *vol, fsw_u64 phys_bno, fsw_u32 count, void *buffer,
+                                  void **token_out);
+fsw_status_t fsw_block_read_wait(struct VOLSTRUCTNAME *vol, void *token);
 
 /*@}*/
 
@@ -420,6 +625,7 @@ fsw_status_t fsw_dnode_dir_read(struct fsw_shandle *shand, struct fsw_dnode **ch
 fsw_status_t fsw_dnode_readlink(struct fsw_dnode *dno, struct fsw_string *link_target);
 fsw_status_t fsw_dnode_readlink_data(struct DNODESTRUCTNAME *dno, struct fsw_string *link_target);
 fsw_status_t fsw_dnode_resolve(struct fsw_dnode *dno, struct fsw_dnode **target_dno_out);
+void         fsw_dnode_cache_extent(struct DNODESTRUCTNAME *dno, struct fsw_extent *extent);
 void fsw_store_time_posix(struct fsw_dnode_stat *sb, int which, fsw_u32 posix_time);
 void fsw_store_attr_posix(struct fsw_dnode_stat *sb, fsw_u16 posix_mode);
 void fsw_store_attr_efi(struct fsw_dnode_stat *sb, fsw_u16 attr);
@@ -447,6 +653,16 @@ fsw_status_t fsw_shandle_read(struct fsw_shandle *shand, fsw_u32 *buffer_size_in
 fsw_status_t fsw_alloc_zero(int len, void **ptr_out);
 fsw_status_t fsw_memdup(void **dest_out, void *src, int len);
 
+void         fsw_slab_init(struct fsw_slab *slab, fsw_u32 obj_size, fsw_u32 chunk_objects);
+fsw_status_t fsw_slab_alloc(struct fsw_slab *slab, void **ptr_out);
+void         fsw_slab_free(struct fsw_slab *slab, void *ptr);
+void         fsw_slab_destroy(struct fsw_slab *slab);
+
+fsw_status_t fsw_arena_alloc(struct fsw_arena *arena, fsw_u32 size, void **ptr_out);
+void         fsw_arena_mark(struct fsw_arena *arena, struct fsw_arena_mark *mark);
+void         fsw_arena_release(struct fsw_arena *arena, struct fsw_arena_mark *mark);
+void         fsw_arena_destroy(struct fsw_arena *arena);
+
 /*@}*/
 
 
@@ -459,6 +675,7 @@ int          fsw_strlen(struct fsw_string *s);
 int          fsw_streq(struct fsw_string *s1, struct fsw_string *s2);
 int          fsw_streq_cstr(struct fsw_string *s1, const char *s2);
 fsw_status_t fsw_strdup_coerce(struct fsw_string *dest, int type, struct fsw_string *src);
+fsw_status_t fsw_strdup_coerce_arena(struct fsw_arena *arena, struct fsw_string *dest, int type, struct fsw_string *src);
 void         fsw_strsplit(struct fsw_string *lookup_name, struct fsw_string *buffer, char separator);
 
 void         fsw_strfree(struct fsw_string *s);
@@ -68,10 +68,12 @@
 EFI_GUID gMyEfiDriverBindingProtocolGuid = REFIND_EFI_DRIVER_BINDING_PROTOCOL_GUID;
 EFI_GUID gMyEfiComponentNameProtocolGuid = REFIND_EFI_COMPONENT_NAME_PROTOCOL_GUID;
 EFI_GUID gMyEfiDiskIoProtocolGuid = REFIND_EFI_DISK_IO_PROTOCOL_GUID;
+EFI_GUID gMyEfiDiskIo2ProtocolGuid = REFIND_EFI_DISK_IO2_PROTOCOL_GUID;
 EFI_GUID gMyEfiBlockIoProtocolGuid = REFIND_EFI_BLOCK_IO_PROTOCOL_GUID;
 EFI_GUID gMyEfiFileInfoGuid = EFI_FILE_INFO_ID;
 EFI_GUID gMyEfiFileSystemInfoGuid = EFI_FILE_SYSTEM_INFO_ID;
 EFI_GUID gMyEfiFileSystemVolumeLabelInfoIdGuid = EFI_FILE_SYSTEM_VOLUME_LABEL_INFO_ID;
+EFI_GUID gFswEfiStatsProtocolGuid = FSW_EFI_STATS_PROTOCOL_GUID;
 
 /** Helper macro for stringification. */
 #define FSW_EFI_STRINGIFY(x) #x
@@ -104,9 +106,27 @@ void EFIAPI fsw_efi_change_blocksize(struct fsw_volume *vol,
                               fsw_u32 old_phys_blocksize, fsw_u32 old_log_blocksize,
                               fsw_u32 new_phys_blocksize, fsw_u32 new_log_blocksize);
 fsw_status_t EFIAPI fsw_efi_read_block(struct fsw_volume *vol, fsw_u64 phys_bno, void *buffer);
+fsw_status_t EFIAPI fsw_efi_read_blocks(struct fsw_volume *vol, fsw_u64 phys_bno, fsw_u32 count, void *buffer);
+fsw_status_t EFIAPI fsw_efi_read_blocks_async(struct fsw_volume *vol, fsw_u64 phys_bno, fsw_u32 count, void *buffer,
+                                              void **token_out);
+fsw_status_t EFIAPI fsw_efi_read_wait(struct fsw_volume *vol, void *token);
+fsw_status_t EFIAPI fsw_efi_borrow_block(struct fsw_volume *vol, fsw_u64 phys_bno, void **buffer_out);
+void EFIAPI fsw_efi_return_block(struct fsw_volume *vol, fsw_u64 phys_bno, void *buffer);
 
 EFI_STATUS fsw_efi_map_status(fsw_status_t fsw_status, FSW_VOLUME_DATA *Volume);
 
+EFI_STATUS EFIAPI fsw_efi_Stats_GetStats(IN FSW_EFI_STATS_PROTOCOL *This,
+                                         OUT struct fsw_io_stats *Stats);
+EFI_STATUS EFIAPI fsw_efi_Stats_ResetStats(IN FSW_EFI_STATS_PROTOCOL *This);
+EFI_STATUS EFIAPI fsw_efi_Stats_GetCacheTrace(IN FSW_EFI_STATS_PROTOCOL *This,
+                                              OUT FSW_EFI_CACHE_TRACE *Trace);
+EFI_STATUS EFIAPI fsw_efi_Stats_GetStatsEx(IN FSW_EFI_STATS_PROTOCOL *This,
+                                           IN OUT UINTN *StatsSize,
+                                           OUT struct fsw_io_stats *Stats);
+EFI_STATUS EFIAPI fsw_efi_Stats_GetCacheTraceEx(IN FSW_EFI_STATS_PROTOCOL *This,
+                                                IN OUT UINTN *TraceSize,
+                                                OUT FSW_EFI_CACHE_TRACE *Trace);
+
 EFI_STATUS EFIAPI fsw_efi_FileSystem_OpenVolume(IN EFI_FILE_IO_INTERFACE *This,
                                                 OUT EFI_FILE **Root);
 EFI_STATUS fsw_efi_dnode_to_FileHandle(IN struct fsw_dnode *dno,
@@ -128,6 +148,8 @@ EFI_STATUS fsw_efi_dir_open(IN FSW_FILE_DATA *File,
 EFI_STATUS fsw_efi_dir_read(IN FSW_FILE_DATA *File,
                             IN OUT UINTN *BufferSize,
                             OUT VOID *Buffer);
+VOID fsw_efi_dir_snapshot_free(IN FSW_VOLUME_DATA *Volume,
+                               IN FSW_EFI_DIR_SNAPSHOT *Snapshot);
 EFI_STATUS fsw_efi_dir_setpos(IN FSW_FILE_DATA *File,
                               IN UINT64 Position);
 
@@ -140,22 +162,6 @@ EFI_STATUS fsw_efi_dnode_fill_FileInfo(IN FSW_VOLUME_DATA *Volume,
                                        IN OUT UINTN *BufferSize,
                                        OUT VOID *Buffer);
 
-/**
- * Structure for holding disk cache data.
- */
-
-#define CACHE_SIZE 131072 /* 128KiB */
-struct cache_data {
-   fsw_u8            *Cache;
-   fsw_u64           CacheStart;
-   BOOLEAN           CacheValid;
-   FSW_VOLUME_DATA   *Volume; // NOTE: Do not deallocate; copied here to ID volume
-};
-
-#define NUM_CACHES 2 /* Don't increase without modifying fsw_efi_read_block() */
-static struct cache_data    Caches[NUM_CACHES];
-static int LastRead = -1;
-
 /**
  * Interface structure for the EFI Driver Binding protocol.
  */
@@ -187,27 +193,76 @@ struct fsw_host_table   fsw_efi_host_table = {
     FSW_STRING_TYPE_UTF16,
 
     fsw_efi_change_blocksize,
-    fsw_efi_read_block
+    fsw_efi_read_block,
+    fsw_efi_read_blocks,
+    fsw_efi_read_blocks_async,
+    fsw_efi_read_wait,
+    fsw_efi_borrow_block,
+    fsw_efi_return_block
 };
 
 extern struct fsw_fstype_table   FSW_FSTYPE_TABLE_NAME(FSTYPE);
 
 
-VOID EFIAPI fsw_efi_clear_cache(VOID) {
-   int i;
+/**
+ * Invalidate all lines of a volume's disk cache. The line buffers are kept
+ * for reuse. Lines with blocks lent to the core stay valid until returned.
+ */
+
+VOID fsw_efi_clear_cache(FSW_VOLUME_DATA *Volume) {
+   UINTN            Set, Way;
+
+   for (Set = 0; Set < FSW_EFI_CACHE_SETS; Set++) {
+      for (Way = 0; Way < FSW_EFI_CACHE_WAYS; Way++) {
+         if (Volume->Cache[Set][Way].Pins > 0)
+            continue;
+         Volume->Cache[Set][Way].Length = 0;
+         Volume->Cache[Set][Way].LastUse = 0;
+      }
+   }
+   Volume->CacheClock = 0;
+   Volume->CacheFillEnd = 0;
+   Volume->StreamLength = 0;
+} // VOID fsw_efi_clear_cache()
+
+/**
+ * Release the line buffers of a volume's disk cache.
+ */
+
+VOID fsw_efi_free_cache(FSW_VOLUME_DATA *Volume) {
+   UINTN            Set, Way;
+
+   for (Set = 0; Set < FSW_EFI_CACHE_SETS; Set++) {
+      for (Way = 0; Way < FSW_EFI_CACHE_WAYS; Way++) {
+         if (Volume->Cache[Set][Way].Data != NULL) {
+            FreePool(Volume->Cache[Set][Way].Data);
+            Volume->Cache[Set][Way].Data = NULL;
+         }
+      }
+   }
+   if (Volume->Stream != NULL) {
+      FreePool(Volume->Stream);
+      Volume->Stream = NULL;
+      Volume->StreamSize = 0;
+   }
+   fsw_efi_clear_cache(Volume);
+} // VOID fsw_efi_free_cache()
+
+/**
+ * Release the events of a volume's background read slots. No reads may be in flight.
+ */
+
+VOID fsw_efi_free_async(FSW_VOLUME_DATA *Volume) {
+   UINTN            i;
 
-   // clear the cache
-   for (i = 0; i < NUM_CACHES; i++) {
-      if (Caches[i].Cache != NULL) {
-         FreePool(Caches[i].Cache);
-         Caches[i].Cache = NULL;
-      } // if
-            Caches[i].CacheStart = 0;
-            Caches[i].CacheValid = FALSE;
-            Caches[i].Volume = NULL;
+   for (i = 0; i < FSW_EFI_ASYNC_SLOTS; i++) {
+      if (Volume->AsyncReads[i].Token.Event != NULL) {
+         refit_call1_wrapper(BS->CloseEvent, Volume->AsyncReads[i].Token.Event);
+         Volume->AsyncReads[i].Token.Event = NULL;
+      }
+      Volume->AsyncReads[i].InUse = FALSE;
    }
-   LastRead = -1;
-} // VOID EFIAPI fsw_efi_clear_cache();
+} // VOID fsw_efi_free_async()
 
 /**
  * Image entry point. Installs the Driver Binding and Component Name protocols
@@ -323,6 +378,7 @@ EFI_STATUS EFIAPI fsw_efi_DriverBinding_Start(IN REFIND_EFI_DRIVER_BINDING_PROTO
     EFI_STATUS          Status;
     EFI_BLOCK_IO        *BlockIo;
     EFI_DISK_IO         *DiskIo;
+    REFIND_EFI_DISK_IO2_PROTOCOL *DiskIo2;
     FSW_VOLUME_DATA     *Volume;
 
 #if DEBUG_LEVEL
@@ -352,13 +408,26 @@ EFI_STATUS EFIAPI fsw_efi_DriverBinding_Start(IN REFIND_EFI_DRIVER_BINDING_PROTO
         return Status;
     }
 
+    // Disk I/O 2 is optional; without it, background reads are done synchronously
+    Status = refit_call6_wrapper(BS->OpenProtocol, ControllerHandle,
+                              &gMyEfiDiskIo2ProtocolGuid,
+                              (VOID **) &DiskIo2,
+                              This->DriverBindingHandle,
+                              ControllerHandle,
+                              EFI_OPEN_PROTOCOL_GET_PROTOCOL);
+    if (EFI_ERROR(Status))
+        DiskIo2 = NULL;
+
     // allocate volume structure
     Volume = AllocateZeroPool(sizeof(FSW_VOLUME_DATA));
     Volume->Signature       = FSW_VOLUME_DATA_SIGNATURE;
     Volume->Handle          = ControllerHandle;
     Volume->DiskIo          = DiskIo;
+    Volume->DiskIo2         = DiskIo2;
     Volume->MediaId         = BlockIo->Media->MediaId;
     Volume->LastIOStatus    = EFI_SUCCESS;
+    Volume->MediaSize       = (UINT64) (BlockIo->Media->LastBlock + 1) * BlockIo->Media->BlockSize;
+    Volume->CacheWindow     = FSW_EFI_CACHE_LINE_SIZE;
 
     // mount the filesystem
     Status = fsw_efi_map_status(fsw_mount(Volume, &fsw_efi_host_table,
@@ -368,9 +437,17 @@ EFI_STATUS EFIAPI fsw_efi_DriverBinding_Start(IN REFIND_EFI_DRIVER_BINDING_PROTO
         // register the SimpleFileSystem protocol
         Volume->FileSystem.Revision     = EFI_FILE_IO_INTERFACE_REVISION;
         Volume->FileSystem.OpenVolume   = fsw_efi_FileSystem_OpenVolume;
-        Status = refit_call4_wrapper(BS->InstallMultipleProtocolInterfaces, &ControllerHandle,
+        Volume->Stats.Revision          = FSW_EFI_STATS_PROTOCOL_REVISION;
+        Volume->Stats.GetStats          = fsw_efi_Stats_GetStats;
+        Volume->Stats.ResetStats        = fsw_efi_Stats_ResetStats;
+        Volume->Stats.GetCacheTrace     = fsw_efi_Stats_GetCacheTrace;
+        Volume->Stats.GetStatsEx        = fsw_efi_Stats_GetStatsEx;
+        Volume->Stats.GetCacheTraceEx   = fsw_efi_Stats_GetCacheTraceEx;
+        Status = refit_call6_wrapper(BS->InstallMultipleProtocolInterfaces, &ControllerHandle,
                                                        &gMyEfiSimpleFileSystemProtocolGuid,
                                                        &Volume->FileSystem,
+                                                       &gFswEfiStatsProtocolGuid,
+                                                       &Volume->Stats,
                                                        NULL);
         if (EFI_ERROR(Status)) {
 //            Print(L"Fsw ERROR: InstallMultipleProtocolInterfaces returned %x\n", Status);
@@ -381,6 +458,10 @@ EFI_STATUS EFIAPI fsw_efi_DriverBinding_Start(IN REFIND_EFI_DRIVER_BINDING_PROTO
     if (EFI_ERROR(Status)) {
         if (Volume->vol != NULL)
             fsw_unmount(Volume->vol);
+        fsw_efi_free_cache(Volume);
+        fsw_efi_free_async(Volume);
+        if (Volume->InfoCache != NULL)
+            FreePool(Volume->InfoCache);
         FreePool(Volume);
 
         refit_call4_wrapper(BS->CloseProtocol, ControllerHandle,
@@ -428,8 +509,9 @@ EFI_STATUS EFIAPI fsw_efi_DriverBinding_Stop(IN  REFIND_EFI_DRIVER_BINDING_PROTO
     Volume = FSW_VOLUME_FROM_FILE_SYSTEM(FileSystem);
 
     // uninstall Simple File System protocol
-    Status = refit_call4_wrapper(BS->UninstallMultipleProtocolInterfaces, ControllerHandle,
+    Status = refit_call6_wrapper(BS->UninstallMultipleProtocolInterfaces, ControllerHandle,
                                                      &gMyEfiSimpleFileSystemProtocolGuid, &Volume->FileSystem,
+                                                     &gFswEfiStatsProtocolGuid, &Volume->Stats,
                                                      NULL);
     if (EFI_ERROR(Status)) {
  //       Print(L"Fsw ERROR: UninstallMultipleProtocolInterfaces returned %x\n", Status);
@@ -442,6 +524,12 @@ EFI_STATUS EFIAPI fsw_efi_DriverBinding_Stop(IN  REFIND_EFI_DRIVER_BINDING_PROTO
     // release private data structure
     if (Volume->vol != NULL)
         fsw_unmount(Volume->vol);
+    fsw_efi_free_cache(Volume);
+    fsw_efi_free_async(Volume);
+    if (Volume->InfoCache != NULL)
+        FreePool(Volume->InfoCache);
+    while (Volume->DirSnapshots != NULL)
+        fsw_efi_dir_snapshot_free(Volume, Volume->DirSnapshots);
     FreePool(Volume);
 
     // close the consumed protocols
@@ -450,9 +538,6 @@ EFI_STATUS EFIAPI fsw_efi_DriverBinding_Stop(IN  REFIND_EFI_DRIVER_BINDING_PROTO
                                This->DriverBindingHandle,
                                ControllerHandle);
 
-    // clear the cache
-    fsw_efi_clear_cache();
-
     return Status;
 }
 
@@ -499,98 +584,325 @@ void EFIAPI fsw_efi_change_blocksize(struct fsw_volume *vol,
                               fsw_u32 old_phys_blocksize, fsw_u32 old_log_blocksize,
                               fsw_u32 new_phys_blocksize, fsw_u32 new_log_blocksize)
 {
-    // nothing to do
+    // the disk cache is addressed by byte offset, so it stays valid
 }
 
 /**
- * FSW interface function to read data blocks. This function is called by the FSW core
- * to read a block of data from the device. The buffer is allocated by the core code.
- * Two caches are maintained, so as to improve performance on some systems. (VirtualBox
- * is particularly susceptible to performance problems with an uncached driver -- the
- * ext2 driver can take 200 seconds to load a Linux kernel under VirtualBox, whereas
- * the time is more like 3 seconds with a cache!) Two independent caches are maintained
- * because the ext2fs driver tends to alternate between accessing two parts of the
- * disk.
+ * Fill the disk cache after a miss on the block at StartRead. The size of the fill
+ * adapts to the access pattern: a miss that continues where the previous fill ended
+ * doubles the window up to FSW_EFI_CACHE_WINDOW_MAX, any other miss halves it down
+ * to the block size. Windows up to a line go into the least recently used line of
+ * the block's set that has no blocks lent out. Larger ones go into the per-volume
+ * staging buffer, so that a long sequential read does not evict the metadata held in
+ * the lines. Returns a pointer to the block's data and the line holding it (NULL for
+ * the staging buffer), or NULL if the fill failed.
  */
 
-fsw_status_t EFIAPI fsw_efi_read_block(struct fsw_volume *vol, fsw_u64 phys_bno, void *buffer) {
-   int              i, ReadCache = -1;
-   FSW_VOLUME_DATA  *Volume = (FSW_VOLUME_DATA *)vol->host_data;
-   EFI_STATUS       Status = EFI_SUCCESS;
-   BOOLEAN          ReadOneBlock = FALSE;
-   UINT64           StartRead = (UINT64) phys_bno * (UINT64) vol->phys_blocksize;
-
-   if (buffer == NULL)
-      return (fsw_status_t) EFI_BAD_BUFFER_SIZE;
-
-   // Initialize static data structures, if necessary....
-   if (LastRead < 0) {
-      fsw_efi_clear_cache();
-   } // if
-
-   // Look for a cache hit on the current query....
-   i = 0;
-   do {
-      if ((Caches[i].Volume == Volume) &&
-          (Caches[i].CacheValid == TRUE) &&
-          (StartRead >= Caches[i].CacheStart) &&
-          ((StartRead + vol->phys_blocksize) <= (Caches[i].CacheStart + CACHE_SIZE))) {
-         ReadCache = i;
+static UINT8 *fsw_efi_cache_fill(FSW_VOLUME_DATA *Volume, FSW_EFI_CACHE_LINE *Set,
+                                 UINT64 StartRead, UINTN BlockSize, FSW_EFI_CACHE_LINE **LineOut)
+{
+   UINTN               i;
+   FSW_EFI_CACHE_LINE  *Line = NULL;
+   EFI_STATUS          Status;
+   UINT64              FillStart;
+   UINTN               FillLength;
+   UINT8               *Dest;
+
+   // Adapt the window to the access pattern....
+   if (StartRead >= Volume->CacheFillEnd && StartRead < Volume->CacheFillEnd + Volume->CacheWindow) {
+      Volume->CacheTrace.SequentialMisses++;
+      if (Volume->CacheWindow < FSW_EFI_CACHE_WINDOW_MAX)
+         Volume->CacheWindow <<= 1;
+   } else {
+      Volume->CacheTrace.RandomMisses++;
+      if (Volume->CacheWindow > BlockSize)
+         Volume->CacheWindow >>= 1;
+   }
+   if (Volume->CacheWindow < BlockSize)
+      Volume->CacheWindow = BlockSize;
+   FillLength = Volume->CacheWindow;
+
+   if (FillLength <= FSW_EFI_CACHE_LINE_SIZE) {
+      // replace an empty or the least recently used line of the set
+      for (i = 0; i < FSW_EFI_CACHE_WAYS && (Line == NULL || Line->Length > 0); i++) {
+         if (Set[i].Pins == 0 && (Line == NULL || Set[i].Length == 0 || Set[i].LastUse < Line->LastUse))
+            Line = &Set[i];
       }
-      i++;
-   } while ((i < NUM_CACHES) && (ReadCache < 0));
-
-   // No cache hit found; load new cache and pass it on....
-   if (ReadCache < 0) {
-      if (LastRead == -1)
-         LastRead = 1;
-      ReadCache = 1 - LastRead; // NOTE: If NUM_CACHES > 2, this must become more complex
-      Caches[ReadCache].CacheValid = FALSE;
-      if (Caches[ReadCache].Cache == NULL)
-         Caches[ReadCache].Cache = AllocatePool(CACHE_SIZE);
-      if (Caches[ReadCache].Cache != NULL) {
-         // TODO: Below call hangs on my 32-bit Mac Mini when compiled with GNU-EFI.
-         // The same binary is fine under VirtualBox, and the same call is fine when
-         // compiled with Tianocore. Further clue: Omitting "Status =" avoids the
-         // hang but produces a failure to mount the filesystem, even when the same
-         // change is made to later similar call. Calling Volume->DiskIo->ReadDisk()
-         // directly (without refit_call5_wrapper()) changes nothing. Placing Print()
-         // statements at the start and end of the function, and before and after the
-         // ReadDisk() call, suggests that when it fails, the program is executing
-         // code starting mid-function, so there seems to be something messed up in
-         // the way the function is being called. FIGURE THIS OUT!
-         Status = refit_call5_wrapper(Volume->DiskIo->ReadDisk, Volume->DiskIo, Volume->MediaId,
-                                      StartRead, (UINTN) CACHE_SIZE, (VOID*) Caches[ReadCache].Cache);
-         if (!EFI_ERROR(Status)) {
-            Caches[ReadCache].CacheStart = StartRead;
-            Caches[ReadCache].CacheValid = TRUE;
-            Caches[ReadCache].Volume = Volume;
-            LastRead = ReadCache;
-         } else {
-            ReadOneBlock = TRUE;
-         }
-      } else {
-         ReadOneBlock = TRUE;
-      } // if cache memory allocated
-   } // if (ReadCache < 0)
+      if (Line == NULL)
+         return NULL;
+      Line->Length = 0;
+      if (Line->Data == NULL)
+         Line->Data = AllocatePool(FSW_EFI_CACHE_LINE_SIZE);
+      Dest = Line->Data;
+      FillStart = StartRead & ~((UINT64) FillLength - 1);
+   } else {
+      Volume->StreamLength = 0;
+      if (Volume->StreamSize < FillLength) {
+         if (Volume->Stream != NULL)
+            FreePool(Volume->Stream);
+         Volume->Stream = AllocatePool(FillLength);
+         Volume->StreamSize = (Volume->Stream != NULL) ? FillLength : 0;
+      }
+      Dest = Volume->Stream;
+      FillStart = StartRead;
+   }
+   if (Dest == NULL) {
+      Volume->CacheWindow = FSW_EFI_CACHE_LINE_SIZE;
+      return NULL;
+   }
 
-   if (Caches[ReadCache].Cache != NULL && Caches[ReadCache].CacheValid == TRUE && vol->phys_blocksize > 0) {
-      CopyMem(buffer, &Caches[ReadCache].Cache[StartRead - Caches[ReadCache].CacheStart], vol->phys_blocksize);
+   // don't read past the end of the device
+   if (Volume->MediaSize > FillStart && Volume->MediaSize - FillStart < FillLength)
+      FillLength = (UINTN) (Volume->MediaSize - FillStart);
+   if (StartRead + BlockSize > FillStart + FillLength)
+      return NULL;
+
+   // TODO: Below call hangs on my 32-bit Mac Mini when compiled with GNU-EFI.
+   // The same binary is fine under VirtualBox, and the same call is fine when
+   // compiled with Tianocore. Further clue: Omitting "Status =" avoids the
+   // hang but produces a failure to mount the filesystem, even when the same
+   // change is made to later similar call. Calling Volume->DiskIo->ReadDisk()
+   // directly (without refit_call5_wrapper()) changes nothing. Placing Print()
+   // statements at the start and end of the function, and before and after the
+   // ReadDisk() call, suggests that when it fails, the program is executing
+   // code starting mid-function, so there seems to be something messed up in
+   // the way the function is being called. FIGURE THIS OUT!
+   Status = refit_call5_wrapper(Volume->DiskIo->ReadDisk, Volume->DiskIo, Volume->MediaId,
+                                FillStart, FillLength, (VOID*) Dest);
+   if (EFI_ERROR(Status))
+      return NULL;
+   Volume->CacheTrace.Fills++;
+   Volume->CacheTrace.FillBytes += FillLength;
+   Volume->CacheFillEnd = FillStart + FillLength;
+
+   if (Line != NULL) {
+      Line->Start = FillStart;
+      Line->Length = FillLength;
+      Line->LastUse = ++Volume->CacheClock;
    } else {
-      ReadOneBlock = TRUE;
+      Volume->StreamStart = FillStart;
+      Volume->StreamLength = FillLength;
+   }
+   *LineOut = Line;
+   return Dest + (UINTN) (StartRead - FillStart);
+} // static UINT8 *fsw_efi_cache_fill()
+
+/**
+ * Find the block at StartRead in the disk cache. If Fill is set, the staging buffer is
+ * searched too and the cache is filled on a miss; otherwise only the lines are searched.
+ * Returns a pointer to the block's data and the line holding it (NULL for the staging
+ * buffer), or NULL if the block straddles two lines, is not cached or the fill failed.
+ * See fsw_efi_read_block for how the cache is organized.
+ */
+
+static UINT8 *fsw_efi_cache_lookup(FSW_VOLUME_DATA *Volume, UINT64 StartRead, UINTN BlockSize,
+                                   BOOLEAN Fill, FSW_EFI_CACHE_LINE **LineOut)
+{
+   UINTN               i;
+   FSW_EFI_CACHE_LINE  *Set;
+   UINT64              LineStart = StartRead & ~((UINT64) FSW_EFI_CACHE_LINE_SIZE - 1);
+
+   *LineOut = NULL;
+
+   // Blocks that would straddle two lines bypass the cache....
+   if (BlockSize == 0 || StartRead + BlockSize > LineStart + FSW_EFI_CACHE_LINE_SIZE)
+      return NULL;
+   Set = Volume->Cache[(UINTN) (StartRead >> FSW_EFI_CACHE_LINE_SHIFT) % FSW_EFI_CACHE_SETS];
+
+   // Look for a cache hit in the lines of the set, then in the staging buffer....
+   for (i = 0; i < FSW_EFI_CACHE_WAYS; i++) {
+      if (Set[i].Length > 0 && StartRead >= Set[i].Start &&
+          StartRead + BlockSize <= Set[i].Start + Set[i].Length) {
+         Volume->CacheTrace.Hits++;
+         Set[i].LastUse = ++Volume->CacheClock;
+         *LineOut = &Set[i];
+         return Set[i].Data + (UINTN) (StartRead - Set[i].Start);
+      }
+   }
+   if (!Fill)
+      return NULL;
+   if (Volume->StreamLength > 0 && StartRead >= Volume->StreamStart &&
+       StartRead + BlockSize <= Volume->StreamStart + Volume->StreamLength) {
+      Volume->CacheTrace.StreamHits++;
+      return Volume->Stream + (UINTN) (StartRead - Volume->StreamStart);
    }
 
-   if (ReadOneBlock) { // Something's failed, so try a simple disk read of one block....
+   // No cache hit found; load new data and pass it on....
+   return fsw_efi_cache_fill(Volume, Set, StartRead, BlockSize, LineOut);
+} // static UINT8 *fsw_efi_cache_lookup()
+
+/**
+ * FSW interface function to read data blocks. This function is called by the FSW core
+ * to read a block of data from the device. The buffer is allocated by the core code.
+ * Reads go through a per-volume disk cache so as to improve performance on some systems.
+ * (VirtualBox is particularly susceptible to performance problems with an uncached
+ * driver -- the ext2 driver can take 200 seconds to load a Linux kernel under VirtualBox,
+ * whereas the time is more like 3 seconds with a cache!) The cache is set-associative:
+ * each line holds data from an aligned FSW_EFI_CACHE_LINE_SIZE window of the disk, the
+ * window number selects the set, and the least recently used line of the set is replaced
+ * on a miss. Keeping several lines per set lets the driver alternate between metadata
+ * areas, and keeping the cache per volume stops a scan of several volumes from
+ * thrashing it. See fsw_efi_cache_fill for how much is read on a miss.
+ */
+
+fsw_status_t EFIAPI fsw_efi_read_block(struct fsw_volume *vol, fsw_u64 phys_bno, void *buffer) {
+   FSW_VOLUME_DATA     *Volume = (FSW_VOLUME_DATA *)vol->host_data;
+   FSW_EFI_CACHE_LINE  *Line;
+   EFI_STATUS          Status;
+   UINTN               BlockSize = vol->phys_blocksize;
+   UINT64              StartRead = (UINT64) phys_bno * (UINT64) BlockSize;
+   UINT8               *Source;
+
+   if (buffer == NULL)
+      return FSW_IO_ERROR;
+
+   Source = fsw_efi_cache_lookup(Volume, StartRead, BlockSize, TRUE, &Line);
+   if (Source != NULL) {
+      CopyMem(buffer, Source, BlockSize);
+      Status = EFI_SUCCESS;
+   } else { // Something's failed, so try a simple disk read of one block....
+      Volume->CacheTrace.DirectReads++;
       Status = refit_call5_wrapper(Volume->DiskIo->ReadDisk, Volume->DiskIo, Volume->MediaId,
-                                   phys_bno * vol->phys_blocksize,
-                                   (UINTN) vol->phys_blocksize,
+                                   StartRead,
+                                   BlockSize,
                                    (VOID*) buffer);
    }
    Volume->LastIOStatus = Status;
-
-   return Status;
+   if (EFI_ERROR(Status))
+      return FSW_IO_ERROR;
+   return FSW_SUCCESS;
 } // fsw_status_t *fsw_efi_read_block()
 
+/**
+ * FSW interface function to lend a block to the FSW core instead of copying it into
+ * the core's block cache. Only blocks already held in a cache line are lent; the line
+ * is pinned until the block is returned, so fills pass it over. Other blocks are
+ * refused without touching the disk. The core then reads them with read_block and
+ * keeps them in its own block cache, which is much larger than the disk cache.
+ */
+
+fsw_status_t EFIAPI fsw_efi_borrow_block(struct fsw_volume *vol, fsw_u64 phys_bno, void **buffer_out) {
+   FSW_VOLUME_DATA     *Volume = (FSW_VOLUME_DATA *)vol->host_data;
+   FSW_EFI_CACHE_LINE  *Line;
+   UINT8               *Source;
+
+   Source = fsw_efi_cache_lookup(Volume, (UINT64) phys_bno * vol->phys_blocksize, vol->phys_blocksize,
+                                 FALSE, &Line);
+   if (Source == NULL || Line == NULL)
+      return FSW_UNSUPPORTED;
+   Line->Pins++;
+   Volume->CacheTrace.Lent++;
+   *buffer_out = Source;
+   return FSW_SUCCESS;
+} // fsw_status_t EFIAPI fsw_efi_borrow_block()
+
+/**
+ * FSW interface function to take back a block lent by fsw_efi_borrow_block.
+ */
+
+void EFIAPI fsw_efi_return_block(struct fsw_volume *vol, fsw_u64 phys_bno, void *buffer) {
+   FSW_VOLUME_DATA     *Volume = (FSW_VOLUME_DATA *)vol->host_data;
+   FSW_EFI_CACHE_LINE  *Set;
+   UINT64              StartRead = (UINT64) phys_bno * vol->phys_blocksize;
+   UINTN               i;
+
+   Set = Volume->Cache[(UINTN) (StartRead >> FSW_EFI_CACHE_LINE_SHIFT) % FSW_EFI_CACHE_SETS];
+   for (i = 0; i < FSW_EFI_CACHE_WAYS; i++) {
+      if (Set[i].Pins > 0 && (UINT8 *) buffer >= Set[i].Data &&
+          (UINT8 *) buffer < Set[i].Data + Set[i].Length) {
+         Set[i].Pins--;
+         return;
+      }
+   }
+} // void EFIAPI fsw_efi_return_block()
+
+/**
+ * FSW interface function to read a run of consecutive data blocks in one request.
+ * This is used by the FSW core for bulk file data, which goes straight into the
+ * caller's buffer and therefore bypasses the disk cache of fsw_efi_read_block.
+ */
+
+fsw_status_t EFIAPI fsw_efi_read_blocks(struct fsw_volume *vol, fsw_u64 phys_bno, fsw_u32 count, void *buffer) {
+   FSW_VOLUME_DATA  *Volume = (FSW_VOLUME_DATA *)vol->host_data;
+   EFI_STATUS       Status;
+
+   Status = refit_call5_wrapper(Volume->DiskIo->ReadDisk, Volume->DiskIo, Volume->MediaId,
+                                phys_bno * vol->phys_blocksize,
+                                (UINTN) count * vol->phys_blocksize,
+                                (VOID*) buffer);
+   Volume->LastIOStatus = Status;
+   if (EFI_ERROR(Status))
+      return FSW_IO_ERROR;
+   return FSW_SUCCESS;
+} // fsw_status_t EFIAPI fsw_efi_read_blocks()
+
+/**
+ * FSW interface function to start reading a run of consecutive data blocks without
+ * waiting for the data. Where the firmware provides the Disk I/O 2 protocol, the
+ * request is queued with ReadDiskEx so that the transfer overlaps with the work of
+ * the FSW core; devices such as NVMe drives can then keep several requests in flight.
+ * Without Disk I/O 2, or when all of the volume's slots are busy, the blocks are read
+ * synchronously and no token is returned.
+ */
+
+fsw_status_t EFIAPI fsw_efi_read_blocks_async(struct fsw_volume *vol, fsw_u64 phys_bno, fsw_u32 count, void *buffer,
+                                              void **token_out) {
+   FSW_VOLUME_DATA     *Volume = (FSW_VOLUME_DATA *)vol->host_data;
+   FSW_EFI_ASYNC_READ  *Request = NULL;
+   EFI_STATUS          Status;
+   UINTN               i;
+
+   *token_out = NULL;
+   if (Volume->DiskIo2 != NULL) {
+      for (i = 0; i < FSW_EFI_ASYNC_SLOTS; i++) {
+         if (!Volume->AsyncReads[i].InUse) {
+            Request = &Volume->AsyncReads[i];
+            break;
+         }
+      }
+   }
+   if (Request != NULL && Request->Token.Event == NULL) {
+      Status = refit_call5_wrapper(BS->CreateEvent, 0, TPL_CALLBACK, NULL, NULL, &Request->Token.Event);
+      if (EFI_ERROR(Status)) {
+         Request->Token.Event = NULL;
+         Request = NULL;
+      }
+   }
+   if (Request == NULL)
+      return fsw_efi_read_blocks(vol, phys_bno, count, buffer);
+
+   Request->Token.TransactionStatus = EFI_SUCCESS;
+   Status = refit_call6_wrapper(Volume->DiskIo2->ReadDiskEx, Volume->DiskIo2, Volume->MediaId,
+                                phys_bno * vol->phys_blocksize, &Request->Token,
+                                (UINTN) count * vol->phys_blocksize,
+                                (VOID*) buffer);
+   if (EFI_ERROR(Status)) {
+      Volume->LastIOStatus = Status;
+      return FSW_IO_ERROR;
+   }
+   Request->InUse = TRUE;
+   *token_out = Request;
+   return FSW_SUCCESS;
+} // fsw_status_t EFIAPI fsw_efi_read_blocks_async()
+
+/**
+ * FSW interface function to wait for a read started by fsw_efi_read_blocks_async.
+ * The event is polled because WaitForEvent is only allowed at TPL_APPLICATION.
+ */
+
+fsw_status_t EFIAPI fsw_efi_read_wait(struct fsw_volume *vol, void *token) {
+   FSW_VOLUME_DATA     *Volume = (FSW_VOLUME_DATA *)vol->host_data;
+   FSW_EFI_ASYNC_READ  *Request = (FSW_EFI_ASYNC_READ *)token;
+
+   while (refit_call1_wrapper(BS->CheckEvent, Request->Token.Event) == EFI_NOT_READY)
+      ;
+   Request->InUse = FALSE;
+   Volume->LastIOStatus = Request->Token.TransactionStatus;
+   if (EFI_ERROR(Request->Token.TransactionStatus))
+      return FSW_IO_ERROR;
+   return FSW_SUCCESS;
+} // fsw_status_t EFIAPI fsw_efi_read_wait()
+
 /**
  * Map FSW status codes to EFI status codes. The FSW_IO_ERROR code is only produced
  * by fsw_efi_read_block, so we map it back to the EFI status code remembered from
@@ -617,6 +929,91 @@ EFI_STATUS fsw_efi_map_status(fsw_status_t fsw_status, FSW_VOLUME_DATA *Volume)
     }
 }
 
+/**
+ * Statistics protocol, GetStats function. Copies the I/O and cache counters
+ * of the volume into the caller's structure, as far as they existed in revision
+ * 0x00010001 of the protocol.
+ */
+
+EFI_STATUS EFIAPI fsw_efi_Stats_GetStats(IN FSW_EFI_STATS_PROTOCOL *This,
+                                         OUT struct fsw_io_stats *Stats)
+{
+    UINTN           StatsSize = FSW_EFI_IO_STATS_SIZE_V1;
+
+    return fsw_efi_Stats_GetStatsEx(This, &StatsSize, Stats);
+}
+
+/**
+ * Statistics protocol, GetStatsEx function. Copies the I/O and cache counters
+ * of the volume into the caller's structure, but at most *StatsSize bytes. On
+ * return, *StatsSize holds the full size of the driver's structure.
+ */
+
+EFI_STATUS EFIAPI fsw_efi_Stats_GetStatsEx(IN FSW_EFI_STATS_PROTOCOL *This,
+                                           IN OUT UINTN *StatsSize,
+                                           OUT struct fsw_io_stats *Stats)
+{
+    FSW_VOLUME_DATA *Volume = FSW_VOLUME_FROM_STATS(This);
+    struct fsw_io_stats io;
+
+    if (StatsSize == NULL || Stats == NULL)
+        return EFI_INVALID_PARAMETER;
+    fsw_volume_get_io_stats(Volume->vol, &io);
+    CopyMem(Stats, &io, *StatsSize < sizeof(io) ? *StatsSize : sizeof(io));
+    *StatsSize = sizeof(io);
+    return EFI_SUCCESS;
+}
+
+/**
+ * Statistics protocol, ResetStats function. Zeroes all counters of the volume.
+ */
+
+EFI_STATUS EFIAPI fsw_efi_Stats_ResetStats(IN FSW_EFI_STATS_PROTOCOL *This)
+{
+    FSW_VOLUME_DATA *Volume = FSW_VOLUME_FROM_STATS(This);
+
+    fsw_volume_reset_io_stats(Volume->vol);
+    ZeroMem(&Volume->CacheTrace, sizeof(FSW_EFI_CACHE_TRACE));
+    return EFI_SUCCESS;
+}
+
+/**
+ * Statistics protocol, GetCacheTrace function. Copies the disk cache counters
+ * of the volume, including the current fill window, into the caller's structure,
+ * as far as they existed in revision 0x00010001 of the protocol.
+ */
+
+EFI_STATUS EFIAPI fsw_efi_Stats_GetCacheTrace(IN FSW_EFI_STATS_PROTOCOL *This,
+                                              OUT FSW_EFI_CACHE_TRACE *Trace)
+{
+    UINTN           TraceSize = FSW_EFI_CACHE_TRACE_SIZE_V1;
+
+    return fsw_efi_Stats_GetCacheTraceEx(This, &TraceSize, Trace);
+}
+
+/**
+ * Statistics protocol, GetCacheTraceEx function. Copies the disk cache counters
+ * of the volume, including the current fill window, into the caller's structure,
+ * but at most *TraceSize bytes. On return, *TraceSize holds the full size of the
+ * driver's structure.
+ */
+
+EFI_STATUS EFIAPI fsw_efi_Stats_GetCacheTraceEx(IN FSW_EFI_STATS_PROTOCOL *This,
+                                                IN OUT UINTN *TraceSize,
+                                                OUT FSW_EFI_CACHE_TRACE *Trace)
+{
+    FSW_VOLUME_DATA     *Volume = FSW_VOLUME_FROM_STATS(This);
+    FSW_EFI_CACHE_TRACE CacheTrace;
+
+    if (TraceSize == NULL || Trace == NULL)
+        return EFI_INVALID_PARAMETER;
+    CopyMem(&CacheTrace, &Volume->CacheTrace, sizeof(FSW_EFI_CACHE_TRACE));
+    CacheTrace.Window = Volume->CacheWindow;
+    CopyMem(Trace, &CacheTrace, *TraceSize < sizeof(CacheTrace) ? *TraceSize : sizeof(CacheTrace));
+    *TraceSize = sizeof(CacheTrace);
+    return EFI_SUCCESS;
+}
+
 /**
  * File System EFI protocol, OpenVolume function. Creates a file handle for
  * the root directory and returns it. Note that this function may be called
@@ -634,7 +1031,7 @@ EFI_STATUS EFIAPI fsw_efi_FileSystem_OpenVolume(IN EFI_FILE_IO_INTERFACE *This,
     Print(L"fsw_efi_FileSystem_OpenVolume\n");
 #endif
 
-    fsw_efi_clear_cache();
+    fsw_efi_clear_cache(Volume);
     Status = fsw_efi_dnode_to_FileHandle(Volume->vol->root, Root);
 
     return Status;
@@ -672,6 +1069,8 @@ EFI_STATUS EFIAPI fsw_efi_FileHandle_Close(IN EFI_FILE *This)
     Print(L"fsw_efi_FileHandle_Close\n");
 #endif
 
+    if (File->Snapshot != NULL)
+        File->Snapshot->RefCount--;
     fsw_shandle_close(&File->shand);
     FreePool(File);
 
@@ -952,9 +1351,127 @@ EFI_STATUS fsw_efi_dir_open(IN FSW_FILE_DATA *File,
     return Status;
 }
 
+/**
+ * Unlink a directory snapshot from its volume and free it.
+ */
+
+VOID fsw_efi_dir_snapshot_free(IN FSW_VOLUME_DATA *Volume,
+                               IN FSW_EFI_DIR_SNAPSHOT *Snapshot)
+{
+    FSW_EFI_DIR_SNAPSHOT **Link;
+
+    for (Link = &Volume->DirSnapshots; *Link != NULL; Link = &(*Link)->Next) {
+        if (*Link == Snapshot) {
+            *Link = Snapshot->Next;
+            break;
+        }
+    }
+    if (Snapshot->Data != NULL)
+        FreePool(Snapshot->Data);
+    FreePool(Snapshot);
+}
+
+/**
+ * Get a snapshot of all entries of a directory and take a reference to it.
+ * An existing snapshot of the same directory is reused. Otherwise the directory
+ * is read once through the file system driver, and the least recently used
+ * unreferenced snapshot is dropped if the volume already holds
+ * FSW_EFI_DIR_SNAPSHOT_COUNT of them. Returns NULL if the listing would exceed
+ * FSW_EFI_DIR_SNAPSHOT_MAX_SIZE or on errors; the caller then reads entries
+ * one at a time.
+ */
+
+static FSW_EFI_DIR_SNAPSHOT *fsw_efi_dir_snapshot_get(IN FSW_VOLUME_DATA *Volume,
+                                                      IN struct fsw_dnode *dno)
+{
+    EFI_STATUS          Status;
+    FSW_EFI_DIR_SNAPSHOT *Snapshot, *Victim = NULL;
+    UINTN               Count = 0;
+    UINTN               Capacity = 0, NewCapacity, RecordSize;
+    UINT8               *NewData;
+    struct fsw_shandle  shand;
+    struct fsw_dnode    *child;
+
+    // look for an existing snapshot, noting the replacement candidate on the way
+    for (Snapshot = Volume->DirSnapshots; Snapshot != NULL; Snapshot = Snapshot->Next) {
+        if (Snapshot->TreeId == dno->tree_id && Snapshot->DnodeId == dno->dnode_id) {
+            Snapshot->RefCount++;
+            Snapshot->LastUse = ++Volume->DirSnapshotClock;
+            return Snapshot;
+        }
+        if (Snapshot->RefCount == 0 && (Victim == NULL || Snapshot->LastUse < Victim->LastUse))
+            Victim = Snapshot;
+        Count++;
+    }
+    if (Count >= FSW_EFI_DIR_SNAPSHOT_COUNT && Victim != NULL)
+        fsw_efi_dir_snapshot_free(Volume, Victim);
+
+    Snapshot = AllocateZeroPool(sizeof(FSW_EFI_DIR_SNAPSHOT));
+    if (Snapshot == NULL)
+        return NULL;
+    if (fsw_shandle_open(dno, &shand) != FSW_SUCCESS) {
+        FreePool(Snapshot);
+        return NULL;
+    }
+
+    // read all entries, growing the record buffer as needed
+    for (;;) {
+        Status = fsw_efi_map_status(fsw_dnode_dir_read(&shand, &child), Volume);
+        if (Status == EFI_NOT_FOUND) {
+            Status = EFI_SUCCESS;
+            break;
+        }
+        if (EFI_ERROR(Status))
+            break;
+
+        RecordSize = Capacity - Snapshot->Size;
+        Status = fsw_efi_dnode_fill_FileInfo(Volume, child, &RecordSize, Snapshot->Data + Snapshot->Size);
+        if (Status == EFI_BUFFER_TOO_SMALL) {
+            NewCapacity = (Capacity > 0) ? (Capacity << 1) : 4096;
+            while (NewCapacity < Snapshot->Size + RecordSize)
+                NewCapacity <<= 1;
+            NewData = (NewCapacity <= FSW_EFI_DIR_SNAPSHOT_MAX_SIZE) ? AllocatePool(NewCapacity) : NULL;
+            if (NewData == NULL) {
+                Status = EFI_OUT_OF_RESOURCES;
+            } else {
+                if (Snapshot->Data != NULL) {
+                    CopyMem(NewData, Snapshot->Data, Snapshot->Size);
+                    FreePool(Snapshot->Data);
+                }
+                Snapshot->Data = NewData;
+                Capacity = NewCapacity;
+                RecordSize = Capacity - Snapshot->Size;
+                Status = fsw_efi_dnode_fill_FileInfo(Volume, child, &RecordSize, Snapshot->Data + Snapshot->Size);
+            }
+        }
+        fsw_dnode_release(child);
+        if (EFI_ERROR(Status))
+            break;
+        Snapshot->Size += (RecordSize + 7) & ~((UINTN) 7);
+    }
+    fsw_shandle_close(&shand);
+
+    if (EFI_ERROR(Status)) {
+        if (Snapshot->Data != NULL)
+            FreePool(Snapshot->Data);
+        FreePool(Snapshot);
+        return NULL;
+    }
+
+    Snapshot->TreeId   = dno->tree_id;
+    Snapshot->DnodeId  = dno->dnode_id;
+    Snapshot->RefCount = 1;
+    Snapshot->LastUse  = ++Volume->DirSnapshotClock;
+    Snapshot->Next     = Volume->DirSnapshots;
+    Volume->DirSnapshots = Snapshot;
+    return Snapshot;
+}
+
 /**
  * Read function for directories. A file handle read on a directory retrieves
- * the next directory entry.
+ * the next directory entry. A read at the start of the directory takes a
+ * snapshot of all entries, so that the rest of this enumeration and later
+ * enumerations of the same directory are served from memory.
  */
 
 EFI_STATUS fsw_efi_dir_read(IN FSW_FILE_DATA *File,
@@ -964,11 +1481,37 @@ EFI_STATUS fsw_efi_dir_read(IN FSW_FILE_DATA *File,
     EFI_STATUS          Status;
     FSW_VOLUME_DATA     *Volume = (FSW_VOLUME_DATA *)File->shand.dnode->vol->host_data;
     struct fsw_dnode    *dno;
+    EFI_FILE_INFO       *FileInfo;
 
 #if DEBUG_LEVEL
     Print(L"fsw_efi_dir_read...\n");
 #endif
 
+    if (File->Snapshot == NULL && !File->NoSnapshot && File->shand.pos == 0 &&
+        FSW_EFI_DIR_SNAPSHOT_MAX_SIZE > 0) {
+        File->Snapshot = fsw_efi_dir_snapshot_get(Volume, File->shand.dnode);
+        File->SnapshotPos = 0;
+        if (File->Snapshot == NULL)
+            File->NoSnapshot = TRUE;
+    }
+
+    if (File->Snapshot != NULL) {
+        if (File->SnapshotPos >= File->Snapshot->Size) {
+            // end of directory
+            *BufferSize = 0;
+            return EFI_SUCCESS;
+        }
+        FileInfo = (EFI_FILE_INFO *)(File->Snapshot->Data + File->SnapshotPos);
+        if (*BufferSize < FileInfo->Size) {
+            *BufferSize = (UINTN) FileInfo->Size;
+            return EFI_BUFFER_TOO_SMALL;
+        }
+        CopyMem(Buffer, FileInfo, (UINTN) FileInfo->Size);
+        *BufferSize = (UINTN) FileInfo->Size;
+        File->SnapshotPos += ((UINTN) FileInfo->Size + 7) & ~((UINTN) 7);
+        return EFI_SUCCESS;
+    }
+
     // read the next entry
     Status = fsw_efi_map_status(fsw_dnode_dir_read(&File->shand, &dno), Volume);
     if (Status == EFI_NOT_FOUND) {
@@ -998,6 +1541,7 @@ EFI_STATUS fsw_efi_dir_setpos(IN FSW_FILE_DATA *File, IN UINT64 Position)
 {
     if (Position == 0) {
         File->shand.pos = 0;
+        File->SnapshotPos = 0;
         return EFI_SUCCESS;
     } else {
         // directories can only rewind to the start
@@ -1126,8 +1670,31 @@ void fsw_store_attr_efi(struct fsw_dnode_stat *sb, fsw_u16 attr)
     FileInfo->Attribute |= attr;
 }
 
+/**
+ * Find the slot of the per-volume file information cache that a dnode maps to.
+ * The table is allocated on first use. Returns NULL if that fails.
+ */
+
+static FSW_EFI_INFO_CACHE_ENTRY *fsw_efi_info_cache_slot(IN FSW_VOLUME_DATA *Volume,
+                                                         IN struct fsw_dnode *dno)
+{
+    UINTN               Index;
+
+    if (Volume->InfoCache == NULL) {
+        Volume->InfoCache = AllocateZeroPool(FSW_EFI_INFO_CACHE_SIZE * sizeof(FSW_EFI_INFO_CACHE_ENTRY));
+        if (Volume->InfoCache == NULL)
+            return NULL;
+    }
+    Index = (UINTN) (dno->dnode_id ^ (dno->tree_id << 7)) % FSW_EFI_INFO_CACHE_SIZE;
+    return &Volume->InfoCache[Index];
+}
+
 /**
  * Common function to fill an EFI_FILE_INFO with information about a dnode.
+ * Everything except the file name is kept in a per-volume cache keyed by the
+ * dnode's id, because the same files are queried many times during a scan and
+ * each fill and stat may cost a tree lookup in the file system driver. The
+ * volume is read-only, so the cache stays valid until the driver is stopped.
  */
 
 EFI_STATUS fsw_efi_dnode_fill_FileInfo(IN FSW_VOLUME_DATA *Volume,
@@ -1139,11 +1706,19 @@ EFI_STATUS fsw_efi_dnode_fill_FileInfo(IN FSW_VOLUME_DATA *Volume,
     EFI_FILE_INFO       *FileInfo;
     UINTN               RequiredSize;
     struct fsw_dnode_stat sb;
+    FSW_EFI_INFO_CACHE_ENTRY *Entry;
+    BOOLEAN             Cached;
+
+    Entry = fsw_efi_info_cache_slot(Volume, dno);
+    Cached = (Entry != NULL && Entry->Valid &&
+              Entry->TreeId == dno->tree_id && Entry->DnodeId == dno->dnode_id);
 
     // make sure the dnode has complete info
-    Status = fsw_efi_map_status(fsw_dnode_fill(dno), Volume);
-    if (EFI_ERROR(Status))
-        return Status;
+    if (!Cached) {
+        Status = fsw_efi_map_status(fsw_dnode_fill(dno), Volume);
+        if (EFI_ERROR(Status))
+            return Status;
+    }
 
     // TODO: check/assert that the dno's name is in UTF16
 
@@ -1163,19 +1738,42 @@ EFI_STATUS fsw_efi_dnode_fill_FileInfo(IN FSW_VOLUME_DATA *Volume,
     ZeroMem(Buffer, RequiredSize);
     FileInfo = (EFI_FILE_INFO *)Buffer;
     FileInfo->Size = RequiredSize;
-    FileInfo->FileSize          = dno->size;
-    FileInfo->Attribute         = 0;
-    if (dno->type == FSW_DNODE_TYPE_DIR)
-        FileInfo->Attribute    |= EFI_FILE_DIRECTORY;
     fsw_efi_strcpy(FileInfo->FileName, &dno->name);
 
-    // get the missing info from the fs driver
-    ZeroMem(&sb, sizeof(struct fsw_dnode_stat));
-    sb.host_data = FileInfo;
-    Status = fsw_efi_map_status(fsw_dnode_stat(dno, &sb), Volume);
-    if (EFI_ERROR(Status))
-        return Status;
-    FileInfo->PhysicalSize      = sb.used_bytes;
+    if (Cached) {
+        FileInfo->FileSize          = Entry->FileSize;
+        FileInfo->PhysicalSize      = Entry->PhysicalSize;
+        FileInfo->CreateTime        = Entry->CreateTime;
+        FileInfo->LastAccessTime    = Entry->LastAccessTime;
+        FileInfo->ModificationTime  = Entry->ModificationTime;
+        FileInfo->Attribute         = Entry->Attribute;
+    } else {
+        FileInfo->FileSize          = dno->size;
+        FileInfo->Attribute         = 0;
+        if (dno->type == FSW_DNODE_TYPE_DIR)
+            FileInfo->Attribute    |= EFI_FILE_DIRECTORY;
+
+        // get the missing info from the fs driver
+        ZeroMem(&sb, sizeof(struct fsw_dnode_stat));
+        sb.host_data = FileInfo;
+        Status = fsw_efi_map_status(fsw_dnode_stat(dno, &sb), Volume);
+        if (EFI_ERROR(Status))
+            return Status;
+        FileInfo->PhysicalSize      = sb.used_bytes;
+
+        // remember everything but the name
+        if (Entry != NULL) {
+            Entry->Valid            = TRUE;
+            Entry->TreeId           = dno->tree_id;
+            Entry->DnodeId          = dno->dnode_id;
+            Entry->FileSize         = FileInfo->FileSize;
+            Entry->PhysicalSize     = FileInfo->PhysicalSize;
+            Entry->CreateTime       = FileInfo->CreateTime;
+            Entry->LastAccessTime   = FileInfo->LastAccessTime;
+            Entry->ModificationTime = FileInfo->ModificationTime;
+            Entry->Attribute        = FileInfo->Attribute;
+        }
+    }
 
     // prepare for return
     *BufferSize = RequiredSize;
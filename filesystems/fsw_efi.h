@@ -54,6 +54,215 @@
     0x964e5b21, 0x6459, 0x11d2, {0x8e, 0x39, 0x0, 0xa0, 0xc9, 0x69, 0x72, 0x3b } \
   }
 
+#define REFIND_EFI_DISK_IO2_PROTOCOL_GUID \
+  { \
+    0x151c8eae, 0x7f2c, 0x472c, {0x9e, 0x54, 0x98, 0x28, 0x19, 0x4f, 0x6a, 0x88 } \
+  }
+
+typedef struct _REFIND_EFI_DISK_IO2_PROTOCOL REFIND_EFI_DISK_IO2_PROTOCOL;
+
+/**
+ * EFI Host: Token of a non-blocking Disk I/O 2 request (UEFI 2.4 and later).
+ */
+
+typedef struct {
+    EFI_EVENT                   Event;              //!< Signaled when the request completes
+    EFI_STATUS                  TransactionStatus;  //!< Status of the completed request
+} REFIND_EFI_DISK_IO2_TOKEN;
+
+typedef EFI_STATUS (EFIAPI *REFIND_EFI_DISK_CANCEL_EX)(IN REFIND_EFI_DISK_IO2_PROTOCOL *This);
+typedef EFI_STATUS (EFIAPI *REFIND_EFI_DISK_READ_EX)(IN REFIND_EFI_DISK_IO2_PROTOCOL *This,
+                                                     IN UINT32 MediaId,
+                                                     IN UINT64 Offset,
+                                                     IN OUT REFIND_EFI_DISK_IO2_TOKEN *Token,
+                                                     IN UINTN BufferSize,
+                                                     OUT VOID *Buffer);
+typedef EFI_STATUS (EFIAPI *REFIND_EFI_DISK_WRITE_EX)(IN REFIND_EFI_DISK_IO2_PROTOCOL *This,
+                                                      IN UINT32 MediaId,
+                                                      IN UINT64 Offset,
+                                                      IN OUT REFIND_EFI_DISK_IO2_TOKEN *Token,
+                                                      IN UINTN BufferSize,
+                                                      IN VOID *Buffer);
+typedef EFI_STATUS (EFIAPI *REFIND_EFI_DISK_FLUSH_EX)(IN REFIND_EFI_DISK_IO2_PROTOCOL *This,
+                                                      IN OUT REFIND_EFI_DISK_IO2_TOKEN *Token);
+
+/**
+ * EFI Host: The Disk I/O 2 protocol, declared here because not every
+ * build environment provides it.
+ */
+
+struct _REFIND_EFI_DISK_IO2_PROTOCOL {
+    UINT64                      Revision;
+    REFIND_EFI_DISK_CANCEL_EX   Cancel;
+    REFIND_EFI_DISK_READ_EX     ReadDiskEx;
+    REFIND_EFI_DISK_WRITE_EX    WriteDiskEx;
+    REFIND_EFI_DISK_FLUSH_EX    FlushDiskEx;
+};
+
+#ifndef FSW_EFI_ASYNC_SLOTS
+/** Number of Disk I/O 2 requests a volume can have in flight. */
+#define FSW_EFI_ASYNC_SLOTS (8)
+#endif
+
+/**
+ * EFI Host: One slot for a background read through Disk I/O 2.
+ */
+
+typedef struct {
+    REFIND_EFI_DISK_IO2_TOKEN   Token;          //!< Request token, its event is created on first use
+    BOOLEAN                     InUse;          //!< A request is in flight or not yet collected
+} FSW_EFI_ASYNC_READ;
+
+#ifndef FSW_EFI_CACHE_LINE_SHIFT
+/** Log2 of the size of one disk cache line; lines are aligned to their size on disk. */
+#define FSW_EFI_CACHE_LINE_SHIFT (16)
+#endif
+/** Size in bytes of one disk cache line. */
+#define FSW_EFI_CACHE_LINE_SIZE (1 << FSW_EFI_CACHE_LINE_SHIFT)
+
+#ifndef FSW_EFI_CACHE_SETS
+/** Number of sets in the per-volume disk cache. */
+#define FSW_EFI_CACHE_SETS (8)
+#endif
+
+#ifndef FSW_EFI_CACHE_WAYS
+/** Number of lines per set (associativity) in the per-volume disk cache. */
+#define FSW_EFI_CACHE_WAYS (4)
+#endif
+
+#ifndef FSW_EFI_CACHE_WINDOW_MAX
+/** Largest disk read issued on a cache miss, reached by a run of sequential misses. */
+#define FSW_EFI_CACHE_WINDOW_MAX (4 * 1024 * 1024)
+#endif
+
+/**
+ * EFI Host: One line of the per-volume disk cache. The valid data always lies
+ * within the aligned window of the disk that selected the line's set.
+ */
+
+typedef struct {
+    UINT8                       *Data;          //!< Line buffer, allocated on first use
+    UINT64                      Start;          //!< Disk byte offset of the cached data
+    UINTN                       Length;         //!< Number of valid bytes, zero if the line is empty
+    UINT64                      LastUse;        //!< Access stamp for LRU replacement
+    UINTN                       Pins;           //!< Blocks of the line lent to the core, which keep it in place
+} FSW_EFI_CACHE_LINE;
+
+/**
+ * EFI Host: Counters for checking the disk cache and its fill window policy.
+ */
+
+typedef struct {
+    UINT64                      Hits;           //!< Blocks served from a cache line
+    UINT64                      StreamHits;     //!< Blocks served from the staging buffer
+    UINT64                      SequentialMisses; //!< Misses that continued the previous fill, grow the window
+    UINT64                      RandomMisses;   //!< Other misses, shrink the window
+    UINT64                      Fills;          //!< Disk reads issued to fill the cache
+    UINT64                      FillBytes;      //!< Bytes read by those fills
+    UINT64                      DirectReads;    //!< Uncached single-block reads
+    UINT64                      Window;         //!< Current fill window in bytes
+    UINT64                      Lent;           //!< Blocks lent to the core block cache (revision 0x00010002, GetCacheTraceEx only)
+} FSW_EFI_CACHE_TRACE;
+
+#ifndef FSW_EFI_INFO_CACHE_SIZE
+/** Number of slots in the per-volume file information cache. */
+#define FSW_EFI_INFO_CACHE_SIZE (256)
+#endif
+
+/**
+ * EFI Host: The name-independent part of an EFI_FILE_INFO, remembered per
+ * dnode id so that repeated GetInfo calls skip the file system driver.
+ */
+
+typedef struct {
+    BOOLEAN                     Valid;          //!< Slot holds data
+    fsw_u64                     TreeId;         //!< tree_id of the dnode
+    fsw_u64                     DnodeId;        //!< dnode_id of the dnode
+    UINT64                      FileSize;
+    UINT64                      PhysicalSize;
+    EFI_TIME                    CreateTime;
+    EFI_TIME                    LastAccessTime;
+    EFI_TIME                    ModificationTime;
+    UINT64                      Attribute;
+} FSW_EFI_INFO_CACHE_ENTRY;
+
+#ifndef FSW_EFI_DIR_SNAPSHOT_MAX_SIZE
+/** Largest directory listing kept in memory, in bytes; zero disables snapshots. */
+#define FSW_EFI_DIR_SNAPSHOT_MAX_SIZE (256 * 1024)
+#endif
+
+#ifndef FSW_EFI_DIR_SNAPSHOT_COUNT
+/** Number of unreferenced directory snapshots kept per volume. */
+#define FSW_EFI_DIR_SNAPSHOT_COUNT (16)
+#endif
+
+/**
+ * EFI Host: All entries of a directory, captured once as a packed array of
+ * EFI_FILE_INFO records. Each record starts on an 8-byte boundary.
+ */
+
+typedef struct _FSW_EFI_DIR_SNAPSHOT {
+    struct _FSW_EFI_DIR_SNAPSHOT *Next;         //!< Next snapshot of the same volume
+    fsw_u64                     TreeId;         //!< tree_id of the directory
+    fsw_u64                     DnodeId;        //!< dnode_id of the directory
+    UINTN                       RefCount;       //!< Number of file handles reading from the snapshot
+    UINT64                      LastUse;        //!< Access stamp for LRU replacement
+    UINTN                       Size;           //!< Number of bytes used in Data
+    UINT8                       *Data;          //!< The packed records, NULL for an empty directory
+} FSW_EFI_DIR_SNAPSHOT;
+
+#define FSW_EFI_STATS_PROTOCOL_GUID \
+  { \
+    0x5e0d8b3c, 0x7a21, 0x4f4e, {0x9b, 0x1d, 0x63, 0xc2, 0x48, 0xe7, 0x0a, 0x95 } \
+  }
+
+/**
+ * Revision of the statistics protocol structure. Revision 0x00010001 added
+ * GetCacheTrace. Revision 0x00010002 appended bcache_borrowed to struct fsw_io_stats
+ * and Lent to FSW_EFI_CACHE_TRACE, and added GetStatsEx and GetCacheTraceEx.
+ *
+ * Functions are only ever appended to the protocol. GetStats and GetCacheTrace
+ * keep copying the structures as they were in revision 0x00010001, i.e. only
+ * FSW_EFI_IO_STATS_SIZE_V1 and FSW_EFI_CACHE_TRACE_SIZE_V1 bytes. Counters added
+ * since then are only returned by the Ex functions, which take the size of the
+ * caller's structure, copy at most that many bytes and return the driver's size.
+ * New counters are always appended, so a caller sees the prefix it knows about.
+ */
+#define FSW_EFI_STATS_PROTOCOL_REVISION  0x00010002
+
+/** Size of struct fsw_io_stats as copied by GetStats. */
+#define FSW_EFI_IO_STATS_SIZE_V1    ((UINTN) &((struct fsw_io_stats *) 0)->bcache_borrowed)
+/** Size of FSW_EFI_CACHE_TRACE as copied by GetCacheTrace. */
+#define FSW_EFI_CACHE_TRACE_SIZE_V1 ((UINTN) &((FSW_EFI_CACHE_TRACE *) 0)->Lent)
+
+typedef struct _FSW_EFI_STATS_PROTOCOL FSW_EFI_STATS_PROTOCOL;
+
+typedef EFI_STATUS (EFIAPI *FSW_EFI_STATS_GET)(IN FSW_EFI_STATS_PROTOCOL *This,
+                                               OUT struct fsw_io_stats *Stats);
+typedef EFI_STATUS (EFIAPI *FSW_EFI_STATS_RESET)(IN FSW_EFI_STATS_PROTOCOL *This);
+typedef EFI_STATUS (EFIAPI *FSW_EFI_STATS_GET_CACHE_TRACE)(IN FSW_EFI_STATS_PROTOCOL *This,
+                                                           OUT FSW_EFI_CACHE_TRACE *Trace);
+typedef EFI_STATUS (EFIAPI *FSW_EFI_STATS_GET_EX)(IN FSW_EFI_STATS_PROTOCOL *This,
+                                                  IN OUT UINTN *StatsSize,
+                                                  OUT struct fsw_io_stats *Stats);
+typedef EFI_STATUS (EFIAPI *FSW_EFI_STATS_GET_CACHE_TRACE_EX)(IN FSW_EFI_STATS_PROTOCOL *This,
+                                                              IN OUT UINTN *TraceSize,
+                                                              OUT FSW_EFI_CACHE_TRACE *Trace);
+
+/**
+ * EFI Host: Private protocol for reading the I/O and cache counters of a volume.
+ * It is installed on the device handle next to the Simple File System protocol.
+ */
+
+struct _FSW_EFI_STATS_PROTOCOL {
+    UINT64                      Revision;       //!< FSW_EFI_STATS_PROTOCOL_REVISION
+    FSW_EFI_STATS_GET           GetStats;       //!< Copy the current counters
+    FSW_EFI_STATS_RESET         ResetStats;     //!< Zero all counters
+    FSW_EFI_STATS_GET_CACHE_TRACE GetCacheTrace; //!< Copy the disk cache counters (revision 0x00010001)
+    FSW_EFI_STATS_GET_EX        GetStatsEx;     //!< Copy the counters, bounded by size (revision 0x00010002)
+    FSW_EFI_STATS_GET_CACHE_TRACE_EX GetCacheTraceEx; //!< Copy the disk cache counters, bounded by size (revision 0x00010002)
+};
+
 /**
  * EFI Host: Private per-volume structure.
  */
@@ -62,11 +271,29 @@ typedef struct {
     UINT64                      Signature;      //!< Used to identify this structure
 
     EFI_FILE_IO_INTERFACE       FileSystem;     //!< Published EFI protocol interface structure
+    FSW_EFI_STATS_PROTOCOL      Stats;          //!< Published statistics protocol interface
 
     EFI_HANDLE                  Handle;         //!< The device handle the protocol is attached to
     EFI_DISK_IO                 *DiskIo;        //!< The Disk I/O protocol we use for disk access
+    REFIND_EFI_DISK_IO2_PROTOCOL *DiskIo2;      //!< The Disk I/O 2 protocol for background reads, or NULL
+    FSW_EFI_ASYNC_READ          AsyncReads[FSW_EFI_ASYNC_SLOTS]; //!< Slots for background reads
     UINT32                      MediaId;        //!< The media ID from the Block I/O protocol
     EFI_STATUS                  LastIOStatus;   //!< Last status from Disk I/O
+    UINT64                      MediaSize;      //!< Size of the device in bytes, used to clip cache fills
+
+    FSW_EFI_CACHE_LINE          Cache[FSW_EFI_CACHE_SETS][FSW_EFI_CACHE_WAYS]; //!< Set-associative disk cache
+    UINT64                      CacheClock;     //!< Source of LastUse stamps
+    UINTN                       CacheWindow;    //!< Size of the next fill, adapted to the access pattern
+    UINT64                      CacheFillEnd;   //!< Disk byte offset just past the last fill
+    UINT8                       *Stream;        //!< Staging buffer for fills larger than a line
+    UINTN                       StreamSize;     //!< Allocated size of the staging buffer
+    UINT64                      StreamStart;    //!< Disk byte offset of the staged data
+    UINTN                       StreamLength;   //!< Number of valid staged bytes
+    FSW_EFI_CACHE_TRACE         CacheTrace;     //!< Disk cache counters
+
+    FSW_EFI_INFO_CACHE_ENTRY    *InfoCache;     //!< File information cache, allocated on first use
+    FSW_EFI_DIR_SNAPSHOT        *DirSnapshots;  //!< List of directory snapshots
+    UINT64                      DirSnapshotClock; //!< Source of LastUse stamps for snapshots
 
     struct fsw_volume           *vol;           //!< FSW volume structure
 
@@ -76,6 +303,8 @@ typedef struct {
 #define FSW_VOLUME_DATA_SIGNATURE  EFI_SIGNATURE_32 ('f', 's', 'w', 'V')
 /** Access macro for the volume structure. */
 #define FSW_VOLUME_FROM_FILE_SYSTEM(a)  CR (a, FSW_VOLUME_DATA, FileSystem, FSW_VOLUME_DATA_SIGNATURE)
+/** Access macro for the volume structure, starting from the statistics protocol. */
+#define FSW_VOLUME_FROM_STATS(a)  CR (a, FSW_VOLUME_DATA, Stats, FSW_VOLUME_DATA_SIGNATURE)
 
 /**
  * EFI Host: Private structure for a EFI_FILE interface.
@@ -89,6 +318,10 @@ typedef struct {
     UINT64                       Type;           //!< File type used for dispatching
     struct fsw_shandle          shand;          //!< FSW handle for this file
 
+    FSW_EFI_DIR_SNAPSHOT        *Snapshot;      //!< Directories: entries served from memory, or NULL
+    UINTN                       SnapshotPos;    //!< Directories: byte offset of the next record in Snapshot
+    BOOLEAN                     NoSnapshot;     //!< Directories: a snapshot could not be built, read live
+
 } FSW_FILE_DATA;
 
 /** File type: regular file. */
@@ -110,6 +343,8 @@ VOID fsw_efi_decode_time(OUT EFI_TIME *EfiTime, IN UINT32 UnixTime);
 
 UINTN fsw_efi_strsize(struct fsw_string *s);
 VOID fsw_efi_strcpy(CHAR16 *Dest, struct fsw_string *src);
-VOID EFIAPI fsw_efi_clear_cache(VOID);
+VOID fsw_efi_clear_cache(FSW_VOLUME_DATA *Volume);
+VOID fsw_efi_free_cache(FSW_VOLUME_DATA *Volume);
+VOID fsw_efi_free_async(FSW_VOLUME_DATA *Volume);
 
 #endif
@@ -86,4 +86,26 @@ typedef UINT64  fsw_u64;
 #define DivU64x32Remainder DivU64x32
 #endif
 
+// tick counter for the I/O statistics
+
+#if defined(__MAKEWITH_TIANO) && (defined(MDE_CPU_IA32) || defined(MDE_CPU_X64))
+#define FSW_GET_TICKS() AsmReadTsc()
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+static __inline__ fsw_u64 fsw_efi_get_ticks(void)
+{
+    fsw_u32 lo, hi;
+    __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+    return ((fsw_u64)hi << 32) | lo;
+}
+#define FSW_GET_TICKS() fsw_efi_get_ticks()
+#elif defined(__GNUC__) && defined(__aarch64__)
+static __inline__ fsw_u64 fsw_efi_get_ticks(void)
+{
+    fsw_u64 ticks;
+    __asm__ __volatile__ ("mrs %0, cntvct_el0" : "=r" (ticks));
+    return ticks;
+}
+#define FSW_GET_TICKS() fsw_efi_get_ticks()
+#endif
+
 #endif
@@ -31,6 +31,7 @@ static void         fsw_ext2_volume_free(struct fsw_ext2_volume *vol);
 static fsw_status_t fsw_ext2_volume_stat(struct fsw_ext2_volume *vol, struct fsw_volume_stat *sb);
 
 static fsw_status_t fsw_ext2_dnode_fill(struct fsw_ext2_volume *vol, struct fsw_ext2_dnode *dno);
+static void         fsw_ext2_dnode_batch(struct fsw_ext2_volume *vol, struct fsw_shandle *shand);
 static void         fsw_ext2_dnode_free(struct fsw_ext2_volume *vol, struct fsw_ext2_dnode *dno);
 static fsw_status_t fsw_ext2_dnode_stat(struct fsw_ext2_volume *vol, struct fsw_ext2_dnode *dno,
                                         struct fsw_dnode_stat *sb);
@@ -77,7 +78,8 @@ static fsw_status_t fsw_ext2_volume_mount(struct fsw_ext2_volume *vol)
     fsw_status_t    status;
     void            *buffer;
     fsw_u32         blocksize;
-    fsw_u32         groupcnt, groupno, gdesc_per_block, gdesc_bno, gdesc_index;
+    fsw_u32         groupcnt, groupno, gdesc_per_block, gdesc_bno, gdesc_index, gdesc_buffer_bno;
+    void            *gdesc_buffer;
     struct ext2_group_desc *gdesc;
     int             i;
     struct fsw_string s;
@@ -137,17 +139,25 @@ static fsw_status_t fsw_ext2_volume_mount(struct fsw_ext2_volume *vol)
     status = fsw_alloc(sizeof(fsw_u32) * groupcnt, &vol->inotab_bno);
     if (status)
         return status;
+    gdesc_buffer = NULL;
+    gdesc_buffer_bno = 0;
     for (groupno = 0; groupno < groupcnt; groupno++) {
-        // get the block group descriptor
+        // get the block group descriptor, keeping the block for the following groups
         gdesc_bno = (vol->sb->s_first_data_block + 1) + groupno / gdesc_per_block;
         gdesc_index = groupno % gdesc_per_block;
-        status = fsw_block_get(vol, gdesc_bno, 1, (void **)&buffer);
-        if (status)
-            return status;
-        gdesc = ((struct ext2_group_desc *)(buffer)) + gdesc_index;
+        if (gdesc_buffer == NULL || gdesc_bno != gdesc_buffer_bno) {
+            if (gdesc_buffer != NULL)
+                fsw_block_release(vol, gdesc_buffer_bno, gdesc_buffer);
+            status = fsw_block_get(vol, gdesc_bno, 1, &gdesc_buffer);
+            if (status)
+                return status;
+            gdesc_buffer_bno = gdesc_bno;
+        }
+        gdesc = ((struct ext2_group_desc *)(gdesc_buffer)) + gdesc_index;
         vol->inotab_bno[groupno] = gdesc->bg_inode_table;
-        fsw_block_release(vol, gdesc_bno, buffer);
     }
+    if (gdesc_buffer != NULL)
+        fsw_block_release(vol, gdesc_buffer_bno, gdesc_buffer);
 
     // setup the root dnode
     status = fsw_dnode_create_root(vol, EXT2_ROOT_INO, &vol->g.root);
@@ -171,6 +181,10 @@ static void fsw_ext2_volume_free(struct fsw_ext2_volume *vol)
         fsw_free(vol->sb);
     if (vol->inotab_bno)
         fsw_free(vol->inotab_bno);
+    if (vol->batch_ino)
+        fsw_free(vol->batch_ino);
+    if (vol->batch_raw)
+        fsw_free(vol->batch_raw);
 }
 
 /**
@@ -184,6 +198,21 @@ static fsw_status_t fsw_ext2_volume_stat(struct fsw_ext2_volume *vol, struct fsw
     return FSW_SUCCESS;
 }
 
+/**
+ * Compute the inode table block holding an inode and the inode's offset in it.
+ */
+
+static void fsw_ext2_inode_location(struct fsw_ext2_volume *vol, fsw_u32 ino, fsw_u32 *bno_out, fsw_u32 *offset_out)
+{
+    fsw_u32         groupno, ino_in_group, inodes_per_block;
+
+    groupno = (ino - 1) / vol->sb->s_inodes_per_group;
+    ino_in_group = (ino - 1) % vol->sb->s_inodes_per_group;
+    inodes_per_block = vol->g.phys_blocksize / vol->inode_size;
+    *bno_out = vol->inotab_bno[groupno] + ino_in_group / inodes_per_block;
+    *offset_out = (ino_in_group % inodes_per_block) * vol->inode_size;
+}
+
 /**
  * Get full information on a dnode from disk. This function is called by the core
  * whenever it needs to access fields in the dnode structure that may not
@@ -195,7 +224,7 @@ static fsw_status_t fsw_ext2_volume_stat(struct fsw_ext2_volume *vol, struct fsw
 static fsw_status_t fsw_ext2_dnode_fill(struct fsw_ext2_volume *vol, struct fsw_ext2_dnode *dno)
 {
     fsw_status_t    status;
-    fsw_u32         groupno, ino_in_group, ino_bno, ino_index;
+    fsw_u32         ino_bno, ino_offset, i;
     fsw_u8          *buffer;
 
     if (dno->raw)
@@ -203,21 +232,27 @@ static fsw_status_t fsw_ext2_dnode_fill(struct fsw_ext2_volume *vol, struct fsw_
 
     FSW_MSG_DEBUG((FSW_MSGSTR("fsw_ext2_dnode_fill: inode %d\n"), dno->g.dnode_id));
 
-    // read the inode block
-    groupno = (fsw_u32) (dno->g.dnode_id - 1) / vol->sb->s_inodes_per_group;
-    ino_in_group = (fsw_u32) (dno->g.dnode_id - 1) % vol->sb->s_inodes_per_group;
-    ino_bno = vol->inotab_bno[groupno] +
-        ino_in_group / (vol->g.phys_blocksize / vol->inode_size);
-    ino_index = ino_in_group % (vol->g.phys_blocksize / vol->inode_size);
-    status = fsw_block_get(vol, ino_bno, 2, (void **)&buffer);
-    if (status)
-        return status;
+    // the inodes of the directory block being read were fetched together
+    for (i = 0; i < vol->batch_count; i++)
+        if (vol->batch_ino[i] == dno->g.dnode_id)
+            break;
+    if (i < vol->batch_count) {
+        status = fsw_memdup((void **)&dno->raw, vol->batch_raw + i * vol->inode_size, vol->inode_size);
+        if (status)
+            return status;
+    } else {
+        // read the inode block
+        fsw_ext2_inode_location(vol, (fsw_u32)dno->g.dnode_id, &ino_bno, &ino_offset);
+        status = fsw_block_get(vol, ino_bno, 2, (void **)&buffer);
+        if (status)
+            return status;
 
-    // keep our inode around
-    status = fsw_memdup((void **)&dno->raw, buffer + ino_index * vol->inode_size, vol->inode_size);
-    fsw_block_release(vol, ino_bno, buffer);
-    if (status)
-        return status;
+        // keep our inode around
+        status = fsw_memdup((void **)&dno->raw, buffer + ino_offset, vol->inode_size);
+        fsw_block_release(vol, ino_bno, buffer);
+        if (status)
+            return status;
+    }
 
     // get info from the inode
     dno->g.size = dno->raw->i_size;
@@ -234,6 +269,100 @@ static fsw_status_t fsw_ext2_dnode_fill(struct fsw_ext2_volume *vol, struct fsw_
     return FSW_SUCCESS;
 }
 
+/**
+ * Read the inodes of all entries in the directory block starting at the shandle's
+ * position in one pass. Hosts usually fill and stat every child returned by dir_read;
+ * sorting the inode numbers by their inode table block fetches each of those blocks
+ * once and in ascending order instead of in directory order. The copies are kept for
+ * fsw_ext2_dnode_fill until the next directory block is read. Errors are not fatal,
+ * the remaining inodes are simply read on demand.
+ */
+
+static void fsw_ext2_dnode_batch(struct fsw_ext2_volume *vol, struct fsw_shandle *shand)
+{
+    fsw_status_t    status;
+    struct fsw_arena_mark mark;
+    struct ext2_dir_entry *entry;
+    fsw_u8          *dirblock, *buffer;
+    fsw_u64         pos;
+    fsw_u32         *batch_bno, bno, buffer_bno;
+    fsw_u32         blocksize, buffer_size, offset, ino_offset, count, i, ino;
+
+    vol->batch_count = 0;
+    blocksize = vol->g.log_blocksize;
+    if (vol->batch_ino == NULL) {
+        // the shortest directory entry takes 12 bytes
+        vol->batch_size = blocksize / 12;
+        if (fsw_alloc(vol->batch_size * sizeof(fsw_u32), &vol->batch_ino))
+            return;
+        if (fsw_alloc(vol->batch_size * vol->inode_size, &vol->batch_raw)) {
+            fsw_free(vol->batch_ino);
+            vol->batch_ino = NULL;
+            return;
+        }
+    }
+
+    fsw_arena_mark(&vol->g.arena, &mark);
+    if (fsw_arena_alloc(&vol->g.arena, blocksize, (void **)&dirblock) ||
+        fsw_arena_alloc(&vol->g.arena, vol->batch_size * sizeof(fsw_u32), (void **)&batch_bno))
+        goto done;
+
+    // get the directory block without moving the handle
+    pos = shand->pos;
+    buffer_size = blocksize;
+    status = fsw_shandle_read(shand, &buffer_size, dirblock);
+    shand->pos = pos;
+    if (status)
+        goto done;
+
+    // collect the inode numbers, sorted by inode table block and position within it
+    count = 0;
+    for (offset = 0; offset + 8 <= buffer_size && count < vol->batch_size; offset += entry->rec_len) {
+        entry = (struct ext2_dir_entry *)(dirblock + offset);
+        if (entry->rec_len < 8 || offset + entry->rec_len > buffer_size)
+            break;
+        ino = entry->inode;
+        if (ino == 0 || ino > vol->sb->s_inodes_count)
+            continue;
+        // . and .. are not returned by dir_read
+        if (entry->name_len <= 2 && entry->name[0] == '.' &&
+            (entry->name_len == 1 || entry->name[1] == '.'))
+            continue;
+        fsw_ext2_inode_location(vol, ino, &bno, &ino_offset);
+        for (i = count; i > 0 && (batch_bno[i - 1] > bno ||
+                                  (batch_bno[i - 1] == bno && vol->batch_ino[i - 1] > ino)); i--) {
+            batch_bno[i] = batch_bno[i - 1];
+            vol->batch_ino[i] = vol->batch_ino[i - 1];
+        }
+        batch_bno[i] = bno;
+        vol->batch_ino[i] = ino;
+        count++;
+    }
+
+    // copy the inodes, getting each inode table block once
+    buffer = NULL;
+    buffer_bno = 0;
+    for (i = 0; i < count; i++) {
+        if (buffer == NULL || batch_bno[i] != buffer_bno) {
+            if (buffer != NULL)
+                fsw_block_release(vol, buffer_bno, buffer);
+            buffer_bno = batch_bno[i];
+            if (fsw_block_get(vol, buffer_bno, 2, (void **)&buffer)) {
+                buffer = NULL;
+                break;
+            }
+        }
+        fsw_ext2_inode_location(vol, vol->batch_ino[i], &bno, &ino_offset);
+        fsw_memcpy(vol->batch_raw + i * vol->inode_size, buffer + ino_offset, vol->inode_size);
+    }
+    if (buffer != NULL)
+        fsw_block_release(vol, buffer_bno, buffer);
+    vol->batch_count = i;
+
+done:
+    fsw_arena_release(&vol->g.arena, &mark);
+}
+
 /**
  * Free the dnode data structure. Called by the core when deallocating a dnode
  * structure to release the memory used by the file system type specific part
@@ -242,8 +371,13 @@ static fsw_status_t fsw_ext2_dnode_fill(struct fsw_ext2_volume *vol, struct fsw_
 
 static void fsw_ext2_dnode_free(struct fsw_ext2_volume *vol, struct fsw_ext2_dnode *dno)
 {
+    int         i;
+
     if (dno->raw)
         fsw_free(dno->raw);
+    for (i = 0; i < 3; i++)
+        if (dno->ind_data[i])
+            fsw_free(dno->ind_data[i]);
 }
 
 /**
@@ -266,38 +400,58 @@ static fsw_status_t fsw_ext2_dnode_stat(struct fsw_ext2_volume *vol, struct fsw_
 }
 
 /**
- * Retrieve file data mapping information. This function is called by the core when
- * fsw_shandle_read needs to know where on the disk the required piece of the file's
- * data can be found. The core makes sure that fsw_ext2_dnode_fill has been called
- * on the dnode before. Our task here is to get the physical disk block number for
- * the requested logical block number.
- *
- * The ext2 file system does not use extents, but stores a list of block numbers
- * using the usual direct, indirect, double-indirect, triple-indirect scheme. To
- * optimize access, this function checks if the following file blocks are mapped
- * to consecutive disk blocks and returns a combined extent if possible.
+ * Get an indirect block of the file. The block last used at each depth of the
+ * indirection path is kept with the dnode, so that mapping the following blocks of
+ * the file does not need to go through the block cache again.
  */
 
-static fsw_status_t fsw_ext2_get_extent(struct fsw_ext2_volume *vol, struct fsw_ext2_dnode *dno,
-                                        struct fsw_extent *extent)
+static fsw_status_t fsw_ext2_get_ind_block(struct fsw_ext2_volume *vol, struct fsw_ext2_dnode *dno, int depth,
+                                           fsw_u32 bno, fsw_u32 **ptrs_out)
 {
     fsw_status_t    status;
-    fsw_u32         bno, release_bno, buf_bcnt, file_bcnt;
-    fsw_u32         *buffer;
-    int             path[5], i;
+    void            *buffer;
 
-    // Preconditions: The caller has checked that the requested logical block
-    //  is within the file's size. The dnode has complete information, i.e.
-    //  fsw_ext2_dnode_read_info was called successfully on it.
+    if (dno->ind_data[depth] == NULL) {
+        status = fsw_alloc(vol->g.phys_blocksize, &dno->ind_data[depth]);
+        if (status)
+            return status;
+    } else if (dno->ind_bno[depth] == bno) {
+        *ptrs_out = dno->ind_data[depth];
+        return FSW_SUCCESS;
+    }
+
+    dno->ind_bno[depth] = 0;
+    status = fsw_block_get(vol, bno, 1, &buffer);
+    if (status)
+        return status;
+    fsw_memcpy(dno->ind_data[depth], buffer, vol->g.phys_blocksize);
+    fsw_block_release(vol, bno, buffer);
+    dno->ind_bno[depth] = bno;
+
+    *ptrs_out = dno->ind_data[depth];
+    return FSW_SUCCESS;
+}
 
-    extent->type = FSW_EXTENT_TYPE_PHYSBLOCK;
-    extent->log_count = 1;
-    bno = extent->log_start;
+/**
+ * Follow the direct, indirect, double-indirect or triple-indirect path of a logical
+ * block. On return, *ptrs_out points to the array of block pointers holding the
+ * block's pointer at *index_out, and *count_out is the number of pointers from there
+ * to the end of that array. If an indirect block on the path is missing, *ptrs_out
+ * is NULL and *count_out is the length of the hole starting at the block.
+ */
+
+static fsw_status_t fsw_ext2_map_block(struct fsw_ext2_volume *vol, struct fsw_ext2_dnode *dno, fsw_u32 log_bno,
+                                       fsw_u32 **ptrs_out, fsw_u32 *index_out, fsw_u32 *count_out)
+{
+    fsw_status_t    status;
+    fsw_u32         bno, path[4], cover[4], *ptrs;
+    int             depth, levels, i;
 
     // try direct block pointers in the inode
+    bno = log_bno;
     if (bno < EXT2_NDIR_BLOCKS) {
         path[0] = bno;
-        path[1] = -1;
+        levels = 1;
     } else {
         bno -= EXT2_NDIR_BLOCKS;
 
@@ -305,7 +459,7 @@ static fsw_status_t fsw_ext2_get_extent(struct fsw_ext2_volume *vol, struct fsw_
         if (bno < vol->ind_bcnt) {
             path[0] = EXT2_IND_BLOCK;
             path[1] = bno;
-            path[2] = -1;
+            levels = 2;
         } else {
             bno -= vol->ind_bcnt;
 
@@ -314,7 +468,7 @@ static fsw_status_t fsw_ext2_get_extent(struct fsw_ext2_volume *vol, struct fsw_
                 path[0] = EXT2_DIND_BLOCK;
                 path[1] = bno / vol->ind_bcnt;
                 path[2] = bno % vol->ind_bcnt;
-                path[3] = -1;
+                levels = 3;
             } else {
                 bno -= vol->dind_bcnt;
 
@@ -323,48 +477,101 @@ static fsw_status_t fsw_ext2_get_extent(struct fsw_ext2_volume *vol, struct fsw_
                 path[1] = bno / vol->dind_bcnt;
                 path[2] = (bno / vol->ind_bcnt) % vol->ind_bcnt;
                 path[3] = bno % vol->ind_bcnt;
-                path[4] = -1;
+                levels = 4;
             }
         }
     }
 
     // follow the indirection path
-    buffer = dno->raw->i_block;
-    buf_bcnt = EXT2_NDIR_BLOCKS;
-    release_bno = 0;
-    for (i = 0; ; i++) {
-        bno = buffer[path[i]];
+    ptrs = dno->raw->i_block;
+    for (depth = 0; depth < levels - 1; depth++) {
+        bno = ptrs[path[depth]];
         if (bno == 0) {
-            extent->type = FSW_EXTENT_TYPE_SPARSE;
-            if (release_bno)
-                fsw_block_release(vol, release_bno, buffer);
+            // the whole range below this pointer is a hole, skip to its end
+            cover[levels - 1] = 1;
+            for (i = levels - 2; i >= depth; i--)
+                cover[i] = cover[i + 1] * vol->ind_bcnt;
+            *count_out = cover[depth];
+            for (i = depth + 1; i < levels; i++)
+                *count_out -= path[i] * cover[i];
+            *ptrs_out = NULL;
             return FSW_SUCCESS;
         }
-        if (path[i+1] < 0)
-            break;
-
-        if (release_bno)
-            fsw_block_release(vol, release_bno, buffer);
-        status = fsw_block_get(vol, bno, 1, (void **)&buffer);
+        status = fsw_ext2_get_ind_block(vol, dno, depth, bno, &ptrs);
         if (status)
             return status;
-        release_bno = bno;
-        buf_bcnt = vol->ind_bcnt;
     }
-    extent->phys_start = bno;
 
-    // check if the following blocks can be aggregated into one extent
-    file_bcnt = (fsw_u32)((dno->g.size + vol->g.log_blocksize - 1) & (vol->g.log_blocksize - 1));
-    while (path[i]           + extent->log_count < buf_bcnt &&    // indirect block has more block pointers
-           extent->log_start + extent->log_count < file_bcnt) {   // file has more blocks
-        if (buffer[path[i] + extent->log_count] == buffer[path[i] + extent->log_count - 1] + 1)
+    *ptrs_out = ptrs;
+    *index_out = path[levels - 1];
+    *count_out = (levels == 1 ? EXT2_NDIR_BLOCKS : vol->ind_bcnt) - path[levels - 1];
+    return FSW_SUCCESS;
+}
+
+/**
+ * Retrieve file data mapping information. This function is called by the core when
+ * fsw_shandle_read needs to know where on the disk the required piece of the file's
+ * data can be found. The core makes sure that fsw_ext2_dnode_fill has been called
+ * on the dnode before. Our task here is to get the physical disk block number for
+ * the requested logical block number.
+ *
+ * The ext2 file system does not use extents, but stores a list of block numbers
+ * using the usual direct, indirect, double-indirect, triple-indirect scheme. To
+ * optimize access, this function checks if the following file blocks are mapped
+ * to consecutive disk blocks and returns a combined extent if possible, also when
+ * their pointers are spread over several indirect blocks.
+ */
+
+static fsw_status_t fsw_ext2_get_extent(struct fsw_ext2_volume *vol, struct fsw_ext2_dnode *dno,
+                                        struct fsw_extent *extent)
+{
+    fsw_status_t    status;
+    fsw_u32         log_bno, file_bcnt, *ptrs, index, count, bno, i;
+
+    // Preconditions: The caller has checked that the requested logical block
+    //  is within the file's size. The dnode has complete information, i.e.
+    //  fsw_ext2_dnode_read_info was called successfully on it.
+
+    // extend the extent over all following blocks that are physically contiguous (or
+    //  all holes), across the boundaries of indirect blocks, up to the end of the file
+    file_bcnt = (fsw_u32)FSW_U64_DIV(dno->g.size + vol->g.log_blocksize - 1, vol->g.log_blocksize);
+    extent->type = FSW_EXTENT_TYPE_SPARSE;
+    extent->log_count = 0;
+    log_bno = extent->log_start;
+    while (log_bno < file_bcnt || extent->log_count == 0) {
+        status = fsw_ext2_map_block(vol, dno, log_bno, &ptrs, &index, &count);
+        if (status)
+            return status;
+        if (log_bno >= file_bcnt)
+            count = 1;
+        else if (count > file_bcnt - log_bno)
+            count = file_bcnt - log_bno;
+
+        if (ptrs == NULL) {
+            // a missing indirect block
+            if (extent->log_count > 0 && extent->type != FSW_EXTENT_TYPE_SPARSE)
+                break;
+            extent->log_count += count;
+            log_bno += count;
+            continue;
+        }
+
+        for (i = 0; i < count; i++) {
+            bno = ptrs[index + i];
+            if (extent->log_count == 0) {
+                extent->type = bno ? FSW_EXTENT_TYPE_PHYSBLOCK : FSW_EXTENT_TYPE_SPARSE;
+                extent->phys_start = bno;
+            } else if (extent->type == FSW_EXTENT_TYPE_PHYSBLOCK ?
+                       bno != extent->phys_start + extent->log_count : bno != 0) {
+                break;
+            }
             extent->log_count++;
-        else
+        }
+        if (i < count)
             break;
+        log_bno += count;
     }
 
-    if (release_bno)
-        fsw_block_release(vol, release_bno, buffer);
     return FSW_SUCCESS;
 }
 
@@ -443,6 +650,10 @@ static fsw_status_t fsw_ext2_dir_read(struct fsw_ext2_volume *vol, struct fsw_ex
     //  calls.
 
     while (1) {
+        // fetch the inodes of a new directory block together
+        if ((shand->pos & (vol->g.log_blocksize - 1)) == 0 && shand->pos < dno->g.size)
+            fsw_ext2_dnode_batch(vol, shand);
+
         // read next entry
         status = fsw_ext2_read_dentry(shand, &entry);
         if (status)
@@ -49,6 +49,11 @@ struct fsw_ext2_volume {
     fsw_u32     ind_bcnt;           //!< Number of blocks addressable through an indirect block
     fsw_u32     dind_bcnt;          //!< Number of blocks addressable through a double-indirect block
     fsw_u32     inode_size;         //!< Size of inode structure in bytes
+
+    fsw_u32     *batch_ino;         //!< Inode numbers read ahead from the current directory block
+    fsw_u8      *batch_raw;         //!< Raw inodes for batch_ino, inode_size bytes each
+    fsw_u32     batch_count;        //!< Number of valid entries in batch_ino and batch_raw
+    fsw_u32     batch_size;         //!< Capacity of batch_ino and batch_raw
 };
 
 /**
@@ -59,6 +64,8 @@ struct fsw_ext2_dnode {
     struct fsw_dnode g;             //!< Generic dnode structure
     
     struct ext2_inode *raw;         //!< Full raw inode structure
+    fsw_u32     ind_bno[3];         //!< Disk block numbers of the indirect blocks in ind_data, or 0
+    fsw_u32     *ind_data[3];       //!< Copies of the indirect blocks visited last, by depth
 };
 
 
@@ -32,6 +32,7 @@ static void         fsw_ext4_volume_free(struct fsw_ext4_volume *vol);
 static fsw_status_t fsw_ext4_volume_stat(struct fsw_ext4_volume *vol, struct fsw_volume_stat *sb);
 
 static fsw_status_t fsw_ext4_dnode_fill(struct fsw_ext4_volume *vol, struct fsw_ext4_dnode *dno);
+static void         fsw_ext4_dnode_batch(struct fsw_ext4_volume *vol, struct fsw_shandle *shand);
 static void         fsw_ext4_dnode_free(struct fsw_ext4_volume *vol, struct fsw_ext4_dnode *dno);
 static fsw_status_t fsw_ext4_dnode_stat(struct fsw_ext4_volume *vol, struct fsw_ext4_dnode *dno,
                                         struct fsw_dnode_stat *sb);
@@ -47,6 +48,9 @@ static fsw_status_t fsw_ext4_dir_lookup(struct fsw_ext4_volume *vol, struct fsw_
 static fsw_status_t fsw_ext4_dir_read(struct fsw_ext4_volume *vol, struct fsw_ext4_dnode *dno,
                                       struct fsw_shandle *shand, struct fsw_ext4_dnode **child_dno);
 static fsw_status_t fsw_ext4_read_dentry(struct fsw_shandle *shand, struct ext4_dir_entry *entry);
+static fsw_status_t fsw_ext4_dx_lookup(struct fsw_ext4_volume *vol, struct fsw_shandle *shand,
+                                       struct fsw_string *lookup_name, struct fsw_string *entry_name,
+                                       fsw_u32 *child_ino_out);
 
 static fsw_status_t fsw_ext4_readlink(struct fsw_ext4_volume *vol, struct fsw_ext4_dnode *dno,
                                       struct fsw_string *link);
@@ -111,7 +115,8 @@ static fsw_status_t fsw_ext4_volume_mount(struct fsw_ext4_volume *vol)
     void            *buffer;
     fsw_u32         blocksize;
     fsw_u32         groupcnt, groupno, gdesc_per_block, gdesc_index, metabg_of_gdesc;
-    fsw_u64         gdesc_bno;
+    fsw_u64         gdesc_bno, gdesc_buffer_bno;
+    void            *gdesc_buffer;
     struct ext4_group_desc *gdesc;
     int             i;
     struct fsw_string s;
@@ -192,7 +197,10 @@ static fsw_status_t fsw_ext4_volume_mount(struct fsw_ext4_volume *vol)
     if (status)
         return status;
 
-    // Loop through all block group descriptors in order to get inode table locations
+    // Loop through all block group descriptors in order to get inode table locations,
+    //  keeping each descriptor block while the following groups are described in it
+    gdesc_buffer = NULL;
+    gdesc_buffer_bno = 0;
     for (groupno = 0; groupno < groupcnt; groupno++) {
 
         // Calculate the block number which contains the block group descriptor we look for
@@ -214,18 +222,23 @@ static fsw_status_t fsw_ext4_volume_mount(struct fsw_ext4_volume *vol)
         gdesc_index = groupno % gdesc_per_block;
 
         // Get block if necessary...
-        status = fsw_block_get(vol, gdesc_bno, 1, (void **)&buffer);
-        if (status)
-            return status;
+        if (gdesc_buffer == NULL || gdesc_bno != gdesc_buffer_bno) {
+            if (gdesc_buffer != NULL)
+                fsw_block_release(vol, gdesc_buffer_bno, gdesc_buffer);
+            status = fsw_block_get(vol, gdesc_bno, 1, &gdesc_buffer);
+            if (status)
+                return status;
+            gdesc_buffer_bno = gdesc_bno;
+        }
 
         // Get group descriptor table and block number of inode table...
-        gdesc = (struct ext4_group_desc *)((char *)buffer + gdesc_index * vol->sb->s_desc_size);
+        gdesc = (struct ext4_group_desc *)((char *)gdesc_buffer + gdesc_index * vol->sb->s_desc_size);
         vol->inotab_bno[groupno] = gdesc->bg_inode_table_lo;
         if (vol->sb->s_desc_size >= EXT4_MIN_DESC_SIZE_64BIT)
             vol->inotab_bno[groupno] |= (fsw_u64)gdesc->bg_inode_table_hi << 32;
-
-        fsw_block_release(vol, gdesc_bno, buffer);
     }
+    if (gdesc_buffer != NULL)
+        fsw_block_release(vol, gdesc_buffer_bno, gdesc_buffer);
 
     // setup the root dnode
     status = fsw_dnode_create_root(vol, EXT4_ROOT_INO, &vol->g.root);
@@ -249,6 +262,10 @@ static void fsw_ext4_volume_free(struct fsw_ext4_volume *vol)
         fsw_free(vol->sb);
     if (vol->inotab_bno)
         fsw_free(vol->inotab_bno);
+    if (vol->batch_ino)
+        fsw_free(vol->batch_ino);
+    if (vol->batch_raw)
+        fsw_free(vol->batch_raw);
 }
 
 /**
@@ -272,6 +289,21 @@ static fsw_status_t fsw_ext4_volume_stat(struct fsw_ext4_volume *vol, struct fsw
     return FSW_SUCCESS;
 }
 
+/**
+ * Compute the inode table block holding an inode and the inode's offset in it.
+ */
+
+static void fsw_ext4_inode_location(struct fsw_ext4_volume *vol, fsw_u32 ino, fsw_u64 *bno_out, fsw_u32 *offset_out)
+{
+    fsw_u32         groupno, ino_in_group, inodes_per_block;
+
+    groupno = (ino - 1) / vol->sb->s_inodes_per_group;
+    ino_in_group = (ino - 1) % vol->sb->s_inodes_per_group;
+    inodes_per_block = vol->g.phys_blocksize / vol->inode_size;
+    *bno_out = vol->inotab_bno[groupno] + ino_in_group / inodes_per_block;
+    *offset_out = (ino_in_group % inodes_per_block) * vol->inode_size;
+}
+
 /**
  * Get full information on a dnode from disk. This function is called by the core
  * whenever it needs to access fields in the dnode structure that may not
@@ -283,30 +315,34 @@ static fsw_status_t fsw_ext4_volume_stat(struct fsw_ext4_volume *vol, struct fsw
 static fsw_status_t fsw_ext4_dnode_fill(struct fsw_ext4_volume *vol, struct fsw_ext4_dnode *dno)
 {
     fsw_status_t    status;
-    fsw_u32         groupno, ino_in_group, ino_index;
+    fsw_u32         ino_offset, i;
     fsw_u64         ino_bno;
     fsw_u8          *buffer;
 
     if (dno->raw)
         return FSW_SUCCESS;
 
+    // the inodes of the directory block being read were fetched together
+    for (i = 0; i < vol->batch_count; i++)
+        if (vol->batch_ino[i] == dno->g.dnode_id)
+            break;
+    if (i < vol->batch_count) {
+        status = fsw_memdup((void **)&dno->raw, vol->batch_raw + i * vol->inode_size, vol->inode_size);
+        if (status)
+            return status;
+    } else {
+        // read the inode block
+        fsw_ext4_inode_location(vol, (fsw_u32)dno->g.dnode_id, &ino_bno, &ino_offset);
+        status = fsw_block_get(vol, ino_bno, 2, (void **)&buffer);
+        if (status)
+            return status;
 
-    // read the inode block
-    groupno = (fsw_u32) (dno->g.dnode_id - 1) / vol->sb->s_inodes_per_group;
-    ino_in_group = (fsw_u32) (dno->g.dnode_id - 1) % vol->sb->s_inodes_per_group;
-    ino_bno = vol->inotab_bno[groupno] +
-        ino_in_group / (vol->g.phys_blocksize / vol->inode_size);
-    ino_index = ino_in_group % (vol->g.phys_blocksize / vol->inode_size);
-    status = fsw_block_get(vol, ino_bno, 2, (void **)&buffer);
-
-    if (status)
-        return status;
-
-    // keep our inode around
-    status = fsw_memdup((void **)&dno->raw, buffer + ino_index * vol->inode_size, vol->inode_size);
-    fsw_block_release(vol, ino_bno, buffer);
-    if (status)
-        return status;
+        // keep our inode around
+        status = fsw_memdup((void **)&dno->raw, buffer + ino_offset, vol->inode_size);
+        fsw_block_release(vol, ino_bno, buffer);
+        if (status)
+            return status;
+    }
 
     // get info from the inode
     dno->g.size = dno->raw->i_size_lo; // TODO: check docs for 64-bit sized files
@@ -325,6 +361,101 @@ static fsw_status_t fsw_ext4_dnode_fill(struct fsw_ext4_volume *vol, struct fsw_
     return FSW_SUCCESS;
 }
 
+/**
+ * Read the inodes of all entries in the directory block starting at the shandle's
+ * position in one pass. Hosts usually fill and stat every child returned by dir_read,
+ * and fetching the inodes one by one would visit the inode table blocks in directory
+ * order. Instead, the inode numbers are sorted by their location in the inode tables
+ * and each table block is fetched once, in ascending order. With flex_bg the tables of
+ * neighbouring groups are adjacent, so this usually becomes a single sequential run.
+ * The copies are kept for fsw_ext4_dnode_fill until the next directory block is read.
+ * Errors are not fatal, the remaining inodes are simply read on demand.
+ */
+
+static void fsw_ext4_dnode_batch(struct fsw_ext4_volume *vol, struct fsw_shandle *shand)
+{
+    fsw_status_t    status;
+    struct fsw_arena_mark mark;
+    struct ext4_dir_entry *entry;
+    fsw_u8          *dirblock, *buffer;
+    fsw_u64         pos, *batch_bno, bno, buffer_bno;
+    fsw_u32         blocksize, buffer_size, offset, ino_offset, count, i, ino;
+
+    vol->batch_count = 0;
+    blocksize = vol->g.log_blocksize;
+    if (vol->batch_ino == NULL) {
+        // the shortest directory entry takes 12 bytes
+        vol->batch_size = blocksize / 12;
+        if (fsw_alloc(vol->batch_size * sizeof(fsw_u32), &vol->batch_ino))
+            return;
+        if (fsw_alloc(vol->batch_size * vol->inode_size, &vol->batch_raw)) {
+            fsw_free(vol->batch_ino);
+            vol->batch_ino = NULL;
+            return;
+        }
+    }
+
+    fsw_arena_mark(&vol->g.arena, &mark);
+    if (fsw_arena_alloc(&vol->g.arena, blocksize, (void **)&dirblock) ||
+        fsw_arena_alloc(&vol->g.arena, vol->batch_size * sizeof(fsw_u64), (void **)&batch_bno))
+        goto done;
+
+    // get the directory block without moving the handle
+    pos = shand->pos;
+    buffer_size = blocksize;
+    status = fsw_shandle_read(shand, &buffer_size, dirblock);
+    shand->pos = pos;
+    if (status)
+        goto done;
+
+    // collect the inode numbers, sorted by inode table block and position within it
+    count = 0;
+    for (offset = 0; offset + 8 <= buffer_size && count < vol->batch_size; offset += entry->rec_len) {
+        entry = (struct ext4_dir_entry *)(dirblock + offset);
+        if (entry->rec_len < 8 || offset + entry->rec_len > buffer_size)
+            break;
+        ino = entry->inode;
+        if (ino == 0 || ino > vol->sb->s_inodes_count)
+            continue;
+        // . and .. are not returned by dir_read
+        if (entry->name_len <= 2 && entry->name[0] == '.' &&
+            (entry->name_len == 1 || entry->name[1] == '.'))
+            continue;
+        fsw_ext4_inode_location(vol, ino, &bno, &ino_offset);
+        for (i = count; i > 0 && (batch_bno[i - 1] > bno ||
+                                  (batch_bno[i - 1] == bno && vol->batch_ino[i - 1] > ino)); i--) {
+            batch_bno[i] = batch_bno[i - 1];
+            vol->batch_ino[i] = vol->batch_ino[i - 1];
+        }
+        batch_bno[i] = bno;
+        vol->batch_ino[i] = ino;
+        count++;
+    }
+
+    // copy the inodes, getting each inode table block once
+    buffer = NULL;
+    buffer_bno = 0;
+    for (i = 0; i < count; i++) {
+        if (buffer == NULL || batch_bno[i] != buffer_bno) {
+            if (buffer != NULL)
+                fsw_block_release(vol, buffer_bno, buffer);
+            buffer_bno = batch_bno[i];
+            if (fsw_block_get(vol, buffer_bno, 2, (void **)&buffer)) {
+                buffer = NULL;
+                break;
+            }
+        }
+        fsw_ext4_inode_location(vol, vol->batch_ino[i], &bno, &ino_offset);
+        fsw_memcpy(vol->batch_raw + i * vol->inode_size, buffer + ino_offset, vol->inode_size);
+    }
+    if (buffer != NULL)
+        fsw_block_release(vol, buffer_bno, buffer);
+    vol->batch_count = i;
+
+done:
+    fsw_arena_release(&vol->g.arena, &mark);
+}
+
 /**
  * Free the dnode data structure. Called by the core when deallocating a dnode
  * structure to release the memory used by the file system type specific part
@@ -333,8 +464,15 @@ static fsw_status_t fsw_ext4_dnode_fill(struct fsw_ext4_volume *vol, struct fsw_
 
 static void fsw_ext4_dnode_free(struct fsw_ext4_volume *vol, struct fsw_ext4_dnode *dno)
 {
+    int         i;
+
     if (dno->raw)
         fsw_free(dno->raw);
+    for (i = 0; i < 3; i++)
+        if (dno->ind_data[i])
+            fsw_free(dno->ind_data[i]);
+    if (dno->leaf)
+        fsw_free(dno->leaf);
 }
 
 /**
@@ -392,15 +530,87 @@ static fsw_status_t fsw_ext4_get_extent(struct fsw_ext4_volume *vol, struct fsw_
 }
 
 /**
- * New ext4 extents...
+ * Convert an on-disk extent to a core extent. Uninitialized extents are allocated
+ * but hold no data yet, they read as zeros like holes.
  */
+
+static void fsw_ext4_extent_convert(struct ext4_extent *ext4_extent, struct fsw_extent *extent)
+{
+    extent->log_start = ext4_extent->ee_block;
+    extent->buffer = NULL;
+    if (ext4_extent->ee_len > EXT4_EXT_INIT_MAX_LEN) {
+        extent->type = FSW_EXTENT_TYPE_SPARSE;
+        extent->log_count = ext4_extent->ee_len - EXT4_EXT_INIT_MAX_LEN;
+    } else {
+        extent->type = FSW_EXTENT_TYPE_PHYSBLOCK;
+        extent->log_count = ext4_extent->ee_len;
+        extent->phys_start = ((fsw_u64)ext4_extent->ee_start_hi << 32) | ext4_extent->ee_start_lo;
+    }
+}
+
+/**
+ * Find the requested logical block in the extents of a leaf node. Blocks not covered
+ * by any extent are reported as sparse up to the start of the next extent, or up to
+ * hole_end if there is none.
+ */
+
+static fsw_status_t fsw_ext4_get_from_leaf(struct ext4_extent *ext4_extent, fsw_u32 count, fsw_u64 hole_end,
+                                           struct fsw_extent *extent)
+{
+    struct fsw_extent found;
+    fsw_u32         bno, lo, hi, mid;
+    fsw_u64         next;
+
+    bno = extent->log_start;
+
+    // find the last extent starting at or before the requested block
+    lo = 0;
+    hi = count;
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (ext4_extent[mid].ee_block <= bno)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo > 0) {
+        fsw_ext4_extent_convert(&ext4_extent[lo - 1], &found);
+        if (bno < found.log_start + found.log_count) {
+            extent->type = found.type;
+            extent->log_count = found.log_count - (bno - found.log_start);
+            if (found.type == FSW_EXTENT_TYPE_PHYSBLOCK)
+                extent->phys_start = found.phys_start + (bno - found.log_start);
+            return FSW_SUCCESS;
+        }
+    }
+
+    // a hole up to the next extent or the end of the leaf's range
+    next = lo < count && ext4_extent[lo].ee_block < hole_end ? ext4_extent[lo].ee_block : hole_end;
+    if (next <= bno)
+        return FSW_VOLUME_CORRUPTED;
+    extent->type = FSW_EXTENT_TYPE_SPARSE;
+    extent->log_count = (fsw_u32)(next - bno);
+    return FSW_SUCCESS;
+}
+
+/**
+ * New ext4 extents. The extent tree is walked from the root in the inode down to the
+ * leaf covering the requested block, using a binary search on each node. Each index
+ * block is released before descending further. The extents of the leaf are passed to
+ * the core's extent map, and a copy of the leaf is kept in the dnode so that requests
+ * for blocks in the same leaf's range do not need to walk the tree again.
+ */
+
 static fsw_status_t fsw_ext4_get_by_extent(struct fsw_ext4_volume *vol, struct fsw_ext4_dnode *dno,
                                         struct fsw_extent *extent)
 {
-    fsw_status_t  status;
-    fsw_u32       bno, buf_offset;
-    int           ext_cnt;
-    void          *buffer;
+    fsw_status_t    status;
+    fsw_u32         bno, max_entries, lo, hi, mid, i;
+    fsw_u64         leaf_start, leaf_end, file_bcnt, phys_bno;
+    int             depth;
+    void            *buffer;
+    struct fsw_extent leaf_extent;
 
     struct ext4_extent_header  *ext4_extent_header;
     struct ext4_extent_idx     *ext4_extent_idx;
@@ -409,80 +619,153 @@ static fsw_status_t fsw_ext4_get_by_extent(struct fsw_ext4_volume *vol, struct f
     // Logical block requested by core...
     bno = extent->log_start;
 
-    // First buffer is the i_block field from inode...
-    buffer = (void *)dno->raw->i_block;
-    buf_offset = 0;
-    while(1) {
-        ext4_extent_header = (struct ext4_extent_header *)((char *)buffer + buf_offset);
-        buf_offset += sizeof(struct ext4_extent_header);
-        FSW_MSG_DEBUG((FSW_MSGSTR("fsw_ext4_get_by_extent: extent header with %d entries\n"), 
+    // holes are reported up to the end of the file at most
+    file_bcnt = FSW_U64_DIV(dno->g.size + vol->g.log_blocksize - 1, vol->g.log_blocksize);
+
+    // the leaf visited last often covers the next request as well
+    if (dno->leaf != NULL && bno >= dno->leaf_start && bno < dno->leaf_end)
+        return fsw_ext4_get_from_leaf(dno->leaf, dno->leaf_count,
+                                      dno->leaf_end < file_bcnt ? dno->leaf_end : file_bcnt, extent);
+
+    // First node is the i_block field from inode...
+    ext4_extent_header = (struct ext4_extent_header *)dno->raw->i_block;
+    max_entries = (sizeof(dno->raw->i_block) - sizeof(struct ext4_extent_header)) / sizeof(struct ext4_extent);
+    depth = -1;
+    buffer = NULL;
+    phys_bno = 0;
+    leaf_start = 0;
+    leaf_end = (fsw_u64)1 << 32;
+    while (1) {
+        FSW_MSG_DEBUG((FSW_MSGSTR("fsw_ext4_get_by_extent: extent header with %d entries\n"),
                       ext4_extent_header->eh_entries));
-        if(ext4_extent_header->eh_magic != EXT4_EXT_MAGIC)
-            return FSW_VOLUME_CORRUPTED;
+        if (ext4_extent_header->eh_magic != EXT4_EXT_MAGIC ||
+            ext4_extent_header->eh_entries > max_entries ||
+            ext4_extent_header->eh_depth > EXT4_EXT_MAX_DEPTH ||
+            (depth >= 0 && ext4_extent_header->eh_depth != depth - 1)) {
+            status = FSW_VOLUME_CORRUPTED;
+            goto done;
+        }
+        depth = ext4_extent_header->eh_depth;
+        if (depth == 0)
+            break;
 
-        for(ext_cnt = 0;ext_cnt < ext4_extent_header->eh_entries;ext_cnt++)
-        {
-            if(ext4_extent_header->eh_depth == 0)
-            {
-                // Leaf node, the header follows actual extents
-                ext4_extent = (struct ext4_extent *)((char *)buffer + buf_offset);
-                buf_offset += sizeof(struct ext4_extent);
-                FSW_MSG_DEBUG((FSW_MSGSTR("fsw_ext4_get_by_extent: extent node cover %d...\n"), ext4_extent->ee_block));
-
-                // Is the requested block in this extent?
-                if(bno >= ext4_extent->ee_block && bno < ext4_extent->ee_block + ext4_extent->ee_len)
-                {
-                    extent->phys_start = ((fsw_u64)ext4_extent->ee_start_hi << 32) | ext4_extent->ee_start_lo;
-                    extent->phys_start += (bno - ext4_extent->ee_block);
-                    extent->log_count = ext4_extent->ee_len - (bno - ext4_extent->ee_block);
-                    return FSW_SUCCESS;
-                }
-            }
+        FSW_MSG_DEBUG((FSW_MSGSTR("fsw_ext4_get_by_extent: index extents, depth %d\n"), depth));
+        ext4_extent_idx = (struct ext4_extent_idx *)(ext4_extent_header + 1);
+
+        // find the last index entry starting at or before the requested block
+        lo = 0;
+        hi = ext4_extent_header->eh_entries;
+        while (lo < hi) {
+            mid = (lo + hi) / 2;
+            if (ext4_extent_idx[mid].ei_block <= bno)
+                lo = mid + 1;
             else
-            {
-                FSW_MSG_DEBUG((FSW_MSGSTR("fsw_ext4_get_by_extent: index extents, depth %d\n"), 
-                          ext4_extent_header->eh_depth));
-                ext4_extent_idx = (struct ext4_extent_idx *)((char *)buffer + buf_offset);
-                buf_offset += sizeof(struct ext4_extent_idx);
-
-                FSW_MSG_DEBUG((FSW_MSGSTR("fsw_ext4_get_by_extent: index node covers block %d...\n"),
-                          ext4_extent_idx->ei_block));
-                if(bno >= ext4_extent_idx->ei_block)
-                {
-                    // Follow extent tree...
-                    fsw_u64 phys_bno = ((fsw_u64)ext4_extent_idx->ei_leaf_hi << 32) | ext4_extent_idx->ei_leaf_lo;
-                    status = fsw_block_get(vol, phys_bno, 1, (void **)&buffer);
-                    if (status)
-                        return status;
-                    buf_offset = 0;
-                    break;
-                }
-            }
+                hi = mid;
+        }
+        if (lo == 0) {
+            // the block lies in a hole before the first subtree
+            if (ext4_extent_header->eh_entries > 0 && ext4_extent_idx[0].ei_block < file_bcnt)
+                file_bcnt = ext4_extent_idx[0].ei_block;
+            status = fsw_ext4_get_from_leaf(NULL, 0, file_bcnt, extent);
+            goto done;
         }
+        i = lo - 1;
+        leaf_start = ext4_extent_idx[i].ei_block;
+        if (i + 1 < ext4_extent_header->eh_entries && ext4_extent_idx[i + 1].ei_block < leaf_end)
+            leaf_end = ext4_extent_idx[i + 1].ei_block;
+
+        // Follow extent tree...
+        if (buffer != NULL)
+            fsw_block_release(vol, phys_bno, buffer);
+        phys_bno = ((fsw_u64)ext4_extent_idx[i].ei_leaf_hi << 32) | ext4_extent_idx[i].ei_leaf_lo;
+        status = fsw_block_get(vol, phys_bno, 1, &buffer);
+        if (status)
+            return status;
+        ext4_extent_header = (struct ext4_extent_header *)buffer;
+        max_entries = (vol->g.phys_blocksize - sizeof(struct ext4_extent_header)) / sizeof(struct ext4_extent);
     }
 
-    return FSW_NOT_FOUND;
+    // Leaf node: remember all of its extents, not just the one requested
+    ext4_extent = (struct ext4_extent *)(ext4_extent_header + 1);
+    for (i = 0; i < ext4_extent_header->eh_entries; i++) {
+        fsw_ext4_extent_convert(&ext4_extent[i], &leaf_extent);
+        fsw_dnode_cache_extent(dno, &leaf_extent);
+    }
+    status = fsw_ext4_get_from_leaf(ext4_extent, ext4_extent_header->eh_entries,
+                                    leaf_end < file_bcnt ? leaf_end : file_bcnt, extent);
+
+    if (buffer != NULL && status == FSW_SUCCESS) {
+        // keep a copy of a leaf block, the one in the inode is always at hand
+        if (dno->leaf == NULL &&
+            fsw_alloc(vol->g.phys_blocksize - sizeof(struct ext4_extent_header), &dno->leaf))
+            dno->leaf = NULL;
+        if (dno->leaf != NULL) {
+            fsw_memcpy(dno->leaf, ext4_extent, ext4_extent_header->eh_entries * sizeof(struct ext4_extent));
+            dno->leaf_count = ext4_extent_header->eh_entries;
+            dno->leaf_start = leaf_start;
+            dno->leaf_end = leaf_end;
+        }
+    }
+
+done:
+    if (buffer != NULL)
+        fsw_block_release(vol, phys_bno, buffer);
+    return status;
 }
 
 /**
- * The ext2/ext3 file system does not use extents, but stores a list of block numbers
- * using the usual direct, indirect, double-indirect, triple-indirect scheme. To
- * optimize access, this function checks if the following file blocks are mapped
- * to consecutive disk blocks and returns a combined extent if possible.
+ * Get an indirect block of the file. The block last used at each depth of the
+ * indirection path is kept with the dnode, so that mapping the following blocks of
+ * the file does not need to go through the block cache again.
  */
-static fsw_status_t fsw_ext4_get_by_blkaddr(struct fsw_ext4_volume *vol, struct fsw_ext4_dnode *dno,
-                                        struct fsw_extent *extent)
+
+static fsw_status_t fsw_ext4_get_ind_block(struct fsw_ext4_volume *vol, struct fsw_ext4_dnode *dno, int depth,
+                                           fsw_u32 bno, fsw_u32 **ptrs_out)
 {
     fsw_status_t    status;
-    fsw_u32         bno, release_bno, buf_bcnt, file_bcnt;
-    int             path[5], i;
-    fsw_u32         *buffer;
-    bno = extent->log_start;
+    void            *buffer;
+
+    if (dno->ind_data[depth] == NULL) {
+        status = fsw_alloc(vol->g.phys_blocksize, &dno->ind_data[depth]);
+        if (status)
+            return status;
+    } else if (dno->ind_bno[depth] == bno) {
+        *ptrs_out = dno->ind_data[depth];
+        return FSW_SUCCESS;
+    }
+
+    dno->ind_bno[depth] = 0;
+    status = fsw_block_get(vol, bno, 1, &buffer);
+    if (status)
+        return status;
+    fsw_memcpy(dno->ind_data[depth], buffer, vol->g.phys_blocksize);
+    fsw_block_release(vol, bno, buffer);
+    dno->ind_bno[depth] = bno;
+
+    *ptrs_out = dno->ind_data[depth];
+    return FSW_SUCCESS;
+}
+
+/**
+ * Follow the direct, indirect, double-indirect or triple-indirect path of a logical
+ * block. On return, *ptrs_out points to the array of block pointers holding the
+ * block's pointer at *index_out, and *count_out is the number of pointers from there
+ * to the end of that array. If an indirect block on the path is missing, *ptrs_out
+ * is NULL and *count_out is the length of the hole starting at the block.
+ */
+
+static fsw_status_t fsw_ext4_map_block(struct fsw_ext4_volume *vol, struct fsw_ext4_dnode *dno, fsw_u32 log_bno,
+                                       fsw_u32 **ptrs_out, fsw_u32 *index_out, fsw_u32 *count_out)
+{
+    fsw_status_t    status;
+    fsw_u32         bno, path[4], cover[4], *ptrs;
+    int             depth, levels, i;
 
     // try direct block pointers in the inode
+    bno = log_bno;
     if (bno < EXT4_NDIR_BLOCKS) {
         path[0] = bno;
-        path[1] = -1;
+        levels = 1;
     } else {
         bno -= EXT4_NDIR_BLOCKS;
 
@@ -490,7 +773,7 @@ static fsw_status_t fsw_ext4_get_by_blkaddr(struct fsw_ext4_volume *vol, struct
         if (bno < vol->ind_bcnt) {
             path[0] = EXT4_IND_BLOCK;
             path[1] = bno;
-            path[2] = -1;
+            levels = 2;
         } else {
             bno -= vol->ind_bcnt;
 
@@ -499,7 +782,7 @@ static fsw_status_t fsw_ext4_get_by_blkaddr(struct fsw_ext4_volume *vol, struct
                 path[0] = EXT4_DIND_BLOCK;
                 path[1] = bno / vol->ind_bcnt;
                 path[2] = bno % vol->ind_bcnt;
-                path[3] = -1;
+                levels = 3;
             } else {
                 bno -= vol->dind_bcnt;
 
@@ -508,51 +791,466 @@ static fsw_status_t fsw_ext4_get_by_blkaddr(struct fsw_ext4_volume *vol, struct
                 path[1] = bno / vol->dind_bcnt;
                 path[2] = (bno / vol->ind_bcnt) % vol->ind_bcnt;
                 path[3] = bno % vol->ind_bcnt;
-                path[4] = -1;
+                levels = 4;
             }
         }
     }
-    
+
     // follow the indirection path
-    buffer = dno->raw->i_block;
-    buf_bcnt = EXT4_NDIR_BLOCKS;
-    release_bno = 0;
-    for (i = 0; ; i++) {
-        bno = buffer[path[i]];
+    ptrs = dno->raw->i_block;
+    for (depth = 0; depth < levels - 1; depth++) {
+        bno = ptrs[path[depth]];
         if (bno == 0) {
-            extent->type = FSW_EXTENT_TYPE_SPARSE;
-            if (release_bno)
-                fsw_block_release(vol, release_bno, buffer);
+            // the whole range below this pointer is a hole, skip to its end
+            cover[levels - 1] = 1;
+            for (i = levels - 2; i >= depth; i--)
+                cover[i] = cover[i + 1] * vol->ind_bcnt;
+            *count_out = cover[depth];
+            for (i = depth + 1; i < levels; i++)
+                *count_out -= path[i] * cover[i];
+            *ptrs_out = NULL;
             return FSW_SUCCESS;
         }
-        if (path[i+1] < 0)
-            break;
-
-        if (release_bno)
-            fsw_block_release(vol, release_bno, buffer);
-        status = fsw_block_get(vol, bno, 1, (void **)&buffer);
+        status = fsw_ext4_get_ind_block(vol, dno, depth, bno, &ptrs);
         if (status)
             return status;
-        release_bno = bno;
-        buf_bcnt = vol->ind_bcnt;
     }
-    extent->phys_start = bno;
 
-    // check if the following blocks can be aggregated into one extent
-    file_bcnt = (fsw_u32)((dno->g.size + vol->g.log_blocksize - 1) & (vol->g.log_blocksize - 1));
-    while (path[i]           + extent->log_count < buf_bcnt &&    // indirect block has more block pointers
-           extent->log_start + extent->log_count < file_bcnt) {   // file has more blocks
-        if (buffer[path[i] + extent->log_count] == buffer[path[i] + extent->log_count - 1] + 1)
+    *ptrs_out = ptrs;
+    *index_out = path[levels - 1];
+    *count_out = (levels == 1 ? EXT4_NDIR_BLOCKS : vol->ind_bcnt) - path[levels - 1];
+    return FSW_SUCCESS;
+}
+
+/**
+ * The ext2/ext3 file system does not use extents, but stores a list of block numbers
+ * using the usual direct, indirect, double-indirect, triple-indirect scheme. To
+ * optimize access, this function checks if the following file blocks are mapped
+ * to consecutive disk blocks and returns a combined extent if possible, also when
+ * their pointers are spread over several indirect blocks.
+ */
+static fsw_status_t fsw_ext4_get_by_blkaddr(struct fsw_ext4_volume *vol, struct fsw_ext4_dnode *dno,
+                                        struct fsw_extent *extent)
+{
+    fsw_status_t    status;
+    fsw_u32         log_bno, file_bcnt, *ptrs, index, count, bno, i;
+
+    // extend the extent over all following blocks that are physically contiguous (or
+    //  all holes), across the boundaries of indirect blocks, up to the end of the file
+    file_bcnt = (fsw_u32)FSW_U64_DIV(dno->g.size + vol->g.log_blocksize - 1, vol->g.log_blocksize);
+    extent->type = FSW_EXTENT_TYPE_SPARSE;
+    extent->log_count = 0;
+    log_bno = extent->log_start;
+    while (log_bno < file_bcnt || extent->log_count == 0) {
+        status = fsw_ext4_map_block(vol, dno, log_bno, &ptrs, &index, &count);
+        if (status)
+            return status;
+        if (log_bno >= file_bcnt)
+            count = 1;
+        else if (count > file_bcnt - log_bno)
+            count = file_bcnt - log_bno;
+
+        if (ptrs == NULL) {
+            // a missing indirect block
+            if (extent->log_count > 0 && extent->type != FSW_EXTENT_TYPE_SPARSE)
+                break;
+            extent->log_count += count;
+            log_bno += count;
+            continue;
+        }
+
+        for (i = 0; i < count; i++) {
+            bno = ptrs[index + i];
+            if (extent->log_count == 0) {
+                extent->type = bno ? FSW_EXTENT_TYPE_PHYSBLOCK : FSW_EXTENT_TYPE_SPARSE;
+                extent->phys_start = bno;
+            } else if (extent->type == FSW_EXTENT_TYPE_PHYSBLOCK ?
+                       bno != extent->phys_start + extent->log_count : bno != 0) {
+                break;
+            }
             extent->log_count++;
-        else
+        }
+        if (i < count)
+            break;
+        log_bno += count;
+    }
+
+    return FSW_SUCCESS;
+}
+
+/**
+ * Legacy directory hash of the first htree implementation. The signed variant
+ * treats name bytes as signed chars, like the original code on x86 did.
+ */
+
+static fsw_u32 fsw_ext4_dx_hack_hash(const fsw_u8 *name, int len, int is_unsigned)
+{
+    fsw_u32 hash, hash0 = 0x12a3fe2d, hash1 = 0x37abe8f9;
+    int     c;
+
+    while (len--) {
+        c = is_unsigned ? (int)*name : (int)(signed char)*name;
+        name++;
+        hash = hash1 + (hash0 ^ (fsw_u32)(c * 7152373));
+        if (hash & 0x80000000)
+            hash -= 0x7fffffff;
+        hash1 = hash0;
+        hash0 = hash;
+    }
+    return hash0 << 1;
+}
+
+/**
+ * Pack up to num words of a name into the input buffer of the half-MD4 and TEA
+ * hashes, padding with a pattern derived from the name length.
+ */
+
+static void fsw_ext4_dx_str2hashbuf(const fsw_u8 *msg, int len, fsw_u32 *buf, int num, int is_unsigned)
+{
+    fsw_u32 pad, val;
+    int     i, c;
+
+    pad = (fsw_u32)len | ((fsw_u32)len << 8);
+    pad |= pad << 16;
+
+    val = pad;
+    if (len > num * 4)
+        len = num * 4;
+    for (i = 0; i < len; i++) {
+        c = is_unsigned ? (int)msg[i] : (int)(signed char)msg[i];
+        val = (fsw_u32)c + (val << 8);
+        if ((i % 4) == 3) {
+            *buf++ = val;
+            val = pad;
+            num--;
+        }
+    }
+    if (--num >= 0)
+        *buf++ = val;
+    while (--num >= 0)
+        *buf++ = pad;
+}
+
+#define DX_ROL32(x, s) (((x) << (s)) | ((x) >> (32 - (s))))
+#define DX_F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define DX_G(x, y, z) (((x) & (y)) + (((x) ^ (y)) & (z)))
+#define DX_H(x, y, z) ((x) ^ (y) ^ (z))
+#define DX_ROUND(f, a, b, c, d, x, s) (a += f(b, c, d) + (x), a = DX_ROL32(a, s))
+#define DX_K2 013240474631UL
+#define DX_K3 015666365641UL
+
+/**
+ * Reduced MD4 transform as used for the half-MD4 directory hash.
+ */
+
+static void fsw_ext4_dx_half_md4(fsw_u32 buf[4], const fsw_u32 in[8])
+{
+    fsw_u32 a = buf[0], b = buf[1], c = buf[2], d = buf[3];
+
+    DX_ROUND(DX_F, a, b, c, d, in[0],  3);
+    DX_ROUND(DX_F, d, a, b, c, in[1],  7);
+    DX_ROUND(DX_F, c, d, a, b, in[2], 11);
+    DX_ROUND(DX_F, b, c, d, a, in[3], 19);
+    DX_ROUND(DX_F, a, b, c, d, in[4],  3);
+    DX_ROUND(DX_F, d, a, b, c, in[5],  7);
+    DX_ROUND(DX_F, c, d, a, b, in[6], 11);
+    DX_ROUND(DX_F, b, c, d, a, in[7], 19);
+
+    DX_ROUND(DX_G, a, b, c, d, in[1] + DX_K2,  3);
+    DX_ROUND(DX_G, d, a, b, c, in[3] + DX_K2,  5);
+    DX_ROUND(DX_G, c, d, a, b, in[5] + DX_K2,  9);
+    DX_ROUND(DX_G, b, c, d, a, in[7] + DX_K2, 13);
+    DX_ROUND(DX_G, a, b, c, d, in[0] + DX_K2,  3);
+    DX_ROUND(DX_G, d, a, b, c, in[2] + DX_K2,  5);
+    DX_ROUND(DX_G, c, d, a, b, in[4] + DX_K2,  9);
+    DX_ROUND(DX_G, b, c, d, a, in[6] + DX_K2, 13);
+
+    DX_ROUND(DX_H, a, b, c, d, in[3] + DX_K3,  3);
+    DX_ROUND(DX_H, d, a, b, c, in[7] + DX_K3,  9);
+    DX_ROUND(DX_H, c, d, a, b, in[2] + DX_K3, 11);
+    DX_ROUND(DX_H, b, c, d, a, in[6] + DX_K3, 15);
+    DX_ROUND(DX_H, a, b, c, d, in[1] + DX_K3,  3);
+    DX_ROUND(DX_H, d, a, b, c, in[5] + DX_K3,  9);
+    DX_ROUND(DX_H, c, d, a, b, in[0] + DX_K3, 11);
+    DX_ROUND(DX_H, b, c, d, a, in[4] + DX_K3, 15);
+
+    buf[0] += a;
+    buf[1] += b;
+    buf[2] += c;
+    buf[3] += d;
+}
+
+/**
+ * TEA transform as used for the TEA directory hash.
+ */
+
+static void fsw_ext4_dx_tea(fsw_u32 buf[4], const fsw_u32 in[4])
+{
+    fsw_u32 sum = 0;
+    fsw_u32 b0 = buf[0], b1 = buf[1];
+    fsw_u32 a = in[0], b = in[1], c = in[2], d = in[3];
+    int     n = 16;
+
+    do {
+        sum += 0x9E3779B9;
+        b0 += ((b1 << 4) + a) ^ (b1 + sum) ^ ((b1 >> 5) + b);
+        b1 += ((b0 << 4) + c) ^ (b0 + sum) ^ ((b0 >> 5) + d);
+    } while (--n);
+
+    buf[0] += b0;
+    buf[1] += b1;
+}
+
+/**
+ * Compute the major directory hash of a name the way the htree index stores it.
+ * Only the major hash is needed to find the leaf block, the minor hash just
+ * orders entries within a leaf.
+ */
+
+static fsw_status_t fsw_ext4_dx_hash(struct fsw_ext4_volume *vol, int hash_version,
+                                     const fsw_u8 *name, int len, fsw_u32 *hash_out)
+{
+    fsw_u32     hash, in[8], buf[4];
+    int         i, is_unsigned = 0;
+
+    // default seed unless the superblock has one
+    buf[0] = 0x67452301;
+    buf[1] = 0xefcdab89;
+    buf[2] = 0x98badcfe;
+    buf[3] = 0x10325476;
+    for (i = 0; i < 4; i++) {
+        if (vol->sb->s_hash_seed[i]) {
+            fsw_memcpy(buf, vol->sb->s_hash_seed, sizeof(buf));
             break;
+        }
     }
 
-    if (release_bno)
-        fsw_block_release(vol, release_bno, buffer);
+    switch (hash_version) {
+        case DX_HASH_LEGACY_UNSIGNED:
+            is_unsigned = 1;
+            // fall through
+        case DX_HASH_LEGACY:
+            hash = fsw_ext4_dx_hack_hash(name, len, is_unsigned);
+            break;
+        case DX_HASH_HALF_MD4_UNSIGNED:
+            is_unsigned = 1;
+            // fall through
+        case DX_HASH_HALF_MD4:
+            for (; len > 0; len -= 32, name += 32) {
+                fsw_ext4_dx_str2hashbuf(name, len, in, 8, is_unsigned);
+                fsw_ext4_dx_half_md4(buf, in);
+            }
+            hash = buf[1];
+            break;
+        case DX_HASH_TEA_UNSIGNED:
+            is_unsigned = 1;
+            // fall through
+        case DX_HASH_TEA:
+            for (; len > 0; len -= 16, name += 16) {
+                fsw_ext4_dx_str2hashbuf(name, len, in, 4, is_unsigned);
+                fsw_ext4_dx_tea(buf, in);
+            }
+            hash = buf[0];
+            break;
+        default:
+            return FSW_UNSUPPORTED;
+    }
+
+    // the low bit is reserved to mark hash collisions in the index
+    hash &= ~1;
+    if (hash == (0x7fffffffU << 1))
+        hash = (0x7fffffffU - 1) << 1;
+    *hash_out = hash;
     return FSW_SUCCESS;
 }
 
+/**
+ * Read one logical block of a directory into a buffer.
+ */
+
+static fsw_status_t fsw_ext4_dx_read_block(struct fsw_shandle *shand, fsw_u32 log_bno, fsw_u8 *buffer)
+{
+    fsw_status_t    status;
+    fsw_u32         blocksize, buffer_size;
+
+    blocksize = shand->dnode->vol->g.log_blocksize;
+    if ((fsw_u64)log_bno * blocksize + blocksize > shand->dnode->size)
+        return FSW_VOLUME_CORRUPTED;
+
+    shand->pos = (fsw_u64)log_bno * blocksize;
+    buffer_size = blocksize;
+    status = fsw_shandle_read(shand, &buffer_size, buffer);
+    if (status)
+        return status;
+    if (buffer_size < blocksize)
+        return FSW_VOLUME_CORRUPTED;
+    return FSW_SUCCESS;
+}
+
+/**
+ * Locate and check the dx_entry array of an index block. The array starts at the
+ * given offset, its first entry holds the count and limit instead of a hash.
+ */
+
+static fsw_status_t fsw_ext4_dx_entries(fsw_u8 *buffer, fsw_u32 offset, fsw_u32 blocksize,
+                                        struct dx_entry **entries_out, int *count_out)
+{
+    struct dx_countlimit *countlimit;
+
+    countlimit = (struct dx_countlimit *)(buffer + offset);
+    if (countlimit->count == 0 || countlimit->count > countlimit->limit ||
+        offset + countlimit->limit * sizeof(struct dx_entry) > blocksize)
+        return FSW_VOLUME_CORRUPTED;
+
+    *entries_out = (struct dx_entry *)(buffer + offset);
+    *count_out = countlimit->count;
+    return FSW_SUCCESS;
+}
+
+/**
+ * Search the directory entries of one htree leaf block for a name.
+ */
+
+static fsw_status_t fsw_ext4_dx_search_leaf(fsw_u8 *buffer, fsw_u32 blocksize, struct fsw_string *lookup_name,
+                                            struct fsw_string *entry_name, fsw_u32 *child_ino_out)
+{
+    struct ext4_dir_entry *entry;
+    fsw_u32         offset;
+
+    for (offset = 0; offset + 8 <= blocksize; offset += entry->rec_len) {
+        entry = (struct ext4_dir_entry *)(buffer + offset);
+        if (entry->rec_len < 8 || offset + entry->rec_len > blocksize)
+            return FSW_VOLUME_CORRUPTED;
+        if (entry->inode == 0)
+            continue;
+        if (entry->rec_len < 8 + entry->name_len)
+            return FSW_VOLUME_CORRUPTED;
+
+        entry_name->type = FSW_STRING_TYPE_ISO88591;
+        entry_name->len = entry_name->size = entry->name_len;
+        entry_name->data = entry->name;
+        if (fsw_streq(lookup_name, entry_name)) {
+            *child_ino_out = entry->inode;
+            return FSW_SUCCESS;
+        }
+    }
+    return FSW_NOT_FOUND;
+}
+
+/**
+ * Look up a name through the hashed B-tree index of a directory. The index maps
+ * name hashes to leaf blocks, so only the index blocks on the path and the leaf
+ * holding the hash need to be read. If the name's hash collides across a leaf
+ * boundary, the following leaves are searched as long as their index entries
+ * carry the same hash.
+ *
+ * Returns FSW_SUCCESS with the inode number and the name pointing into arena
+ * memory, FSW_NOT_FOUND if the name is not in the directory, or another error if
+ * the index can not be used and the caller should scan the directory instead.
+ * All memory is taken from the volume's arena; the caller releases it.
+ */
+
+static fsw_status_t fsw_ext4_dx_lookup(struct fsw_ext4_volume *vol, struct fsw_shandle *shand,
+                                       struct fsw_string *lookup_name, struct fsw_string *entry_name,
+                                       fsw_u32 *child_ino_out)
+{
+    fsw_status_t    status;
+    struct fsw_string s;
+    struct dx_root_info *info;
+    struct dx_entry *entries[EXT4_DX_MAX_LEVELS];
+    int             count[EXT4_DX_MAX_LEVELS], at[EXT4_DX_MAX_LEVELS];
+    fsw_u8          *buffer[EXT4_DX_MAX_LEVELS + 1];
+    fsw_u32         blocksize, hash, log_bno;
+    int             hash_version, levels, level, lo, hi, mid;
+
+    blocksize = vol->g.log_blocksize;
+
+    // the index stores hashes of the raw on-disk name bytes
+    status = fsw_strdup_coerce_arena(&vol->g.arena, &s, FSW_STRING_TYPE_ISO88591, lookup_name);
+    if (status)
+        return status;
+    for (level = 0; level <= EXT4_DX_MAX_LEVELS; level++) {
+        status = fsw_arena_alloc(&vol->g.arena, blocksize, (void **)&buffer[level]);
+        if (status)
+            return status;
+    }
+
+    // the root sits in the first block behind the fake "." and ".." entries
+    status = fsw_ext4_dx_read_block(shand, 0, buffer[0]);
+    if (status)
+        return status;
+    info = (struct dx_root_info *)(buffer[0] + EXT4_DX_ROOT_INFO_OFFSET);
+    if (info->reserved_zero != 0 || info->info_length != sizeof(struct dx_root_info) ||
+        info->indirect_levels >= EXT4_DX_MAX_LEVELS)
+        return FSW_VOLUME_CORRUPTED;
+    levels = info->indirect_levels + 1;
+
+    hash_version = info->hash_version;
+    if (hash_version <= DX_HASH_TEA && (vol->sb->s_flags & EXT4_FLAGS_UNSIGNED_HASH))
+        hash_version += DX_HASH_LEGACY_UNSIGNED;
+    status = fsw_ext4_dx_hash(vol, hash_version, s.data, s.size, &hash);
+    if (status)
+        return status;
+
+    // walk down the index, at each level taking the last entry whose hash is not above ours
+    log_bno = 0;
+    for (level = 0; level < levels; level++) {
+        if (level == 0) {
+            status = fsw_ext4_dx_entries(buffer[0], EXT4_DX_ROOT_INFO_OFFSET + info->info_length, blocksize,
+                                         &entries[0], &count[0]);
+        } else {
+            status = fsw_ext4_dx_read_block(shand, log_bno, buffer[level]);
+            if (status)
+                return status;
+            status = fsw_ext4_dx_entries(buffer[level], EXT4_DX_NODE_ENTRIES_OFFSET, blocksize,
+                                         &entries[level], &count[level]);
+        }
+        if (status)
+            return status;
+
+        // entry 0 has no hash and covers everything below entry 1
+        lo = 1;
+        hi = count[level] - 1;
+        while (lo <= hi) {
+            mid = lo + (hi - lo) / 2;
+            if (entries[level][mid].hash > hash)
+                hi = mid - 1;
+            else
+                lo = mid + 1;
+        }
+        at[level] = lo - 1;
+        log_bno = entries[level][at[level]].block & 0x0fffffff;
+    }
+
+    while (1) {
+        status = fsw_ext4_dx_read_block(shand, log_bno, buffer[levels]);
+        if (status)
+            return status;
+        status = fsw_ext4_dx_search_leaf(buffer[levels], blocksize, lookup_name, entry_name, child_ino_out);
+        if (status != FSW_NOT_FOUND)
+            return status;
+
+        // a hash collision may continue in the next leaf, marked by the low bit of its hash
+        for (level = levels - 1; level >= 0; level--)
+            if (++at[level] < count[level])
+                break;
+        if (level < 0 || (entries[level][at[level]].hash & ~1) != hash)
+            return FSW_NOT_FOUND;
+        log_bno = entries[level][at[level]].block & 0x0fffffff;
+        for (level++; level < levels; level++) {
+            status = fsw_ext4_dx_read_block(shand, log_bno, buffer[level]);
+            if (status)
+                return status;
+            status = fsw_ext4_dx_entries(buffer[level], EXT4_DX_NODE_ENTRIES_OFFSET, blocksize,
+                                         &entries[level], &count[level]);
+            if (status)
+                return status;
+            at[level] = 0;
+            log_bno = entries[level][0].block & 0x0fffffff;
+        }
+    }
+}
+
 /**
  * Lookup a directory's child dnode by name. This function is called on a directory
  * to retrieve the directory entry with the given name. A dnode is constructed for
@@ -568,6 +1266,7 @@ static fsw_status_t fsw_ext4_dir_lookup(struct fsw_ext4_volume *vol, struct fsw_
     fsw_u32         child_ino;
     struct ext4_dir_entry entry;
     struct fsw_string entry_name;
+    struct fsw_arena_mark mark;
 
     // Preconditions: The caller has checked that dno is a directory node.
 
@@ -578,6 +1277,26 @@ static fsw_status_t fsw_ext4_dir_lookup(struct fsw_ext4_volume *vol, struct fsw_
     if (status)
         return status;
 
+    // use the hash index of indexed directories, fall back to a scan if it is unusable
+    if ((dno->raw->i_flags & EXT4_INDEX_FL) &&
+        (vol->sb->s_feature_compat & EXT4_FEATURE_COMPAT_DIR_INDEX) &&
+        dno->g.size >= 2 * vol->g.log_blocksize) {
+        fsw_arena_mark(&vol->g.arena, &mark);
+        status = fsw_ext4_dx_lookup(vol, &shand, lookup_name, &entry_name, &child_ino);
+        if (status == FSW_SUCCESS) {
+            status = fsw_dnode_create(dno, child_ino, FSW_DNODE_TYPE_UNKNOWN, &entry_name, child_dno_out);
+            fsw_arena_release(&vol->g.arena, &mark);
+            goto errorexit;
+        }
+        fsw_arena_release(&vol->g.arena, &mark);
+        if (status == FSW_NOT_FOUND)
+            goto errorexit;
+
+        FSW_MSG_DEBUG((FSW_MSGSTR("fsw_ext4_dir_lookup: htree of inode %d unusable (%d), scanning\n"),
+                      dno->g.dnode_id, status));
+        shand.pos = 0;
+    }
+
     // scan the directory for the file
     child_ino = 0;
     while (child_ino == 0) {
@@ -629,6 +1348,10 @@ static fsw_status_t fsw_ext4_dir_read(struct fsw_ext4_volume *vol, struct fsw_ex
     FSW_MSG_DEBUG((FSW_MSGSTR("fsw_ext4_dir_read: started reading dir\n")));
 
     while (1) {
+        // fetch the inodes of a new directory block together
+        if ((shand->pos & (vol->g.log_blocksize - 1)) == 0 && shand->pos < dno->g.size)
+            fsw_ext4_dnode_batch(vol, shand);
+
         // read next entry
         status = fsw_ext4_read_dentry(shand, &entry);
         if (status)
@@ -50,6 +50,11 @@ struct fsw_ext4_volume {
     fsw_u32     ind_bcnt;           //!< Number of blocks addressable through an indirect block
     fsw_u32     dind_bcnt;          //!< Number of blocks addressable through a double-indirect block
     fsw_u32     inode_size;         //!< Size of inode structure in bytes
+
+    fsw_u32     *batch_ino;         //!< Inode numbers read ahead from the current directory block
+    fsw_u8      *batch_raw;         //!< Raw inodes for batch_ino, inode_size bytes each
+    fsw_u32     batch_count;        //!< Number of valid entries in batch_ino and batch_raw
+    fsw_u32     batch_size;         //!< Capacity of batch_ino and batch_raw
 };
 
 /**
@@ -60,6 +65,12 @@ struct fsw_ext4_dnode {
     struct fsw_dnode g;             //!< Generic dnode structure
     
     struct ext4_inode *raw;         //!< Full raw inode structure
+    struct ext4_extent *leaf;       //!< Copy of the extent tree leaf visited last, or NULL
+    fsw_u32     leaf_count;         //!< Number of extents in leaf
+    fsw_u64     leaf_start;         //!< First logical block of the range covered by leaf
+    fsw_u64     leaf_end;           //!< First logical block after the range covered by leaf
+    fsw_u32     ind_bno[3];         //!< Disk block numbers of the indirect blocks in ind_data, or 0
+    fsw_u32     *ind_data[3];       //!< Copies of the indirect blocks visited last, by depth
 };
 
 
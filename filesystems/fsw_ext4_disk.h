@@ -381,9 +381,17 @@ struct ext4_super_block {
 
 #define EXT4_GOOD_OLD_INODE_SIZE 128
 
+/*
+ * Misc. filesystem flags (s_flags)
+ */
+#define EXT4_FLAGS_SIGNED_HASH          0x0001  /* Signed dirhash in use */
+#define EXT4_FLAGS_UNSIGNED_HASH        0x0002  /* Unsigned dirhash in use */
+
 /*
  * Feature set definitions (only the once we need for read support)
  */
+#define EXT4_FEATURE_COMPAT_DIR_INDEX           0x0020
+
 #define EXT4_FEATURE_RO_COMPAT_SPARSE_SUPER     0x0001
 
 #define EXT4_FEATURE_INCOMPAT_COMPRESSION	0x0001
@@ -440,6 +448,45 @@ enum {
     EXT4_FT_MAX
 };
 
+/*
+ * Hashed directory index (htree). The first block of an indexed directory
+ * holds fake "." and ".." entries followed by dx_root_info and the root
+ * dx_entry array; interior index blocks hold one empty fake entry spanning
+ * the whole block followed by a dx_entry array. The first dx_entry's hash
+ * field is replaced by the limit and count of the array.
+ */
+struct dx_root_info {
+    __le32  reserved_zero;
+    __u8    hash_version;
+    __u8    info_length;            /* 8 */
+    __u8    indirect_levels;
+    __u8    unused_flags;
+};
+
+struct dx_entry {
+    __le32  hash;
+    __le32  block;                  /* logical block within the directory */
+};
+
+struct dx_countlimit {
+    __le16  limit;
+    __le16  count;
+};
+
+#define EXT4_DX_ROOT_INFO_OFFSET    24  /* after the fake "." and ".." entries */
+#define EXT4_DX_NODE_ENTRIES_OFFSET 8   /* after the empty fake entry */
+#define EXT4_DX_MAX_LEVELS          3   /* root plus two interior levels with large_dir */
+
+/*
+ * Directory hash versions
+ */
+#define DX_HASH_LEGACY              0
+#define DX_HASH_HALF_MD4            1
+#define DX_HASH_TEA                 2
+#define DX_HASH_LEGACY_UNSIGNED     3
+#define DX_HASH_HALF_MD4_UNSIGNED   4
+#define DX_HASH_TEA_UNSIGNED        5
+
 /*
  * ext4_inode has i_block array (60 bytes total).
  * The first 12 bytes store ext4_extent_header;
@@ -496,5 +543,15 @@ struct ext4_extent_header {
 
 #define EXT4_EXT_MAGIC		(0xf30a)
 
+/*
+ * Extents longer than this are uninitialized, their length is ee_len minus this.
+ */
+#define EXT4_EXT_INIT_MAX_LEN	(1UL << 15)
+
+/*
+ * Maximum depth of an extent tree.
+ */
+#define EXT4_EXT_MAX_DEPTH	5
+
 
 #endif
@@ -1176,7 +1176,8 @@ static fsw_status_t fsw_hfs_dir_lookup(struct fsw_hfs_volume * vol,
     fsw_u16                    rec_type;
     BTNodeDescriptor *         node = NULL;
     struct fsw_string          rec_name;
-    int                        free_data = 0, i;
+    struct fsw_arena_mark      mark;
+    int                        i;
     HFSPlusCatalogKey*         file_key;
     file_info_t                file_info;
     fsw_u8*                    base;
@@ -1187,6 +1188,8 @@ static fsw_status_t fsw_hfs_dir_lookup(struct fsw_hfs_volume * vol,
 
     catkey.parentID = dno->g.dnode_id;
     catkey.nodeName.length = (fsw_u16)lookup_name->len;
+    /* a converted name is only needed during the lookup */
+    fsw_arena_mark(&vol->g.arena, &mark);
 
     /* no need to allocate anything */
     if (lookup_name->type == FSW_STRING_TYPE_UTF16)
@@ -1195,11 +1198,10 @@ static fsw_status_t fsw_hfs_dir_lookup(struct fsw_hfs_volume * vol,
         rec_name = *lookup_name;
     } else
     {
-        status = fsw_strdup_coerce(&rec_name, FSW_STRING_TYPE_UTF16, lookup_name);
+        status = fsw_strdup_coerce_arena(&vol->g.arena, &rec_name, FSW_STRING_TYPE_UTF16, lookup_name);
         /* nothing allocated so far */
         if (status)
             goto done;
-        free_data = 1;
         fsw_memcpy(catkey.nodeName.unicode, rec_name.data, rec_name.size);
     }
 
@@ -1289,8 +1291,7 @@ done:
     if (node != NULL)
         fsw_free(node);
 
-    if (free_data)
-        fsw_strfree(&rec_name);
+    fsw_arena_release(&vol->g.arena, &mark);
 
     return status;
 }
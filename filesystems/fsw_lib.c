@@ -37,9 +37,30 @@
 
 #include "fsw_core.h"
 
+static fsw_status_t fsw_strdata_alloc(struct fsw_arena *arena, int size, void **ptr_out);
+static fsw_status_t fsw_strdup_coerce_in(struct fsw_arena *arena, struct fsw_string *dest, int type, struct fsw_string *src);
+
 /* Include generated string encoding specific functions */
 #include "fsw_strfunc.h"
 
+/** Alignment of slab objects and arena allocations. */
+#define FSW_ALLOC_ALIGN (8)
+
+/** Size of the header in front of each slab chunk, keeps the objects aligned. */
+#define FSW_SLAB_HEADER_SIZE ((sizeof(void *) + FSW_ALLOC_ALIGN - 1) & ~(FSW_ALLOC_ALIGN - 1))
+
+/**
+ * Internal: Header of an arena chunk, the chunk's data follows it.
+ */
+
+struct fsw_arena_chunk {
+    struct fsw_arena_chunk *next;   //!< Next (newer) chunk
+    fsw_u32     size;               //!< Number of usable bytes in this chunk
+};
+
+/** Size of the header in front of each arena chunk's data, keeps the data aligned. */
+#define FSW_ARENA_HEADER_SIZE ((sizeof(struct fsw_arena_chunk) + FSW_ALLOC_ALIGN - 1) & ~(FSW_ALLOC_ALIGN - 1))
+
 
 /**
  * Allocate memory and clear it.
@@ -71,6 +92,155 @@ fsw_status_t fsw_memdup(void **dest_out, void *src, int len)
     return FSW_SUCCESS;
 }
 
+/**
+ * Set up a slab cache for objects of the given size. No memory is allocated
+ * until the first object is requested.
+ */
+
+void fsw_slab_init(struct fsw_slab *slab, fsw_u32 obj_size, fsw_u32 chunk_objects)
+{
+    if (obj_size < sizeof(void *))
+        obj_size = sizeof(void *);
+    slab->obj_size = (obj_size + FSW_ALLOC_ALIGN - 1) & ~(FSW_ALLOC_ALIGN - 1);
+    slab->chunk_objects = chunk_objects ? chunk_objects : 1;
+    slab->free_list = NULL;
+    slab->chunks = NULL;
+}
+
+/**
+ * Allocate a zeroed object from a slab cache. A new chunk is requested from the
+ * host only when the free list is empty.
+ */
+
+fsw_status_t fsw_slab_alloc(struct fsw_slab *slab, void **ptr_out)
+{
+    fsw_status_t    status;
+    fsw_u8          *chunk, *obj;
+    fsw_u32         i;
+
+    if (slab->free_list == NULL) {
+        status = fsw_alloc(FSW_SLAB_HEADER_SIZE + slab->chunk_objects * slab->obj_size, &chunk);
+        if (status)
+            return status;
+        *(void **)chunk = slab->chunks;
+        slab->chunks = chunk;
+
+        obj = chunk + FSW_SLAB_HEADER_SIZE;
+        for (i = 0; i < slab->chunk_objects; i++, obj += slab->obj_size) {
+            *(void **)obj = slab->free_list;
+            slab->free_list = obj;
+        }
+    }
+
+    obj = slab->free_list;
+    slab->free_list = *(void **)obj;
+    fsw_memzero(obj, slab->obj_size);
+    *ptr_out = obj;
+    return FSW_SUCCESS;
+}
+
+/**
+ * Return an object to its slab cache.
+ */
+
+void fsw_slab_free(struct fsw_slab *slab, void *ptr)
+{
+    *(void **)ptr = slab->free_list;
+    slab->free_list = ptr;
+}
+
+/**
+ * Release all memory of a slab cache. All objects allocated from it become invalid.
+ */
+
+void fsw_slab_destroy(struct fsw_slab *slab)
+{
+    void            *chunk;
+
+    while (slab->chunks != NULL) {
+        chunk = slab->chunks;
+        slab->chunks = *(void **)chunk;
+        fsw_free(chunk);
+    }
+    slab->free_list = NULL;
+}
+
+/**
+ * Allocate memory from an arena. The memory stays valid until the arena is rewound
+ * past it with fsw_arena_release or destroyed; it must not be passed to fsw_free.
+ */
+
+fsw_status_t fsw_arena_alloc(struct fsw_arena *arena, fsw_u32 size, void **ptr_out)
+{
+    fsw_status_t    status;
+    struct fsw_arena_chunk *chunk, *next;
+    fsw_u32         chunk_size;
+
+    size = (size + FSW_ALLOC_ALIGN - 1) & ~(FSW_ALLOC_ALIGN - 1);
+
+    if (arena->current == NULL || arena->used + size > arena->current->size) {
+        // move on to the next chunk, reusing it if it is big enough
+        next = (arena->current != NULL) ? arena->current->next : arena->first;
+        if (next == NULL || next->size < size) {
+            chunk_size = (size > FSW_ARENA_CHUNK_SIZE) ? size : FSW_ARENA_CHUNK_SIZE;
+            status = fsw_alloc(FSW_ARENA_HEADER_SIZE + chunk_size, &chunk);
+            if (status)
+                return status;
+            chunk->size = chunk_size;
+            chunk->next = next;
+            if (arena->current != NULL)
+                arena->current->next = chunk;
+            else
+                arena->first = chunk;
+            next = chunk;
+        }
+        arena->current = next;
+        arena->used = 0;
+    }
+
+    *ptr_out = (fsw_u8 *)arena->current + FSW_ARENA_HEADER_SIZE + arena->used;
+    arena->used += size;
+    return FSW_SUCCESS;
+}
+
+/**
+ * Record the current position of an arena.
+ */
+
+void fsw_arena_mark(struct fsw_arena *arena, struct fsw_arena_mark *mark)
+{
+    mark->chunk = arena->current;
+    mark->used = arena->used;
+}
+
+/**
+ * Rewind an arena to a position recorded with fsw_arena_mark, releasing everything
+ * allocated since then. Marks must be released in the reverse order they were taken.
+ */
+
+void fsw_arena_release(struct fsw_arena *arena, struct fsw_arena_mark *mark)
+{
+    arena->current = mark->chunk;
+    arena->used = mark->used;
+}
+
+/**
+ * Release all memory of an arena.
+ */
+
+void fsw_arena_destroy(struct fsw_arena *arena)
+{
+    struct fsw_arena_chunk *chunk;
+
+    while (arena->first != NULL) {
+        chunk = arena->first;
+        arena->first = chunk->next;
+        fsw_free(chunk);
+    }
+    arena->current = NULL;
+    arena->used = 0;
+}
+
 /**
  * Get the length of a string. Returns the number of characters in the string.
  */
@@ -158,6 +328,17 @@ int fsw_streq_cstr(struct fsw_string *s1, const char *s2)
     return fsw_streq(s1, &temp_s);
 }
 
+/**
+ * Allocate the data of a string, either from an arena or from the host.
+ */
+
+static fsw_status_t fsw_strdata_alloc(struct fsw_arena *arena, int size, void **ptr_out)
+{
+    if (arena != NULL)
+        return fsw_arena_alloc(arena, size, ptr_out);
+    return fsw_alloc(size, ptr_out);
+}
+
 /**
  * Creates a duplicate of a string, converting it to the given encoding during the copy.
  * If the function returns FSW_SUCCESS, the caller must free the string later with
@@ -165,6 +346,27 @@ int fsw_streq_cstr(struct fsw_string *s1, const char *s2)
  */
 
 fsw_status_t fsw_strdup_coerce(struct fsw_string *dest, int type, struct fsw_string *src)
+{
+    return fsw_strdup_coerce_in(NULL, dest, type, src);
+}
+
+/**
+ * Creates a temporary duplicate of a string in an arena, converting it to the given
+ * encoding during the copy. This is meant for short-lived strings like the converted
+ * name in a directory lookup. The string must not be passed to fsw_strfree; it is
+ * released together with the arena memory, see fsw_arena_release.
+ */
+
+fsw_status_t fsw_strdup_coerce_arena(struct fsw_arena *arena, struct fsw_string *dest, int type, struct fsw_string *src)
+{
+    return fsw_strdup_coerce_in(arena, dest, type, src);
+}
+
+/**
+ * Internal: Common implementation of fsw_strdup_coerce and fsw_strdup_coerce_arena.
+ */
+
+static fsw_status_t fsw_strdup_coerce_in(struct fsw_arena *arena, struct fsw_string *dest, int type, struct fsw_string *src)
 {
     fsw_status_t    status;
 
@@ -179,7 +381,7 @@ fsw_status_t fsw_strdup_coerce(struct fsw_string *dest, int type, struct fsw_str
         dest->type = type;
         dest->len  = src->len;
         dest->size = src->size;
-        status = fsw_alloc(dest->size, &dest->data);
+        status = fsw_strdata_alloc(arena, dest->size, &dest->data);
         if (status)
             return status;
 
@@ -190,7 +392,7 @@ fsw_status_t fsw_strdup_coerce(struct fsw_string *dest, int type, struct fsw_str
     // dispatch to type-specific functions
     #define STRCOERCE_DISPATCH(type1, type2) \
       if (src->type == FSW_STRING_TYPE_##type1 && type == FSW_STRING_TYPE_##type2) \
-        return fsw_strcoerce_##type1##_##type2(src->data, src->len, dest);
+        return fsw_strcoerce_##type1##_##type2(src->data, src->len, dest, arena);
     STRCOERCE_DISPATCH(UTF8, ISO88591);
     STRCOERCE_DISPATCH(UTF16, ISO88591);
     STRCOERCE_DISPATCH(UTF16_SWAPPED, ISO88591);
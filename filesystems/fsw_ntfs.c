@@ -1379,9 +1379,12 @@ static fsw_status_t fsw_ntfs_dir_lookup(struct fsw_volume *volg, struct fsw_dnod
     fsw_status_t err;
     fsw_u64 block;
     fsw_u8 cpb;
+    struct fsw_arena_mark mark;
 
     *child_dno = NULL;
-    err = fsw_strdup_coerce(&s, FSW_STRING_TYPE_UTF16_LE, lookup_name);
+    /* the converted name is only needed during the lookup */
+    fsw_arena_mark(&volg->arena, &mark);
+    err = fsw_strdup_coerce_arena(&volg->arena, &s, FSW_STRING_TYPE_UTF16_LE, lookup_name);
     if(err)
 	return err;
 
@@ -1422,7 +1425,7 @@ static fsw_status_t fsw_ntfs_dir_lookup(struct fsw_volume *volg, struct fsw_dnod
 	    }
 
 	    if(cmp == 0) {
-		fsw_strfree(&s);
+		fsw_arena_release(&volg->arena, &mark);
 		return fsw_ntfs_create_subnode(dno, buf+off, child_dno);
 	    } else if(cmp < 0) {
 		if(!(flag & 1) || !dno->has_idxtree)
@@ -1444,7 +1447,7 @@ static fsw_status_t fsw_ntfs_dir_lookup(struct fsw_volume *volg, struct fsw_dnod
     }
 
 notfound:
-    fsw_strfree(&s);
+    fsw_arena_release(&volg->arena, &mark);
     return FSW_NOT_FOUND;
 }
 
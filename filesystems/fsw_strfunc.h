@@ -158,7 +158,7 @@ static int fsw_streq_UTF16_UTF16_SWAPPED(void *s1data, void *s2data, int len)
     return 1;
 }
 
-static fsw_status_t fsw_strcoerce_UTF8_ISO88591(void *srcdata, int srclen, struct fsw_string *dest)
+static fsw_status_t fsw_strcoerce_UTF8_ISO88591(void *srcdata, int srclen, struct fsw_string *dest, struct fsw_arena *arena)
 {
     fsw_status_t    status;
     int             i;
@@ -169,7 +169,7 @@ static fsw_status_t fsw_strcoerce_UTF8_ISO88591(void *srcdata, int srclen, struc
     dest->type = FSW_STRING_TYPE_ISO88591;
     dest->len  = srclen;
     dest->size = srclen * sizeof(fsw_u8);
-    status = fsw_alloc(dest->size, &dest->data);
+    status = fsw_strdata_alloc(arena, dest->size, &dest->data);
     if (status)
         return status;
     
@@ -192,7 +192,7 @@ static fsw_status_t fsw_strcoerce_UTF8_ISO88591(void *srcdata, int srclen, struc
     return FSW_SUCCESS;
 }
 
-static fsw_status_t fsw_strcoerce_UTF16_ISO88591(void *srcdata, int srclen, struct fsw_string *dest)
+static fsw_status_t fsw_strcoerce_UTF16_ISO88591(void *srcdata, int srclen, struct fsw_string *dest, struct fsw_arena *arena)
 {
     fsw_status_t    status;
     int             i;
@@ -203,7 +203,7 @@ static fsw_status_t fsw_strcoerce_UTF16_ISO88591(void *srcdata, int srclen, stru
     dest->type = FSW_STRING_TYPE_ISO88591;
     dest->len  = srclen;
     dest->size = srclen * sizeof(fsw_u8);
-    status = fsw_alloc(dest->size, &dest->data);
+    status = fsw_strdata_alloc(arena, dest->size, &dest->data);
     if (status)
         return status;
     
@@ -216,7 +216,7 @@ static fsw_status_t fsw_strcoerce_UTF16_ISO88591(void *srcdata, int srclen, stru
     return FSW_SUCCESS;
 }
 
-static fsw_status_t fsw_strcoerce_UTF16_SWAPPED_ISO88591(void *srcdata, int srclen, struct fsw_string *dest)
+static fsw_status_t fsw_strcoerce_UTF16_SWAPPED_ISO88591(void *srcdata, int srclen, struct fsw_string *dest, struct fsw_arena *arena)
 {
     fsw_status_t    status;
     int             i;
@@ -227,7 +227,7 @@ static fsw_status_t fsw_strcoerce_UTF16_SWAPPED_ISO88591(void *srcdata, int srcl
     dest->type = FSW_STRING_TYPE_ISO88591;
     dest->len  = srclen;
     dest->size = srclen * sizeof(fsw_u8);
-    status = fsw_alloc(dest->size, &dest->data);
+    status = fsw_strdata_alloc(arena, dest->size, &dest->data);
     if (status)
         return status;
     
@@ -240,7 +240,7 @@ static fsw_status_t fsw_strcoerce_UTF16_SWAPPED_ISO88591(void *srcdata, int srcl
     return FSW_SUCCESS;
 }
 
-static fsw_status_t fsw_strcoerce_ISO88591_UTF16(void *srcdata, int srclen, struct fsw_string *dest)
+static fsw_status_t fsw_strcoerce_ISO88591_UTF16(void *srcdata, int srclen, struct fsw_string *dest, struct fsw_arena *arena)
 {
     fsw_status_t    status;
     int             i;
@@ -251,7 +251,7 @@ static fsw_status_t fsw_strcoerce_ISO88591_UTF16(void *srcdata, int srclen, stru
     dest->type = FSW_STRING_TYPE_UTF16;
     dest->len  = srclen;
     dest->size = srclen * sizeof(fsw_u16);
-    status = fsw_alloc(dest->size, &dest->data);
+    status = fsw_strdata_alloc(arena, dest->size, &dest->data);
     if (status)
         return status;
     
@@ -264,7 +264,7 @@ static fsw_status_t fsw_strcoerce_ISO88591_UTF16(void *srcdata, int srclen, stru
     return FSW_SUCCESS;
 }
 
-static fsw_status_t fsw_strcoerce_UTF8_UTF16(void *srcdata, int srclen, struct fsw_string *dest)
+static fsw_status_t fsw_strcoerce_UTF8_UTF16(void *srcdata, int srclen, struct fsw_string *dest, struct fsw_arena *arena)
 {
     fsw_status_t    status;
     int             i;
@@ -275,7 +275,7 @@ static fsw_status_t fsw_strcoerce_UTF8_UTF16(void *srcdata, int srclen, struct f
     dest->type = FSW_STRING_TYPE_UTF16;
     dest->len  = srclen;
     dest->size = srclen * sizeof(fsw_u16);
-    status = fsw_alloc(dest->size, &dest->data);
+    status = fsw_strdata_alloc(arena, dest->size, &dest->data);
     if (status)
         return status;
     
@@ -298,7 +298,7 @@ static fsw_status_t fsw_strcoerce_UTF8_UTF16(void *srcdata, int srclen, struct f
     return FSW_SUCCESS;
 }
 
-static fsw_status_t fsw_strcoerce_UTF16_SWAPPED_UTF16(void *srcdata, int srclen, struct fsw_string *dest)
+static fsw_status_t fsw_strcoerce_UTF16_SWAPPED_UTF16(void *srcdata, int srclen, struct fsw_string *dest, struct fsw_arena *arena)
 {
     fsw_status_t    status;
     int             i;
@@ -309,7 +309,7 @@ static fsw_status_t fsw_strcoerce_UTF16_SWAPPED_UTF16(void *srcdata, int srclen,
     dest->type = FSW_STRING_TYPE_UTF16;
     dest->len  = srclen;
     dest->size = srclen * sizeof(fsw_u16);
-    status = fsw_alloc(dest->size, &dest->data);
+    status = fsw_strdata_alloc(arena, dest->size, &dest->data);
     if (status)
         return status;
     
@@ -322,7 +322,7 @@ static fsw_status_t fsw_strcoerce_UTF16_SWAPPED_UTF16(void *srcdata, int srclen,
     return FSW_SUCCESS;
 }
 
-static fsw_status_t fsw_strcoerce_ISO88591_UTF8(void *srcdata, int srclen, struct fsw_string *dest)
+static fsw_status_t fsw_strcoerce_ISO88591_UTF8(void *srcdata, int srclen, struct fsw_string *dest, struct fsw_arena *arena)
 {
     fsw_status_t    status;
     int             i, destsize;
@@ -348,7 +348,7 @@ static fsw_status_t fsw_strcoerce_ISO88591_UTF8(void *srcdata, int srclen, struc
     dest->type = FSW_STRING_TYPE_UTF8;
     dest->len  = srclen;
     dest->size = destsize;
-    status = fsw_alloc(dest->size, &dest->data);
+    status = fsw_strdata_alloc(arena, dest->size, &dest->data);
     if (status)
         return status;
     
@@ -376,7 +376,7 @@ static fsw_status_t fsw_strcoerce_ISO88591_UTF8(void *srcdata, int srclen, struc
     return FSW_SUCCESS;
 }
 
-static fsw_status_t fsw_strcoerce_UTF16_UTF8(void *srcdata, int srclen, struct fsw_string *dest)
+static fsw_status_t fsw_strcoerce_UTF16_UTF8(void *srcdata, int srclen, struct fsw_string *dest, struct fsw_arena *arena)
 {
     fsw_status_t    status;
     int             i, destsize;
@@ -402,7 +402,7 @@ static fsw_status_t fsw_strcoerce_UTF16_UTF8(void *srcdata, int srclen, struct f
     dest->type = FSW_STRING_TYPE_UTF8;
     dest->len  = srclen;
     dest->size = destsize;
-    status = fsw_alloc(dest->size, &dest->data);
+    status = fsw_strdata_alloc(arena, dest->size, &dest->data);
     if (status)
         return status;
     
@@ -430,7 +430,7 @@ static fsw_status_t fsw_strcoerce_UTF16_UTF8(void *srcdata, int srclen, struct f
     return FSW_SUCCESS;
 }
 
-static fsw_status_t fsw_strcoerce_UTF16_SWAPPED_UTF8(void *srcdata, int srclen, struct fsw_string *dest)
+static fsw_status_t fsw_strcoerce_UTF16_SWAPPED_UTF8(void *srcdata, int srclen, struct fsw_string *dest, struct fsw_arena *arena)
 {
     fsw_status_t    status;
     int             i, destsize;
@@ -456,7 +456,7 @@ static fsw_status_t fsw_strcoerce_UTF16_SWAPPED_UTF8(void *srcdata, int srclen,
     dest->type = FSW_STRING_TYPE_UTF8;
     dest->len  = srclen;
     dest->size = destsize;
-    status = fsw_alloc(dest->size, &dest->data);
+    status = fsw_strdata_alloc(arena, dest->size, &dest->data);
     if (status)
         return status;
     
@@ -111,7 +111,7 @@ for enc2 in ('ISO88591', 'UTF16'):
         type2 = types[enc2]
         getnext1 = getnext[enc1].replace('VARC', 'c').replace('VARP', 'sp').replace("\n", "\n        ")
         output += """
-static fsw_status_t fsw_strcoerce_%(enc1)s_%(enc2)s(void *srcdata, int srclen, struct fsw_string *dest)
+static fsw_status_t fsw_strcoerce_%(enc1)s_%(enc2)s(void *srcdata, int srclen, struct fsw_string *dest, struct fsw_arena *arena)
 {
     fsw_status_t    status;
     int             i;
@@ -122,7 +122,7 @@ static fsw_status_t fsw_strcoerce_%(enc1)s_%(enc2)s(void *srcdata, int srclen, s
     dest->type = FSW_STRING_TYPE_%(enc2)s;
     dest->len  = srclen;
     dest->size = srclen * sizeof(%(type2)s);
-    status = fsw_alloc(dest->size, &dest->data);
+    status = fsw_strdata_alloc(arena, dest->size, &dest->data);
     if (status)
         return status;
     
@@ -142,7 +142,7 @@ for enc2 in ('UTF8',):
         type2 = types[enc2]
         getnext1 = getnext[enc1].replace('VARC', 'c').replace('VARP', 'sp').replace("\n", "\n        ")
         output += """
-static fsw_status_t fsw_strcoerce_%(enc1)s_%(enc2)s(void *srcdata, int srclen, struct fsw_string *dest)
+static fsw_status_t fsw_strcoerce_%(enc1)s_%(enc2)s(void *srcdata, int srclen, struct fsw_string *dest, struct fsw_arena *arena)
 {
     fsw_status_t    status;
     int             i, destsize;
@@ -168,7 +168,7 @@ static fsw_status_t fsw_strcoerce_%(enc1)s_%(enc2)s(void *srcdata, int srclen, s
     dest->type = FSW_STRING_TYPE_%(enc2)s;
     dest->len  = srclen;
     dest->size = destsize;
-    status = fsw_alloc(dest->size, &dest->data);
+    status = fsw_strdata_alloc(arena, dest->size, &dest->data);
     if (status)
         return status;
     
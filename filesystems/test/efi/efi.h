@@ -0,0 +1,340 @@
+/**
+ * \file efi.h
+ * Minimal stand-in for the GNU-EFI headers, used to build fsw_efi.c as a
+ * Linux program (see efilslr.c). Only the types, constants and boot services
+ * used by the fsw code are declared. The layouts of the protocol and
+ * information structures follow the UEFI specification, but the boot services
+ * table is reduced to the members the driver calls and is not ABI compatible
+ * with real firmware.
+ */
+
+/*-
+ * Copyright (c) 2026 rEFInd contributors
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *  * Neither the name of the copyright holders nor the names of the
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _EFI_SHIM_EFI_H_
+#define _EFI_SHIM_EFI_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if __SIZEOF_WCHAR_T__ != 2
+#error "the EFI shim must be compiled with -fshort-wchar"
+#endif
+
+
+// base types
+
+typedef uint8_t     UINT8;
+typedef int8_t      INT8;
+typedef uint16_t    UINT16;
+typedef int16_t     INT16;
+typedef uint32_t    UINT32;
+typedef int32_t     INT32;
+typedef uint64_t    UINT64;
+typedef int64_t     INT64;
+typedef uintptr_t   UINTN;
+typedef intptr_t    INTN;
+typedef UINT8       BOOLEAN;
+typedef char        CHAR8;
+typedef UINT16      CHAR16;
+#define VOID        void
+
+#define IN
+#define OUT
+#define OPTIONAL
+#define CONST       const
+#define EFIAPI
+#define EFI_FUNCTION
+
+// all code shares the host calling convention, so no thunking is needed
+#define uefi_call_wrapper(func, va_num, ...)    func(__VA_ARGS__)
+
+#ifndef TRUE
+#define TRUE        ((BOOLEAN) 1)
+#define FALSE       ((BOOLEAN) 0)
+#endif
+
+typedef UINTN       EFI_STATUS;
+typedef VOID        *EFI_HANDLE;
+typedef VOID        *EFI_EVENT;
+typedef UINT64      EFI_LBA;
+typedef UINTN       EFI_TPL;
+
+typedef struct {
+    UINT32  Data1;
+    UINT16  Data2;
+    UINT16  Data3;
+    UINT8   Data4[8];
+} EFI_GUID;
+
+typedef struct {
+    UINT16  Year;
+    UINT8   Month;
+    UINT8   Day;
+    UINT8   Hour;
+    UINT8   Minute;
+    UINT8   Second;
+    UINT8   Pad1;
+    UINT32  Nanosecond;
+    INT16   TimeZone;
+    UINT8   Daylight;
+    UINT8   Pad2;
+} EFI_TIME;
+
+#define EFI_FIELD_OFFSET(TYPE,Field)    ((UINTN) offsetof(TYPE, Field))
+#define EFI_SIGNATURE_16(A,B)           ((A) | ((B) << 8))
+#define EFI_SIGNATURE_32(A,B,C,D)       (EFI_SIGNATURE_16(A,B) | (EFI_SIGNATURE_16(C,D) << 16))
+#define CR(Record, TYPE, Field, Signature) \
+    ((TYPE *) ((CHAR8 *) (Record) - (CHAR8 *) &(((TYPE *) 0)->Field)))
+
+
+// status codes
+
+#define EFI_MAX_BIT                     ((UINTN) 1 << (sizeof(UINTN) * 8 - 1))
+#define EFIERR(a)                       (EFI_MAX_BIT | (a))
+#define EFIWARN(a)                      (a)
+#define EFI_ERROR(a)                    (((INTN) (a)) < 0)
+
+#define EFI_SUCCESS                     0
+#define EFI_LOAD_ERROR                  EFIERR(1)
+#define EFI_INVALID_PARAMETER           EFIERR(2)
+#define EFI_UNSUPPORTED                 EFIERR(3)
+#define EFI_BAD_BUFFER_SIZE             EFIERR(4)
+#define EFI_BUFFER_TOO_SMALL            EFIERR(5)
+#define EFI_NOT_READY                   EFIERR(6)
+#define EFI_DEVICE_ERROR                EFIERR(7)
+#define EFI_WRITE_PROTECTED             EFIERR(8)
+#define EFI_OUT_OF_RESOURCES            EFIERR(9)
+#define EFI_VOLUME_CORRUPTED            EFIERR(10)
+#define EFI_VOLUME_FULL                 EFIERR(11)
+#define EFI_NO_MEDIA                    EFIERR(12)
+#define EFI_MEDIA_CHANGED               EFIERR(13)
+#define EFI_NOT_FOUND                   EFIERR(14)
+#define EFI_ACCESS_DENIED               EFIERR(15)
+#define EFI_NO_RESPONSE                 EFIERR(16)
+#define EFI_NO_MAPPING                  EFIERR(17)
+#define EFI_TIMEOUT                     EFIERR(18)
+#define EFI_NOT_STARTED                 EFIERR(19)
+#define EFI_ALREADY_STARTED             EFIERR(20)
+#define EFI_ABORTED                     EFIERR(21)
+
+#define EFI_WARN_UNKOWN_GLYPH           EFIWARN(1)
+#define EFI_WARN_DELETE_FAILURE         EFIWARN(2)
+#define EFI_WARN_WRITE_FAILURE          EFIWARN(3)
+#define EFI_WARN_BUFFER_TOO_SMALL       EFIWARN(4)
+
+
+// boot services
+
+#define TPL_APPLICATION                 4
+#define TPL_CALLBACK                    8
+#define TPL_NOTIFY                      16
+
+#define EVT_TIMER                       0x80000000
+#define EVT_NOTIFY_WAIT                 0x00000100
+#define EVT_NOTIFY_SIGNAL               0x00000200
+
+#define EFI_OPEN_PROTOCOL_BY_HANDLE_PROTOCOL    0x00000001
+#define EFI_OPEN_PROTOCOL_GET_PROTOCOL          0x00000002
+#define EFI_OPEN_PROTOCOL_TEST_PROTOCOL         0x00000004
+#define EFI_OPEN_PROTOCOL_BY_CHILD_CONTROLLER   0x00000008
+#define EFI_OPEN_PROTOCOL_BY_DRIVER             0x00000010
+#define EFI_OPEN_PROTOCOL_EXCLUSIVE             0x00000020
+
+typedef enum {
+    EFI_NATIVE_INTERFACE
+} EFI_INTERFACE_TYPE;
+
+typedef enum {
+    AllHandles,
+    ByRegisterNotify,
+    ByProtocol
+} EFI_LOCATE_SEARCH_TYPE;
+
+typedef VOID (EFIAPI *EFI_EVENT_NOTIFY)(IN EFI_EVENT Event, IN VOID *Context);
+
+typedef struct {
+    EFI_STATUS (EFIAPI *InstallProtocolInterface)(IN OUT EFI_HANDLE *Handle, IN EFI_GUID *Protocol,
+                                                  IN EFI_INTERFACE_TYPE InterfaceType, IN VOID *Interface);
+    EFI_STATUS (EFIAPI *HandleProtocol)(IN EFI_HANDLE Handle, IN EFI_GUID *Protocol, OUT VOID **Interface);
+    EFI_STATUS (EFIAPI *LocateHandleBuffer)(IN EFI_LOCATE_SEARCH_TYPE SearchType, IN EFI_GUID *Protocol OPTIONAL,
+                                            IN VOID *SearchKey OPTIONAL, OUT UINTN *NoHandles,
+                                            OUT EFI_HANDLE **Buffer);
+    EFI_STATUS (EFIAPI *OpenProtocol)(IN EFI_HANDLE Handle, IN EFI_GUID *Protocol, OUT VOID **Interface,
+                                      IN EFI_HANDLE AgentHandle, IN EFI_HANDLE ControllerHandle,
+                                      IN UINT32 Attributes);
+    EFI_STATUS (EFIAPI *CloseProtocol)(IN EFI_HANDLE Handle, IN EFI_GUID *Protocol,
+                                       IN EFI_HANDLE AgentHandle, IN EFI_HANDLE ControllerHandle);
+    EFI_STATUS (EFIAPI *InstallMultipleProtocolInterfaces)(IN OUT EFI_HANDLE *Handle, ...);
+    EFI_STATUS (EFIAPI *UninstallMultipleProtocolInterfaces)(IN EFI_HANDLE Handle, ...);
+    EFI_STATUS (EFIAPI *CreateEvent)(IN UINT32 Type, IN EFI_TPL NotifyTpl, IN EFI_EVENT_NOTIFY NotifyFunction,
+                                     IN VOID *NotifyContext, OUT EFI_EVENT *Event);
+    EFI_STATUS (EFIAPI *CheckEvent)(IN EFI_EVENT Event);
+    EFI_STATUS (EFIAPI *CloseEvent)(IN EFI_EVENT Event);
+} EFI_BOOT_SERVICES;
+
+typedef struct {
+    CHAR16              *FirmwareVendor;
+    UINT32              FirmwareRevision;
+    EFI_BOOT_SERVICES   *BootServices;
+} EFI_SYSTEM_TABLE;
+
+#define EFI_DRIVER_ENTRY_POINT(InitFunction)
+
+// like GNU-EFI without EFI_DEBUG, debug output compiles to nothing
+#define DEBUG(a)
+
+
+// block and disk I/O protocols
+
+#define BLOCK_IO_PROTOCOL \
+    { 0x964e5b21, 0x6459, 0x11d2, {0x8e, 0x39, 0x0, 0xa0, 0xc9, 0x69, 0x72, 0x3b} }
+#define EFI_BLOCK_IO_INTERFACE_REVISION 0x00010000
+
+typedef struct {
+    UINT32      MediaId;
+    BOOLEAN     RemovableMedia;
+    BOOLEAN     MediaPresent;
+    BOOLEAN     LogicalPartition;
+    BOOLEAN     ReadOnly;
+    BOOLEAN     WriteCaching;
+    UINT32      BlockSize;
+    UINT32      IoAlign;
+    EFI_LBA     LastBlock;
+} EFI_BLOCK_IO_MEDIA;
+
+typedef struct _EFI_BLOCK_IO {
+    UINT64              Revision;
+    EFI_BLOCK_IO_MEDIA  *Media;
+    EFI_STATUS (EFIAPI *Reset)(IN struct _EFI_BLOCK_IO *This, IN BOOLEAN ExtendedVerification);
+    EFI_STATUS (EFIAPI *ReadBlocks)(IN struct _EFI_BLOCK_IO *This, IN UINT32 MediaId, IN EFI_LBA LBA,
+                                    IN UINTN BufferSize, OUT VOID *Buffer);
+    EFI_STATUS (EFIAPI *WriteBlocks)(IN struct _EFI_BLOCK_IO *This, IN UINT32 MediaId, IN EFI_LBA LBA,
+                                     IN UINTN BufferSize, IN VOID *Buffer);
+    EFI_STATUS (EFIAPI *FlushBlocks)(IN struct _EFI_BLOCK_IO *This);
+} EFI_BLOCK_IO;
+
+#define DISK_IO_PROTOCOL \
+    { 0xce345171, 0xba0b, 0x11d2, {0x8e, 0x4f, 0x0, 0xa0, 0xc9, 0x69, 0x72, 0x3b} }
+#define EFI_DISK_IO_INTERFACE_REVISION  0x00010000
+
+typedef struct _EFI_DISK_IO {
+    UINT64      Revision;
+    EFI_STATUS (EFIAPI *ReadDisk)(IN struct _EFI_DISK_IO *This, IN UINT32 MediaId, IN UINT64 Offset,
+                                  IN UINTN BufferSize, OUT VOID *Buffer);
+    EFI_STATUS (EFIAPI *WriteDisk)(IN struct _EFI_DISK_IO *This, IN UINT32 MediaId, IN UINT64 Offset,
+                                   IN UINTN BufferSize, IN VOID *Buffer);
+} EFI_DISK_IO;
+
+
+// simple file system protocol
+
+#define SIMPLE_FILE_SYSTEM_PROTOCOL \
+    { 0x964e5b22, 0x6459, 0x11d2, {0x8e, 0x39, 0x0, 0xa0, 0xc9, 0x69, 0x72, 0x3b} }
+#define EFI_FILE_IO_INTERFACE_REVISION  0x00010000
+#define EFI_FILE_HANDLE_REVISION        0x00010000
+
+#define EFI_FILE_MODE_READ              0x0000000000000001ULL
+#define EFI_FILE_MODE_WRITE             0x0000000000000002ULL
+#define EFI_FILE_MODE_CREATE            0x8000000000000000ULL
+
+#define EFI_FILE_READ_ONLY              0x0000000000000001ULL
+#define EFI_FILE_HIDDEN                 0x0000000000000002ULL
+#define EFI_FILE_SYSTEM                 0x0000000000000004ULL
+#define EFI_FILE_RESERVED               0x0000000000000008ULL
+#define EFI_FILE_DIRECTORY              0x0000000000000010ULL
+#define EFI_FILE_ARCHIVE                0x0000000000000020ULL
+#define EFI_FILE_VALID_ATTR             0x0000000000000037ULL
+
+typedef struct _EFI_FILE_HANDLE {
+    UINT64      Revision;
+    EFI_STATUS (EFIAPI *Open)(IN struct _EFI_FILE_HANDLE *File, OUT struct _EFI_FILE_HANDLE **NewHandle,
+                              IN CHAR16 *FileName, IN UINT64 OpenMode, IN UINT64 Attributes);
+    EFI_STATUS (EFIAPI *Close)(IN struct _EFI_FILE_HANDLE *File);
+    EFI_STATUS (EFIAPI *Delete)(IN struct _EFI_FILE_HANDLE *File);
+    EFI_STATUS (EFIAPI *Read)(IN struct _EFI_FILE_HANDLE *File, IN OUT UINTN *BufferSize, OUT VOID *Buffer);
+    EFI_STATUS (EFIAPI *Write)(IN struct _EFI_FILE_HANDLE *File, IN OUT UINTN *BufferSize, IN VOID *Buffer);
+    EFI_STATUS (EFIAPI *GetPosition)(IN struct _EFI_FILE_HANDLE *File, OUT UINT64 *Position);
+    EFI_STATUS (EFIAPI *SetPosition)(IN struct _EFI_FILE_HANDLE *File, IN UINT64 Position);
+    EFI_STATUS (EFIAPI *GetInfo)(IN struct _EFI_FILE_HANDLE *File, IN EFI_GUID *InformationType,
+                                 IN OUT UINTN *BufferSize, OUT VOID *Buffer);
+    EFI_STATUS (EFIAPI *SetInfo)(IN struct _EFI_FILE_HANDLE *File, IN EFI_GUID *InformationType,
+                                 IN UINTN BufferSize, IN VOID *Buffer);
+    EFI_STATUS (EFIAPI *Flush)(IN struct _EFI_FILE_HANDLE *File);
+} EFI_FILE, *EFI_FILE_HANDLE;
+
+typedef struct _EFI_FILE_IO_INTERFACE {
+    UINT64      Revision;
+    EFI_STATUS (EFIAPI *OpenVolume)(IN struct _EFI_FILE_IO_INTERFACE *This, OUT EFI_FILE_HANDLE *Root);
+} EFI_FILE_IO_INTERFACE;
+
+#define EFI_FILE_INFO_ID \
+    { 0x9576e92, 0x6d3f, 0x11d2, {0x8e, 0x39, 0x0, 0xa0, 0xc9, 0x69, 0x72, 0x3b} }
+
+typedef struct {
+    UINT64      Size;
+    UINT64      FileSize;
+    UINT64      PhysicalSize;
+    EFI_TIME    CreateTime;
+    EFI_TIME    LastAccessTime;
+    EFI_TIME    ModificationTime;
+    UINT64      Attribute;
+    CHAR16      FileName[1];
+} EFI_FILE_INFO;
+
+#define SIZE_OF_EFI_FILE_INFO           EFI_FIELD_OFFSET(EFI_FILE_INFO, FileName)
+
+#define EFI_FILE_SYSTEM_INFO_ID \
+    { 0x9576e93, 0x6d3f, 0x11d2, {0x8e, 0x39, 0x0, 0xa0, 0xc9, 0x69, 0x72, 0x3b} }
+
+typedef struct {
+    UINT64      Size;
+    BOOLEAN     ReadOnly;
+    UINT64      VolumeSize;
+    UINT64      FreeSpace;
+    UINT32      BlockSize;
+    CHAR16      VolumeLabel[1];
+} EFI_FILE_SYSTEM_INFO;
+
+#define SIZE_OF_EFI_FILE_SYSTEM_INFO    EFI_FIELD_OFFSET(EFI_FILE_SYSTEM_INFO, VolumeLabel)
+
+#define EFI_FILE_SYSTEM_VOLUME_LABEL_INFO_ID \
+    { 0xDB47D7D3, 0xFE81, 0x11d3, {0x9A, 0x35, 0x00, 0x90, 0x27, 0x3F, 0xC1, 0x4D} }
+
+typedef struct {
+    CHAR16      VolumeLabel[1];
+} EFI_FILE_SYSTEM_VOLUME_LABEL_INFO;
+
+#define SIZE_OF_EFI_FILE_SYSTEM_VOLUME_LABEL_INFO \
+    EFI_FIELD_OFFSET(EFI_FILE_SYSTEM_VOLUME_LABEL_INFO, VolumeLabel)
+
+#endif
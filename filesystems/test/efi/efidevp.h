@@ -0,0 +1,12 @@
+/**
+ * \file efidevp.h
+ * Device path declarations for the Linux EFI shim. The fsw driver only passes
+ * device path pointers through, so nothing beyond the include is needed.
+ */
+
+#ifndef _EFI_SHIM_EFIDEVP_H_
+#define _EFI_SHIM_EFIDEVP_H_
+
+#include "efi.h"
+
+#endif
@@ -0,0 +1,39 @@
+/**
+ * \file efilib.h
+ * Library functions of the Linux EFI shim, mirroring the subset of the
+ * GNU-EFI library used by the fsw code. Implemented in fsw_efi_shim.c.
+ */
+
+#ifndef _EFI_SHIM_EFILIB_H_
+#define _EFI_SHIM_EFILIB_H_
+
+#include "efi.h"
+
+extern EFI_SYSTEM_TABLE     *ST;
+extern EFI_BOOT_SERVICES    *BS;
+
+extern EFI_GUID FileSystemProtocol;
+extern EFI_GUID BlockIoProtocol;
+extern EFI_GUID DiskIoProtocol;
+
+VOID InitializeLib(IN EFI_HANDLE ImageHandle, IN EFI_SYSTEM_TABLE *SystemTable);
+
+VOID *AllocatePool(IN UINTN Size);
+VOID *AllocateZeroPool(IN UINTN Size);
+VOID FreePool(IN VOID *p);
+VOID CopyMem(IN VOID *Dest, IN CONST VOID *Src, IN UINTN len);
+VOID ZeroMem(IN VOID *Buffer, IN UINTN Size);
+INTN CompareMem(IN CONST VOID *Dest, IN CONST VOID *Src, IN UINTN len);
+INTN CompareGuid(IN EFI_GUID *Guid1, IN EFI_GUID *Guid2);
+
+UINTN StrLen(IN CONST CHAR16 *s1);
+UINTN StrSize(IN CONST CHAR16 *s1);
+INTN StrCmp(IN CONST CHAR16 *s1, IN CONST CHAR16 *s2);
+UINTN Print(IN CONST CHAR16 *fmt, ...);
+
+UINT64 LShiftU64(IN UINT64 Operand, IN UINTN Count);
+UINT64 RShiftU64(IN UINT64 Operand, IN UINTN Count);
+UINT64 MultU64x32(IN UINT64 Multiplicand, IN UINTN Multiplier);
+UINT64 DivU64x32(IN UINT64 Dividend, IN UINTN Divisor, OUT UINTN *Remainder OPTIONAL);
+
+#endif
@@ -0,0 +1,307 @@
+/**
+ * \file efilslr.c
+ * Test program for the EFI host. Runs the unmodified fsw_efi.c on top of the
+ * Linux shim: starts the driver on a disk image through its Driver Binding
+ * protocol, then lists (and optionally reads) a directory tree through the
+ * resulting Simple File System and EFI_FILE protocols.
+ */
+
+/*-
+ * Copyright (c) 2026 rEFInd contributors
+ * Portions Copyright (c) 2006 Christoph Pfisterer
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *  * Neither the name of Christoph Pfisterer nor the names of the
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "fsw_efi_shim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __MAKEWITH_GNUEFI
+#include "edk2/DriverBinding.h"
+#endif
+
+extern REFIND_EFI_DRIVER_BINDING_PROTOCOL fsw_efi_DriverBinding_table;
+extern EFI_GUID gFswEfiStatsProtocolGuid;
+extern EFI_GUID gMyEfiFileSystemInfoGuid;
+extern EFI_GUID gMyEfiFileInfoGuid;
+
+EFI_STATUS EFIAPI fsw_efi_main(IN EFI_HANDLE ImageHandle, IN EFI_SYSTEM_TABLE *SystemTable);
+
+static int read_files = 0;
+static UINTN read_chunk = 65536;
+static int errors = 0;
+
+static void print_name(CHAR16 *name)
+{
+    for (; *name; name++)
+        putchar(*name < 0x80 ? (int) *name : '?');
+}
+
+/**
+ * Read a whole file through EFI_FILE.Read in chunks of read_chunk bytes and
+ * check that the amount read matches the size reported by GetInfo on the
+ * same handle (which differs from the directory entry for symlinks).
+ */
+
+static void readfile(EFI_FILE *File)
+{
+    static UINT8 buffer[1024 * 1024];
+    EFI_STATUS  Status;
+    UINTN       BufferSize, i;
+    UINT64      Info[(sizeof(EFI_FILE_INFO) + 512 * sizeof(CHAR16)) / sizeof(UINT64) + 1];
+    EFI_FILE_INFO *FileInfo = (EFI_FILE_INFO *) Info;
+    UINT64      Total = 0;
+    UINT32      Sum = 0;
+
+    BufferSize = sizeof(Info);
+    Status = File->GetInfo(File, &gMyEfiFileInfoGuid, &BufferSize, FileInfo);
+    if (EFI_ERROR(Status)) {
+        printf("  GETINFO ERROR (status 0x%llx)", (unsigned long long) Status);
+        errors++;
+        return;
+    }
+    for (;;) {
+        BufferSize = read_chunk;
+        Status = File->Read(File, &BufferSize, buffer);
+        if (EFI_ERROR(Status) || BufferSize == 0)
+            break;
+        for (i = 0; i < BufferSize; i++)
+            Sum = (Sum << 1 | Sum >> 31) + buffer[i];
+        Total += BufferSize;
+    }
+    printf("  %08x", Sum);
+    if (EFI_ERROR(Status) || Total != FileInfo->FileSize) {
+        printf("  READ ERROR (status 0x%llx, %llu bytes)", (unsigned long long) Status, (unsigned long long) Total);
+        errors++;
+    }
+}
+
+/**
+ * List a directory recursively by reading EFI_FILE_INFO records from its
+ * handle and opening each entry by name.
+ */
+
+static void listdir(EFI_FILE *Dir, int level)
+{
+    EFI_STATUS  Status;
+    EFI_FILE    *Child;
+    UINTN       BufferSize;
+    UINT64      Buffer[(sizeof(EFI_FILE_INFO) + 512 * sizeof(CHAR16)) / sizeof(UINT64) + 1];
+    EFI_FILE_INFO *FileInfo = (EFI_FILE_INFO *) Buffer;
+    int         i;
+
+    for (;;) {
+        BufferSize = sizeof(Buffer);
+        Status = Dir->Read(Dir, &BufferSize, FileInfo);
+        if (EFI_ERROR(Status)) {
+            printf("Read on directory failed with status 0x%llx\n", (unsigned long long) Status);
+            errors++;
+            return;
+        }
+        if (BufferSize == 0)
+            return;
+
+        for (i = 0; i < level * 2; i++)
+            putchar(' ');
+        printf("%c %10llu  ", (FileInfo->Attribute & EFI_FILE_DIRECTORY) ? 'd' : '-',
+               (unsigned long long) FileInfo->FileSize);
+        print_name(FileInfo->FileName);
+
+        Status = Dir->Open(Dir, &Child, FileInfo->FileName, EFI_FILE_MODE_READ, 0);
+        if (EFI_ERROR(Status)) {
+            printf("  OPEN ERROR (status 0x%llx)\n", (unsigned long long) Status);
+            errors++;
+            continue;
+        }
+        if (FileInfo->Attribute & EFI_FILE_DIRECTORY) {
+            putchar('\n');
+            listdir(Child, level + 1);
+        } else {
+            if (read_files)
+                readfile(Child);
+            putchar('\n');
+        }
+        Child->Close(Child);
+    }
+}
+
+static void print_stats(EFI_HANDLE ControllerHandle)
+{
+    FSW_EFI_STATS_PROTOCOL  *Stats;
+    struct fsw_io_stats     io;
+    FSW_EFI_CACHE_TRACE     Trace;
+    FSW_EFI_SHIM_DISK_STATS Disk;
+    UINTN                   Size;
+    int                     i;
+
+    Size = sizeof(io);
+    if (!EFI_ERROR(BS->OpenProtocol(ControllerHandle, &gFswEfiStatsProtocolGuid, (VOID **) &Stats,
+                                    NULL, ControllerHandle, EFI_OPEN_PROTOCOL_GET_PROTOCOL)) &&
+        !EFI_ERROR(Stats->GetStatsEx(Stats, &Size, &io))) {
+        fprintf(stderr, "block cache:");
+        for (i = 0; i <= MAX_CACHE_LEVEL; i++)
+            fprintf(stderr, " L%d %llu/%llu", i,
+                    (unsigned long long) io.bcache_hits[i], (unsigned long long) io.bcache_misses[i]);
+        fprintf(stderr, " (hits/misses), %llu evictions, %llu borrowed\n", (unsigned long long) io.bcache_evictions,
+                (unsigned long long) io.bcache_borrowed);
+        fprintf(stderr, "read_block:  %llu calls, %llu bytes\n",
+                (unsigned long long) io.read_block_calls, (unsigned long long) io.read_block_bytes);
+        fprintf(stderr, "async read:  %llu calls\n", (unsigned long long) io.async_read_calls);
+        Size = sizeof(Trace);
+        if (!EFI_ERROR(Stats->GetCacheTraceEx(Stats, &Size, &Trace)))
+            fprintf(stderr, "disk cache:  %llu hits, %llu stream hits, %llu/%llu sequential/random misses, "
+                    "%llu fills (%llu bytes), %llu direct reads, window %llu, %llu lent\n",
+                    (unsigned long long) Trace.Hits, (unsigned long long) Trace.StreamHits,
+                    (unsigned long long) Trace.SequentialMisses, (unsigned long long) Trace.RandomMisses,
+                    (unsigned long long) Trace.Fills, (unsigned long long) Trace.FillBytes,
+                    (unsigned long long) Trace.DirectReads, (unsigned long long) Trace.Window,
+                    (unsigned long long) Trace.Lent);
+    }
+    if (!EFI_ERROR(fsw_efi_shim_get_disk_stats(ControllerHandle, &Disk)))
+        fprintf(stderr, "disk:        %llu reads (%llu bytes), %llu non-blocking reads (%llu bytes)\n",
+                (unsigned long long) Disk.ReadDiskCalls, (unsigned long long) Disk.ReadDiskBytes,
+                (unsigned long long) Disk.ReadDiskExCalls, (unsigned long long) Disk.ReadDiskExBytes);
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: efilslr [-r] [-c <chunk>] [-s] [-b <blocksize>] <file/device> [<path>]\n"
+                    "  -r  read all files and print a checksum\n"
+                    "  -c  size of each read call with -r (default 65536, at most 1 MiB)\n"
+                    "  -s  do not offer Disk I/O 2 to the driver\n"
+                    "  -b  block size of the emulated disk (default 512)\n");
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    EFI_STATUS              Status;
+    EFI_HANDLE              ImageHandle, ControllerHandle;
+    EFI_FILE_IO_INTERFACE   *FileSystem;
+    EFI_FILE                *Root, *Dir;
+    UINT64                  Buffer[(sizeof(EFI_FILE_SYSTEM_INFO) + 256 * sizeof(CHAR16)) / sizeof(UINT64) + 1];
+    EFI_FILE_SYSTEM_INFO    *FsInfo = (EFI_FILE_SYSTEM_INFO *) Buffer;
+    CHAR16                  Path[1024];
+    UINTN                   BufferSize, i;
+    UINT32                  BlockSize = 512;
+    BOOLEAN                 WithDiskIo2 = TRUE;
+    int                     opt;
+
+    for (opt = 1; opt < argc && argv[opt][0] == '-'; opt++) {
+        if (strcmp(argv[opt], "-r") == 0)
+            read_files = 1;
+        else if (strcmp(argv[opt], "-c") == 0 && opt + 1 < argc)
+            read_chunk = (UINTN) strtoul(argv[++opt], NULL, 0);
+        else if (strcmp(argv[opt], "-s") == 0)
+            WithDiskIo2 = FALSE;
+        else if (strcmp(argv[opt], "-b") == 0 && opt + 1 < argc)
+            BlockSize = (UINT32) strtoul(argv[++opt], NULL, 0);
+        else
+            usage();
+    }
+    if (argc - opt < 1 || argc - opt > 2 || read_chunk == 0 || read_chunk > 1024 * 1024)
+        usage();
+
+    // load the driver and give it the disk
+    ImageHandle = fsw_efi_shim_create_handle();
+    Status = fsw_efi_main(ImageHandle, &fsw_efi_shim_system_table);
+    if (EFI_ERROR(Status)) {
+        fprintf(stderr, "Driver entry point failed with status 0x%llx.\n", (unsigned long long) Status);
+        return 1;
+    }
+    Status = fsw_efi_shim_open_image(argv[opt], BlockSize, WithDiskIo2, &ControllerHandle);
+    if (EFI_ERROR(Status)) {
+        fprintf(stderr, "Opening %s failed.\n", argv[opt]);
+        return 1;
+    }
+    Status = fsw_efi_DriverBinding_table.Supported(&fsw_efi_DriverBinding_table, ControllerHandle, NULL);
+    if (!EFI_ERROR(Status))
+        Status = fsw_efi_DriverBinding_table.Start(&fsw_efi_DriverBinding_table, ControllerHandle, NULL);
+    if (EFI_ERROR(Status)) {
+        fprintf(stderr, "Mounting failed with status 0x%llx.\n", (unsigned long long) Status);
+        return 1;
+    }
+
+    // open the volume like a boot loader would
+    Status = BS->OpenProtocol(ControllerHandle, &FileSystemProtocol, (VOID **) &FileSystem,
+                              ImageHandle, ControllerHandle, EFI_OPEN_PROTOCOL_GET_PROTOCOL);
+    if (!EFI_ERROR(Status))
+        Status = FileSystem->OpenVolume(FileSystem, &Root);
+    if (EFI_ERROR(Status)) {
+        fprintf(stderr, "OpenVolume failed with status 0x%llx.\n", (unsigned long long) Status);
+        return 1;
+    }
+    BufferSize = sizeof(Buffer);
+    Status = Root->GetInfo(Root, &gMyEfiFileSystemInfoGuid, &BufferSize, FsInfo);
+    if (!EFI_ERROR(Status)) {
+        fprintf(stderr, "Mounted '");
+        for (i = 0; FsInfo->VolumeLabel[i]; i++)
+            fputc(FsInfo->VolumeLabel[i] < 0x80 ? FsInfo->VolumeLabel[i] : '?', stderr);
+        fprintf(stderr, "', %llu bytes, %u byte blocks.\n",
+                (unsigned long long) FsInfo->VolumeSize, (unsigned) FsInfo->BlockSize);
+    }
+
+    Dir = Root;
+    if (argc - opt == 2) {
+        for (i = 0; argv[opt + 1][i] && i < 1023; i++)
+            Path[i] = (argv[opt + 1][i] == '/') ? '\\' : (CHAR16) argv[opt + 1][i];
+        Path[i] = 0;
+        Status = Root->Open(Root, &Dir, Path, EFI_FILE_MODE_READ, 0);
+        if (EFI_ERROR(Status)) {
+            fprintf(stderr, "Opening %s failed with status 0x%llx.\n", argv[opt + 1], (unsigned long long) Status);
+            Dir = NULL;
+            errors++;
+        }
+    }
+    if (Dir != NULL)
+        listdir(Dir, 0);
+    if (Dir != NULL && Dir != Root)
+        Dir->Close(Dir);
+    Root->Close(Root);
+
+    print_stats(ControllerHandle);
+
+    // stop the driver; the shim refuses to close an image the driver still holds
+    Status = fsw_efi_DriverBinding_table.Stop(&fsw_efi_DriverBinding_table, ControllerHandle, 0, NULL);
+    if (!EFI_ERROR(Status))
+        Status = fsw_efi_shim_close_image(ControllerHandle);
+    if (EFI_ERROR(Status)) {
+        fprintf(stderr, "Stopping the driver failed with status 0x%llx.\n", (unsigned long long) Status);
+        errors++;
+    }
+
+    if (errors)
+        fprintf(stderr, "%d errors.\n", errors);
+    return errors ? 1 : 0;
+}
+
+// EOF
@@ -0,0 +1,581 @@
+/**
+ * \file fsw_bench.c
+ * Benchmark for the file system drivers. Mounts an image through the EFI host
+ * running on the Linux shim (see fsw_efi_shim.c), which builds with every
+ * driver, and reports time and I/O counts for mounting, reading directories,
+ * looking up paths and reading a file sequentially and at random offsets.
+ * Each "cold" phase starts from a fresh mount, the following "warm" phase
+ * repeats the same work on that mount.
+ */
+
+/*-
+ * Copyright (c) 2026 rEFInd contributors
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *  * Neither the name of the copyright holders nor the names of the
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "fsw_efi_shim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __MAKEWITH_GNUEFI
+#include "edk2/DriverBinding.h"
+#endif
+
+extern REFIND_EFI_DRIVER_BINDING_PROTOCOL fsw_efi_DriverBinding_table;
+extern EFI_GUID gFswEfiStatsProtocolGuid;
+
+EFI_STATUS EFIAPI fsw_efi_main(IN EFI_HANDLE ImageHandle, IN EFI_SYSTEM_TABLE *SystemTable);
+
+/** Size of each read in the random read phases. */
+#define BENCH_RANDOM_READ_SIZE (4096)
+/** Longest path collected from the volume, in characters. */
+#define BENCH_MAX_PATH (1024)
+
+/**
+ * One file or directory found while reading the volume.
+ */
+
+typedef struct {
+    CHAR16      *Path;              //!< Full path from the root, with backslashes
+    UINT64      Size;               //!< File size
+    BOOLEAN     IsDir;              //!< Entry is a directory
+} BENCH_ENTRY;
+
+/**
+ * Result of one benchmark phase.
+ */
+
+typedef struct {
+    const char  *Name;              //!< Phase name
+    UINT64      Ops;                //!< Operations done in the phase
+    UINT64      Bytes;              //!< Bytes read by those operations
+    UINT64      Usec;               //!< Best time over all repetitions
+    UINT64      Errors;             //!< Failed operations
+    struct fsw_io_stats Io;         //!< Driver counters during the phase
+    FSW_EFI_SHIM_DISK_STATS Disk;   //!< Requests that reached the image
+} BENCH_RESULT;
+
+enum {
+    PHASE_MOUNT, PHASE_READDIR_COLD, PHASE_READDIR_WARM, PHASE_LOOKUP_COLD, PHASE_LOOKUP_WARM,
+    PHASE_SEQREAD_COLD, PHASE_SEQREAD_WARM, PHASE_RANDREAD_COLD, PHASE_RANDREAD_WARM, PHASE_COUNT
+};
+
+static const char *phase_names[PHASE_COUNT] = {
+    "mount", "readdir-cold", "readdir-warm", "lookup-cold", "lookup-warm",
+    "seqread-cold", "seqread-warm", "randread-cold", "randread-warm"
+};
+
+static EFI_HANDLE   ImageHandle, ControllerHandle;
+static EFI_FILE     *Root;
+static FSW_EFI_STATS_PROTOCOL *Stats;
+static BOOLEAN      DropOsCache = FALSE;
+
+static BENCH_ENTRY  *entries = NULL;
+static UINTN        entry_count = 0, entry_alloc = 0;
+static BOOLEAN      collecting = TRUE;
+
+static BENCH_RESULT results[PHASE_COUNT];
+static int          repetition = 0;
+
+/** State of a phase in progress: time and counters at its start. */
+static struct {
+    struct timespec         Start;
+    struct fsw_io_stats     Io;
+    FSW_EFI_SHIM_DISK_STATS Disk;
+} current;
+
+static UINT64 lcg_state;
+
+static UINT64 lcg_next(VOID)
+{
+    lcg_state = lcg_state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return lcg_state >> 33;
+}
+
+static VOID get_counters(struct fsw_io_stats *Io, FSW_EFI_SHIM_DISK_STATS *Disk)
+{
+    UINTN   Size = sizeof(*Io);
+
+    memset(Io, 0, sizeof(*Io));
+    if (Stats != NULL)
+        Stats->GetStatsEx(Stats, &Size, Io);
+    fsw_efi_shim_get_disk_stats(ControllerHandle, Disk);
+}
+
+static VOID phase_begin(VOID)
+{
+    get_counters(&current.Io, &current.Disk);
+    clock_gettime(CLOCK_MONOTONIC, &current.Start);
+}
+
+/**
+ * Finish a phase. Counters are taken from the first repetition, times are the
+ * best of all repetitions. A phase that started before the mount it measures
+ * (Fresh) counts the new volume's driver counters from zero.
+ */
+
+static VOID phase_end(int phase, UINT64 Ops, UINT64 Bytes, UINT64 Errors, BOOLEAN Fresh)
+{
+    struct timespec         End;
+    struct fsw_io_stats     Io;
+    FSW_EFI_SHIM_DISK_STATS Disk;
+    BENCH_RESULT            *r = &results[phase];
+    UINT64                  Usec;
+    UINTN                   i;
+
+    clock_gettime(CLOCK_MONOTONIC, &End);
+    get_counters(&Io, &Disk);
+    Usec = (UINT64) (End.tv_sec - current.Start.tv_sec) * 1000000 +
+           (End.tv_nsec - current.Start.tv_nsec) / 1000;
+
+    r->Name = phase_names[phase];
+    if (repetition == 0 || Usec < r->Usec)
+        r->Usec = Usec;
+    if (repetition > 0)
+        return;
+    if (Fresh)
+        memset(&current.Io, 0, sizeof(current.Io));
+    r->Ops = Ops;
+    r->Bytes = Bytes;
+    r->Errors = Errors;
+    // struct fsw_io_stats consists of fsw_u64 counters only
+    for (i = 0; i < sizeof(Io) / sizeof(fsw_u64); i++)
+        ((fsw_u64 *) &r->Io)[i] = ((fsw_u64 *) &Io)[i] - ((fsw_u64 *) &current.Io)[i];
+    r->Disk.ReadDiskCalls   = Disk.ReadDiskCalls - current.Disk.ReadDiskCalls;
+    r->Disk.ReadDiskBytes   = Disk.ReadDiskBytes - current.Disk.ReadDiskBytes;
+    r->Disk.ReadDiskExCalls = Disk.ReadDiskExCalls - current.Disk.ReadDiskExCalls;
+    r->Disk.ReadDiskExBytes = Disk.ReadDiskExBytes - current.Disk.ReadDiskExBytes;
+}
+
+//
+// mounting
+//
+
+static EFI_STATUS bench_mount(VOID)
+{
+    EFI_STATUS              Status;
+    EFI_FILE_IO_INTERFACE   *FileSystem;
+
+    if (DropOsCache)
+        fsw_efi_shim_drop_os_cache(ControllerHandle);
+    Status = fsw_efi_DriverBinding_table.Supported(&fsw_efi_DriverBinding_table, ControllerHandle, NULL);
+    if (!EFI_ERROR(Status))
+        Status = fsw_efi_DriverBinding_table.Start(&fsw_efi_DriverBinding_table, ControllerHandle, NULL);
+    if (!EFI_ERROR(Status))
+        Status = BS->OpenProtocol(ControllerHandle, &FileSystemProtocol, (VOID **) &FileSystem,
+                                  ImageHandle, ControllerHandle, EFI_OPEN_PROTOCOL_GET_PROTOCOL);
+    if (!EFI_ERROR(Status))
+        Status = FileSystem->OpenVolume(FileSystem, &Root);
+    if (EFI_ERROR(Status))
+        return Status;
+    if (EFI_ERROR(BS->OpenProtocol(ControllerHandle, &gFswEfiStatsProtocolGuid, (VOID **) &Stats,
+                                   ImageHandle, ControllerHandle, EFI_OPEN_PROTOCOL_GET_PROTOCOL)))
+        Stats = NULL;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS bench_unmount(VOID)
+{
+    Root->Close(Root);
+    Root = NULL;
+    Stats = NULL;
+    return fsw_efi_DriverBinding_table.Stop(&fsw_efi_DriverBinding_table, ControllerHandle, 0, NULL);
+}
+
+static EFI_STATUS bench_remount(VOID)
+{
+    EFI_STATUS  Status;
+
+    Status = bench_unmount();
+    if (EFI_ERROR(Status))
+        return Status;
+    return bench_mount();
+}
+
+//
+// phases
+//
+
+static VOID add_entry(CHAR16 *Path, UINT64 Size, BOOLEAN IsDir)
+{
+    BENCH_ENTRY *NewEntries;
+    UINTN       Length = StrLen(Path);
+
+    if (entry_count == entry_alloc) {
+        entry_alloc = entry_alloc ? entry_alloc * 2 : 1024;
+        NewEntries = realloc(entries, entry_alloc * sizeof(BENCH_ENTRY));
+        if (NewEntries == NULL) {
+            fprintf(stderr, "Out of memory.\n");
+            exit(1);
+        }
+        entries = NewEntries;
+    }
+    entries[entry_count].Path = malloc((Length + 1) * sizeof(CHAR16));
+    if (entries[entry_count].Path == NULL) {
+        fprintf(stderr, "Out of memory.\n");
+        exit(1);
+    }
+    CopyMem(entries[entry_count].Path, Path, (Length + 1) * sizeof(CHAR16));
+    entries[entry_count].Size = Size;
+    entries[entry_count].IsDir = IsDir;
+    entry_count++;
+}
+
+/**
+ * Read a directory recursively. Path holds the directory's path and is used
+ * as scratch space for the children's paths. Returns the number of entries.
+ */
+
+static UINT64 walk(EFI_FILE *Dir, CHAR16 *Path, UINT64 *Errors)
+{
+    EFI_STATUS  Status;
+    EFI_FILE    *Child;
+    UINTN       BufferSize, Length = StrLen(Path), NameLength;
+    UINT64      Buffer[(sizeof(EFI_FILE_INFO) + 512 * sizeof(CHAR16)) / sizeof(UINT64) + 1];
+    EFI_FILE_INFO *FileInfo = (EFI_FILE_INFO *) Buffer;
+    UINT64      Count = 0;
+    BOOLEAN     IsDir;
+
+    for (;;) {
+        BufferSize = sizeof(Buffer);
+        Status = Dir->Read(Dir, &BufferSize, FileInfo);
+        if (EFI_ERROR(Status)) {
+            (*Errors)++;
+            break;
+        }
+        if (BufferSize == 0)
+            break;
+        Count++;
+
+        NameLength = StrLen(FileInfo->FileName);
+        if (Length + 1 + NameLength >= BENCH_MAX_PATH) {
+            (*Errors)++;
+            continue;
+        }
+        Path[Length] = '\\';
+        CopyMem(Path + Length + 1, FileInfo->FileName, (NameLength + 1) * sizeof(CHAR16));
+        IsDir = (FileInfo->Attribute & EFI_FILE_DIRECTORY) ? TRUE : FALSE;
+        if (collecting)
+            add_entry(Path, FileInfo->FileSize, IsDir);
+        if (IsDir) {
+            Status = Dir->Open(Dir, &Child, FileInfo->FileName, EFI_FILE_MODE_READ, 0);
+            if (EFI_ERROR(Status)) {
+                (*Errors)++;
+            } else {
+                Count += walk(Child, Path, Errors);
+                Child->Close(Child);
+            }
+        }
+        Path[Length] = 0;
+    }
+    return Count;
+}
+
+static VOID bench_readdir(int phase)
+{
+    CHAR16      Path[BENCH_MAX_PATH];
+    UINT64      Count, Errors = 0;
+
+    Path[0] = 0;
+    phase_begin();
+    Root->SetPosition(Root, 0);
+    Count = walk(Root, Path, &Errors);
+    phase_end(phase, Count, 0, Errors, FALSE);
+    collecting = FALSE;
+}
+
+static VOID bench_lookup(int phase, UINTN *Selected, UINTN SelectedCount)
+{
+    EFI_FILE    *File;
+    UINTN       i;
+    UINT64      Errors = 0;
+
+    phase_begin();
+    for (i = 0; i < SelectedCount; i++) {
+        if (EFI_ERROR(Root->Open(Root, &File, entries[Selected[i]].Path, EFI_FILE_MODE_READ, 0)))
+            Errors++;
+        else
+            File->Close(File);
+    }
+    phase_end(phase, SelectedCount, 0, Errors, FALSE);
+}
+
+static VOID bench_seqread(int phase, BENCH_ENTRY *Entry, UINT8 *Buffer, UINTN Chunk)
+{
+    EFI_FILE    *File;
+    UINTN       BufferSize;
+    UINT64      Ops = 0, Bytes = 0, Errors = 0;
+
+    phase_begin();
+    if (EFI_ERROR(Root->Open(Root, &File, Entry->Path, EFI_FILE_MODE_READ, 0))) {
+        Errors++;
+    } else {
+        for (;;) {
+            BufferSize = Chunk;
+            if (EFI_ERROR(File->Read(File, &BufferSize, Buffer))) {
+                Errors++;
+                break;
+            }
+            if (BufferSize == 0)
+                break;
+            Ops++;
+            Bytes += BufferSize;
+        }
+        File->Close(File);
+    }
+    if (Bytes != Entry->Size)
+        Errors++;
+    phase_end(phase, Ops, Bytes, Errors, FALSE);
+}
+
+static VOID bench_randread(int phase, BENCH_ENTRY *Entry, UINT8 *Buffer, UINTN Count, UINT64 Seed)
+{
+    EFI_FILE    *File;
+    UINTN       BufferSize, i;
+    UINT64      Blocks, Bytes = 0, Errors = 0;
+
+    Blocks = (Entry->Size + BENCH_RANDOM_READ_SIZE - 1) / BENCH_RANDOM_READ_SIZE;
+    if (Blocks == 0)
+        Blocks = 1;
+    lcg_state = Seed;
+    phase_begin();
+    if (EFI_ERROR(Root->Open(Root, &File, Entry->Path, EFI_FILE_MODE_READ, 0))) {
+        Errors++;
+    } else {
+        for (i = 0; i < Count; i++) {
+            BufferSize = BENCH_RANDOM_READ_SIZE;
+            if (EFI_ERROR(File->SetPosition(File, (lcg_next() % Blocks) * BENCH_RANDOM_READ_SIZE)) ||
+                EFI_ERROR(File->Read(File, &BufferSize, Buffer)))
+                Errors++;
+            else
+                Bytes += BufferSize;
+        }
+        File->Close(File);
+    }
+    phase_end(phase, Count, Bytes, Errors, FALSE);
+}
+
+//
+// main
+//
+
+static VOID print_path(FILE *f, CHAR16 *Path)
+{
+    for (; *Path; Path++)
+        fputc(*Path < 0x80 ? (int) *Path : '?', f);
+}
+
+static VOID print_results(VOID)
+{
+    int         phase, i;
+    UINT64      hits, misses;
+    BENCH_RESULT *r;
+
+    printf("%-14s %8s %11s %10s %9s %11s %10s %11s %9s %9s %9s %6s\n",
+           "phase", "ops", "bytes", "time_us", "fs_reads", "fs_bytes", "disk_reads", "disk_bytes",
+           "bc_hits", "bc_misses", "borrowed", "errors");
+    for (phase = 0; phase < PHASE_COUNT; phase++) {
+        r = &results[phase];
+        if (r->Name == NULL)
+            continue;
+        hits = misses = 0;
+        for (i = 0; i <= MAX_CACHE_LEVEL; i++) {
+            hits += r->Io.bcache_hits[i];
+            misses += r->Io.bcache_misses[i];
+        }
+        printf("%-14s %8llu %11llu %10llu %9llu %11llu %10llu %11llu %9llu %9llu %9llu %6llu\n",
+               r->Name, (unsigned long long) r->Ops, (unsigned long long) r->Bytes,
+               (unsigned long long) r->Usec,
+               (unsigned long long) r->Io.read_block_calls, (unsigned long long) r->Io.read_block_bytes,
+               (unsigned long long) (r->Disk.ReadDiskCalls + r->Disk.ReadDiskExCalls),
+               (unsigned long long) (r->Disk.ReadDiskBytes + r->Disk.ReadDiskExBytes),
+               (unsigned long long) hits, (unsigned long long) misses,
+               (unsigned long long) r->Io.bcache_borrowed, (unsigned long long) r->Errors);
+    }
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: fsw_bench [options] <file/device>\n"
+                    "  -r <n>     repeat all phases n times, report the best times (default 1)\n"
+                    "  -n <n>     number of path lookups and random reads (default 1000)\n"
+                    "  -c <size>  size of each sequential read (default 65536)\n"
+                    "  -f <path>  file for the read phases (default: largest file)\n"
+                    "  -S <seed>  seed for choosing lookup paths and read offsets (default 1)\n"
+                    "  -D         drop the operating system's cache of the image before each mount\n"
+                    "  -s         do not offer Disk I/O 2 to the driver\n"
+                    "  -b <size>  block size of the emulated disk (default 512)\n");
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    EFI_STATUS  Status;
+    UINTN       Repeat = 1, Count = 1000, Chunk = 65536, i, FileCount = 0;
+    UINT64      Seed = 1;
+    UINT32      BlockSize = 512;
+    BOOLEAN     WithDiskIo2 = TRUE;
+    const char  *FilePath = NULL;
+    CHAR16      Path[BENCH_MAX_PATH];
+    UINTN       *Selected = NULL;
+    BENCH_ENTRY *ReadEntry = NULL;
+    UINT8       *Buffer;
+    int         opt;
+
+    for (opt = 1; opt < argc && argv[opt][0] == '-'; opt++) {
+        if (strcmp(argv[opt], "-D") == 0)
+            DropOsCache = TRUE;
+        else if (strcmp(argv[opt], "-s") == 0)
+            WithDiskIo2 = FALSE;
+        else if (opt + 1 >= argc)
+            usage();
+        else if (strcmp(argv[opt], "-r") == 0)
+            Repeat = (UINTN) strtoul(argv[++opt], NULL, 0);
+        else if (strcmp(argv[opt], "-n") == 0)
+            Count = (UINTN) strtoul(argv[++opt], NULL, 0);
+        else if (strcmp(argv[opt], "-c") == 0)
+            Chunk = (UINTN) strtoul(argv[++opt], NULL, 0);
+        else if (strcmp(argv[opt], "-f") == 0)
+            FilePath = argv[++opt];
+        else if (strcmp(argv[opt], "-S") == 0)
+            Seed = strtoull(argv[++opt], NULL, 0);
+        else if (strcmp(argv[opt], "-b") == 0)
+            BlockSize = (UINT32) strtoul(argv[++opt], NULL, 0);
+        else
+            usage();
+    }
+    if (argc - opt != 1 || Repeat == 0 || Chunk == 0)
+        usage();
+    Buffer = malloc(Chunk > BENCH_RANDOM_READ_SIZE ? Chunk : BENCH_RANDOM_READ_SIZE);
+    if (Buffer == NULL) {
+        fprintf(stderr, "Out of memory.\n");
+        return 1;
+    }
+
+    ImageHandle = fsw_efi_shim_create_handle();
+    Status = fsw_efi_main(ImageHandle, &fsw_efi_shim_system_table);
+    if (!EFI_ERROR(Status))
+        Status = fsw_efi_shim_open_image(argv[opt], BlockSize, WithDiskIo2, &ControllerHandle);
+    if (EFI_ERROR(Status)) {
+        fprintf(stderr, "Opening %s failed.\n", argv[opt]);
+        return 1;
+    }
+
+    for (repetition = 0; (UINTN) repetition < (UINTN) Repeat; repetition++) {
+        phase_begin();
+        Status = bench_mount();
+        if (EFI_ERROR(Status)) {
+            fprintf(stderr, "Mounting failed with status 0x%llx.\n", (unsigned long long) Status);
+            return 1;
+        }
+        phase_end(PHASE_MOUNT, 1, 0, 0, TRUE);
+
+        bench_readdir(PHASE_READDIR_COLD);
+        bench_readdir(PHASE_READDIR_WARM);
+
+        if (repetition == 0) {
+            // choose the lookup paths and the file to read
+            Selected = malloc((Count + 1) * sizeof(UINTN));
+            if (Selected == NULL) {
+                fprintf(stderr, "Out of memory.\n");
+                return 1;
+            }
+            for (i = 0; i < entry_count; i++) {
+                if (entries[i].IsDir)
+                    continue;
+                FileCount++;
+                if (FilePath == NULL && (ReadEntry == NULL || entries[i].Size > ReadEntry->Size))
+                    ReadEntry = &entries[i];
+            }
+            lcg_state = Seed;
+            for (i = 0; i < Count && entry_count > 0; i++)
+                Selected[i] = lcg_next() % entry_count;
+            if (entry_count == 0)
+                Count = 0;
+            if (FilePath != NULL) {
+                for (i = 0; FilePath[i] && i < BENCH_MAX_PATH - 1; i++)
+                    Path[i] = (FilePath[i] == '/') ? '\\' : (CHAR16) FilePath[i];
+                Path[i] = 0;
+                for (i = 0; i < entry_count; i++)
+                    if (!entries[i].IsDir && StrCmp(entries[i].Path, Path) == 0)
+                        ReadEntry = &entries[i];
+                if (ReadEntry == NULL) {
+                    fprintf(stderr, "File %s not found.\n", FilePath);
+                    return 1;
+                }
+            }
+
+            printf("image: %s, %llu entries (%llu files)", argv[opt],
+                   (unsigned long long) entry_count, (unsigned long long) FileCount);
+            if (ReadEntry != NULL) {
+                printf(", reading ");
+                print_path(stdout, ReadEntry->Path);
+                printf(" (%llu bytes)", (unsigned long long) ReadEntry->Size);
+            }
+            printf("\n");
+        }
+
+        if (EFI_ERROR(bench_remount()))
+            return 1;
+        bench_lookup(PHASE_LOOKUP_COLD, Selected, Count);
+        bench_lookup(PHASE_LOOKUP_WARM, Selected, Count);
+
+        if (ReadEntry != NULL) {
+            if (EFI_ERROR(bench_remount()))
+                return 1;
+            bench_seqread(PHASE_SEQREAD_COLD, ReadEntry, Buffer, Chunk);
+            bench_seqread(PHASE_SEQREAD_WARM, ReadEntry, Buffer, Chunk);
+
+            if (EFI_ERROR(bench_remount()))
+                return 1;
+            bench_randread(PHASE_RANDREAD_COLD, ReadEntry, Buffer, Count, Seed);
+            bench_randread(PHASE_RANDREAD_WARM, ReadEntry, Buffer, Count, Seed);
+        }
+
+        if (EFI_ERROR(bench_unmount())) {
+            fprintf(stderr, "Stopping the driver failed.\n");
+            return 1;
+        }
+    }
+
+    print_results();
+    fsw_efi_shim_close_image(ControllerHandle);
+    for (i = 0; i < entry_count; i++)
+        free(entries[i].Path);
+    free(entries);
+    free(Selected);
+    free(Buffer);
+    return 0;
+}
+
+// EOF
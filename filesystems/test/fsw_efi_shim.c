@@ -0,0 +1,912 @@
+/**
+ * \file fsw_efi_shim.c
+ * Linux stand-ins for the UEFI boot services and disk protocols. Together
+ * with the headers in efi/, this lets fsw_efi.c be compiled unmodified with
+ * -D__MAKEWITH_GNUEFI and driven through its Driver Binding and Simple File
+ * System protocols from a user space program, against a disk image file.
+ *
+ * Handles are kept in a simple list with a fixed number of protocol slots
+ * each. Disk I/O and Block I/O read from the image with pread(), Disk I/O 2
+ * queues POSIX aio requests whose completion is picked up by CheckEvent().
+ * Events are only signaled by those requests; notification functions and
+ * timers are not supported.
+ */
+
+/*-
+ * Copyright (c) 2026 rEFInd contributors
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *  * Neither the name of the copyright holders nor the names of the
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "fsw_efi_shim.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <aio.h>
+#include <sys/stat.h>
+
+// the shim implements the library function that fsw_efi.h wraps
+#undef CompareGuid
+
+/** Maximum number of protocols installed on one handle. */
+#define SHIM_MAX_PROTOCOLS (8)
+
+/**
+ * EFI Shim: One protocol installed on a handle.
+ */
+
+typedef struct {
+    EFI_GUID    Guid;               //!< Protocol GUID
+    VOID        *Interface;         //!< Protocol interface
+    UINTN       DriverOpens;        //!< Number of outstanding BY_DRIVER opens
+} SHIM_PROTOCOL;
+
+/**
+ * EFI Shim: A handle in the handle database.
+ */
+
+typedef struct _SHIM_HANDLE {
+    struct _SHIM_HANDLE *Next;      //!< Next handle in the database
+    UINTN       Count;              //!< Number of installed protocols
+    SHIM_PROTOCOL Protocols[SHIM_MAX_PROTOCOLS];    //!< Installed protocols
+} SHIM_HANDLE;
+
+/**
+ * EFI Shim: An event. It is signaled when the Disk I/O 2 request attached to
+ * it completes.
+ */
+
+typedef struct {
+    BOOLEAN     Signaled;           //!< Event is in the signaled state
+    struct aiocb *Request;          //!< Pending Disk I/O 2 request, if any
+    REFIND_EFI_DISK_IO2_TOKEN *Token;   //!< Token of the pending request
+    UINTN       Length;             //!< Length of the pending request
+} SHIM_EVENT;
+
+/**
+ * EFI Shim: A disk backed by an image file, exporting Block I/O, Disk I/O and
+ * optionally Disk I/O 2 on its handle.
+ */
+
+typedef struct {
+    EFI_DISK_IO             DiskIo;     //!< Disk I/O protocol instance
+    EFI_BLOCK_IO            BlockIo;    //!< Block I/O protocol instance
+    EFI_BLOCK_IO_MEDIA      Media;      //!< Media description for Block I/O
+    REFIND_EFI_DISK_IO2_PROTOCOL DiskIo2;   //!< Disk I/O 2 protocol instance
+    BOOLEAN                 WithDiskIo2;    //!< Disk I/O 2 is installed
+    EFI_HANDLE              Handle;     //!< Handle the protocols are installed on
+    int                     fd;         //!< File descriptor of the image
+    UINT64                  Size;       //!< Size of the image in bytes
+    FSW_EFI_SHIM_DISK_STATS Stats;      //!< Request counters
+} SHIM_DISK;
+
+#define SHIM_DISK_FROM_DISK_IO(a)   CR(a, SHIM_DISK, DiskIo, 0)
+#define SHIM_DISK_FROM_BLOCK_IO(a)  CR(a, SHIM_DISK, BlockIo, 0)
+#define SHIM_DISK_FROM_DISK_IO2(a)  CR(a, SHIM_DISK, DiskIo2, 0)
+
+EFI_GUID FileSystemProtocol = SIMPLE_FILE_SYSTEM_PROTOCOL;
+EFI_GUID BlockIoProtocol = BLOCK_IO_PROTOCOL;
+EFI_GUID DiskIoProtocol = DISK_IO_PROTOCOL;
+static EFI_GUID ShimDiskIo2ProtocolGuid = REFIND_EFI_DISK_IO2_PROTOCOL_GUID;
+
+EFI_SYSTEM_TABLE    *ST;
+EFI_BOOT_SERVICES   *BS;
+
+static SHIM_HANDLE  *HandleList = NULL;
+
+//
+// handle database
+//
+
+static SHIM_HANDLE *shim_find_handle(EFI_HANDLE Handle)
+{
+    SHIM_HANDLE *h;
+
+    for (h = HandleList; h != NULL; h = h->Next)
+        if (h == Handle)
+            return h;
+    return NULL;
+}
+
+static SHIM_PROTOCOL *shim_find_protocol(SHIM_HANDLE *h, EFI_GUID *Protocol)
+{
+    UINTN       i;
+
+    if (h == NULL || Protocol == NULL)
+        return NULL;
+    for (i = 0; i < h->Count; i++)
+        if (memcmp(&h->Protocols[i].Guid, Protocol, sizeof(EFI_GUID)) == 0)
+            return &h->Protocols[i];
+    return NULL;
+}
+
+/**
+ * Create an empty handle in the handle database.
+ */
+
+EFI_HANDLE fsw_efi_shim_create_handle(VOID)
+{
+    SHIM_HANDLE *h;
+
+    h = calloc(1, sizeof(SHIM_HANDLE));
+    if (h == NULL)
+        return NULL;
+    h->Next = HandleList;
+    HandleList = h;
+    return h;
+}
+
+/**
+ * Remove a handle from the handle database. Fails with EFI_ACCESS_DENIED if
+ * protocols are still installed on it, which points to a missing uninstall in
+ * the driver under test.
+ */
+
+EFI_STATUS fsw_efi_shim_destroy_handle(IN EFI_HANDLE Handle)
+{
+    SHIM_HANDLE **link;
+    SHIM_HANDLE *h = shim_find_handle(Handle);
+
+    if (h == NULL)
+        return EFI_INVALID_PARAMETER;
+    if (h->Count > 0)
+        return EFI_ACCESS_DENIED;
+    for (link = &HandleList; *link != h; link = &(*link)->Next)
+        ;
+    *link = h->Next;
+    free(h);
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS shim_install(SHIM_HANDLE *h, EFI_GUID *Protocol, VOID *Interface)
+{
+    if (shim_find_protocol(h, Protocol) != NULL)
+        return EFI_INVALID_PARAMETER;
+    if (h->Count >= SHIM_MAX_PROTOCOLS)
+        return EFI_OUT_OF_RESOURCES;
+    h->Protocols[h->Count].Guid = *Protocol;
+    h->Protocols[h->Count].Interface = Interface;
+    h->Protocols[h->Count].DriverOpens = 0;
+    h->Count++;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS shim_uninstall(SHIM_HANDLE *h, EFI_GUID *Protocol, VOID *Interface)
+{
+    SHIM_PROTOCOL *p = shim_find_protocol(h, Protocol);
+
+    if (p == NULL || p->Interface != Interface)
+        return EFI_NOT_FOUND;
+    if (p->DriverOpens > 0)
+        return EFI_ACCESS_DENIED;
+    *p = h->Protocols[--h->Count];
+    return EFI_SUCCESS;
+}
+
+//
+// boot services
+//
+
+static EFI_STATUS EFIAPI shim_InstallProtocolInterface(IN OUT EFI_HANDLE *Handle, IN EFI_GUID *Protocol,
+                                                       IN EFI_INTERFACE_TYPE InterfaceType, IN VOID *Interface)
+{
+    SHIM_HANDLE *h;
+    EFI_STATUS  Status;
+
+    if (Handle == NULL || Protocol == NULL || InterfaceType != EFI_NATIVE_INTERFACE)
+        return EFI_INVALID_PARAMETER;
+    if (*Handle == NULL) {
+        h = fsw_efi_shim_create_handle();
+        if (h == NULL)
+            return EFI_OUT_OF_RESOURCES;
+    } else {
+        h = shim_find_handle(*Handle);
+        if (h == NULL)
+            return EFI_INVALID_PARAMETER;
+    }
+    Status = shim_install(h, Protocol, Interface);
+    if (!EFI_ERROR(Status))
+        *Handle = h;
+    else if (*Handle == NULL)
+        fsw_efi_shim_destroy_handle(h);
+    return Status;
+}
+
+static EFI_STATUS EFIAPI shim_InstallMultipleProtocolInterfaces(IN OUT EFI_HANDLE *Handle, ...)
+{
+    va_list     args;
+    EFI_GUID    *Protocol;
+    VOID        *Interface;
+    EFI_HANDLE  NewHandle;
+    EFI_STATUS  Status = EFI_SUCCESS;
+
+    if (Handle == NULL)
+        return EFI_INVALID_PARAMETER;
+    NewHandle = *Handle;
+    va_start(args, Handle);
+    while ((Protocol = va_arg(args, EFI_GUID *)) != NULL) {
+        Interface = va_arg(args, VOID *);
+        Status = shim_InstallProtocolInterface(&NewHandle, Protocol, EFI_NATIVE_INTERFACE, Interface);
+        if (EFI_ERROR(Status))
+            break;
+    }
+    va_end(args);
+    // partial installs are not rolled back; the driver never relies on that
+    if (!EFI_ERROR(Status))
+        *Handle = NewHandle;
+    return Status;
+}
+
+static EFI_STATUS EFIAPI shim_UninstallMultipleProtocolInterfaces(IN EFI_HANDLE Handle, ...)
+{
+    va_list     args;
+    EFI_GUID    *Protocol;
+    VOID        *Interface;
+    SHIM_HANDLE *h = shim_find_handle(Handle);
+    EFI_STATUS  Status = EFI_SUCCESS;
+
+    if (h == NULL)
+        return EFI_INVALID_PARAMETER;
+    va_start(args, Handle);
+    while ((Protocol = va_arg(args, EFI_GUID *)) != NULL) {
+        Interface = va_arg(args, VOID *);
+        Status = shim_uninstall(h, Protocol, Interface);
+        if (EFI_ERROR(Status))
+            break;
+    }
+    va_end(args);
+    return Status;
+}
+
+static EFI_STATUS EFIAPI shim_HandleProtocol(IN EFI_HANDLE Handle, IN EFI_GUID *Protocol, OUT VOID **Interface)
+{
+    SHIM_PROTOCOL *p;
+
+    if (Interface == NULL)
+        return EFI_INVALID_PARAMETER;
+    p = shim_find_protocol(shim_find_handle(Handle), Protocol);
+    if (p == NULL)
+        return EFI_UNSUPPORTED;
+    *Interface = p->Interface;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI shim_LocateHandleBuffer(IN EFI_LOCATE_SEARCH_TYPE SearchType, IN EFI_GUID *Protocol OPTIONAL,
+                                                 IN VOID *SearchKey OPTIONAL, OUT UINTN *NoHandles,
+                                                 OUT EFI_HANDLE **Buffer)
+{
+    SHIM_HANDLE *h;
+    UINTN       Count = 0;
+
+    if (NoHandles == NULL || Buffer == NULL || (SearchType == ByProtocol && Protocol == NULL))
+        return EFI_INVALID_PARAMETER;
+    if (SearchType == ByRegisterNotify)
+        return EFI_UNSUPPORTED;
+    for (h = HandleList; h != NULL; h = h->Next)
+        Count++;
+    *Buffer = AllocatePool(Count * sizeof(EFI_HANDLE));
+    if (*Buffer == NULL)
+        return EFI_OUT_OF_RESOURCES;
+    *NoHandles = 0;
+    for (h = HandleList; h != NULL; h = h->Next)
+        if (SearchType == AllHandles || shim_find_protocol(h, Protocol) != NULL)
+            (*Buffer)[(*NoHandles)++] = h;
+    if (*NoHandles == 0) {
+        FreePool(*Buffer);
+        *Buffer = NULL;
+        return EFI_NOT_FOUND;
+    }
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI shim_OpenProtocol(IN EFI_HANDLE Handle, IN EFI_GUID *Protocol, OUT VOID **Interface,
+                                           IN EFI_HANDLE AgentHandle, IN EFI_HANDLE ControllerHandle,
+                                           IN UINT32 Attributes)
+{
+    SHIM_PROTOCOL *p;
+
+    if (Interface == NULL && Attributes != EFI_OPEN_PROTOCOL_TEST_PROTOCOL)
+        return EFI_INVALID_PARAMETER;
+    p = shim_find_protocol(shim_find_handle(Handle), Protocol);
+    if (p == NULL)
+        return EFI_UNSUPPORTED;
+    if (Attributes & (EFI_OPEN_PROTOCOL_BY_DRIVER | EFI_OPEN_PROTOCOL_EXCLUSIVE)) {
+        if (p->DriverOpens > 0)
+            return EFI_ACCESS_DENIED;
+        p->DriverOpens++;
+    }
+    if (Interface != NULL)
+        *Interface = p->Interface;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI shim_CloseProtocol(IN EFI_HANDLE Handle, IN EFI_GUID *Protocol,
+                                            IN EFI_HANDLE AgentHandle, IN EFI_HANDLE ControllerHandle)
+{
+    SHIM_PROTOCOL *p;
+
+    p = shim_find_protocol(shim_find_handle(Handle), Protocol);
+    if (p == NULL || p->DriverOpens == 0)
+        return EFI_NOT_FOUND;
+    p->DriverOpens--;
+    return EFI_SUCCESS;
+}
+
+/**
+ * Collect a finished Disk I/O 2 request attached to an event, or wait for it
+ * if Wait is set. Returns TRUE once no request is pending anymore.
+ */
+
+static BOOLEAN shim_event_complete(SHIM_EVENT *Event, BOOLEAN Wait)
+{
+    const struct aiocb *list[1];
+    ssize_t     done;
+    int         err;
+
+    if (Event->Request == NULL)
+        return TRUE;
+    err = aio_error(Event->Request);
+    while (err == EINPROGRESS && Wait) {
+        list[0] = Event->Request;
+        aio_suspend(list, 1, NULL);
+        err = aio_error(Event->Request);
+    }
+    if (err == EINPROGRESS)
+        return FALSE;
+
+    done = aio_return(Event->Request);
+    Event->Token->TransactionStatus = (err == 0 && done == (ssize_t) Event->Length) ? EFI_SUCCESS : EFI_DEVICE_ERROR;
+    free(Event->Request);
+    Event->Request = NULL;
+    Event->Token = NULL;
+    Event->Signaled = TRUE;
+    return TRUE;
+}
+
+static EFI_STATUS EFIAPI shim_CreateEvent(IN UINT32 Type, IN EFI_TPL NotifyTpl, IN EFI_EVENT_NOTIFY NotifyFunction,
+                                          IN VOID *NotifyContext, OUT EFI_EVENT *Event)
+{
+    SHIM_EVENT  *e;
+
+    if (Event == NULL)
+        return EFI_INVALID_PARAMETER;
+    if (Type != 0 || NotifyFunction != NULL)
+        return EFI_UNSUPPORTED;
+    e = calloc(1, sizeof(SHIM_EVENT));
+    if (e == NULL)
+        return EFI_OUT_OF_RESOURCES;
+    *Event = e;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI shim_CheckEvent(IN EFI_EVENT Event)
+{
+    SHIM_EVENT  *e = (SHIM_EVENT *) Event;
+
+    if (e == NULL)
+        return EFI_INVALID_PARAMETER;
+    shim_event_complete(e, FALSE);
+    if (!e->Signaled)
+        return EFI_NOT_READY;
+    e->Signaled = FALSE;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI shim_CloseEvent(IN EFI_EVENT Event)
+{
+    SHIM_EVENT  *e = (SHIM_EVENT *) Event;
+
+    if (e == NULL)
+        return EFI_INVALID_PARAMETER;
+    // the request's buffer may go away with the event, so let it finish first
+    shim_event_complete(e, TRUE);
+    free(e);
+    return EFI_SUCCESS;
+}
+
+static EFI_BOOT_SERVICES shim_boot_services = {
+    shim_InstallProtocolInterface,
+    shim_HandleProtocol,
+    shim_LocateHandleBuffer,
+    shim_OpenProtocol,
+    shim_CloseProtocol,
+    shim_InstallMultipleProtocolInterfaces,
+    shim_UninstallMultipleProtocolInterfaces,
+    shim_CreateEvent,
+    shim_CheckEvent,
+    shim_CloseEvent,
+};
+
+/** System table to pass to the driver's entry point. */
+EFI_SYSTEM_TABLE fsw_efi_shim_system_table = {
+    L"fsw EFI shim",
+    0x00010000,
+    &shim_boot_services,
+};
+
+//
+// image-backed disk
+//
+
+static EFI_STATUS shim_check_request(SHIM_DISK *Disk, UINT32 MediaId, UINT64 Offset, UINTN BufferSize, VOID *Buffer)
+{
+    if (MediaId != Disk->Media.MediaId)
+        return EFI_MEDIA_CHANGED;
+    if (Buffer == NULL && BufferSize > 0)
+        return EFI_INVALID_PARAMETER;
+    if (Offset > Disk->Size || BufferSize > Disk->Size - Offset)
+        return EFI_INVALID_PARAMETER;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS shim_pread(SHIM_DISK *Disk, UINT64 Offset, UINTN BufferSize, VOID *Buffer)
+{
+    ssize_t     done;
+    UINT8       *p = Buffer;
+
+    while (BufferSize > 0) {
+        done = pread(Disk->fd, p, BufferSize, (off_t) Offset);
+        if (done < 0 && errno == EINTR)
+            continue;
+        if (done <= 0)
+            return EFI_DEVICE_ERROR;
+        p += done;
+        Offset += done;
+        BufferSize -= done;
+    }
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI shim_ReadDisk(IN EFI_DISK_IO *This, IN UINT32 MediaId, IN UINT64 Offset,
+                                       IN UINTN BufferSize, OUT VOID *Buffer)
+{
+    SHIM_DISK   *Disk = SHIM_DISK_FROM_DISK_IO(This);
+    EFI_STATUS  Status;
+
+    Status = shim_check_request(Disk, MediaId, Offset, BufferSize, Buffer);
+    if (EFI_ERROR(Status))
+        return Status;
+    Disk->Stats.ReadDiskCalls++;
+    Disk->Stats.ReadDiskBytes += BufferSize;
+    return shim_pread(Disk, Offset, BufferSize, Buffer);
+}
+
+static EFI_STATUS EFIAPI shim_WriteDisk(IN EFI_DISK_IO *This, IN UINT32 MediaId, IN UINT64 Offset,
+                                        IN UINTN BufferSize, IN VOID *Buffer)
+{
+    return EFI_WRITE_PROTECTED;
+}
+
+static EFI_STATUS EFIAPI shim_Reset(IN EFI_BLOCK_IO *This, IN BOOLEAN ExtendedVerification)
+{
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI shim_ReadBlocks(IN EFI_BLOCK_IO *This, IN UINT32 MediaId, IN EFI_LBA LBA,
+                                         IN UINTN BufferSize, OUT VOID *Buffer)
+{
+    SHIM_DISK   *Disk = SHIM_DISK_FROM_BLOCK_IO(This);
+
+    if (BufferSize % Disk->Media.BlockSize)
+        return EFI_BAD_BUFFER_SIZE;
+    return shim_ReadDisk(&Disk->DiskIo, MediaId, LBA * Disk->Media.BlockSize, BufferSize, Buffer);
+}
+
+static EFI_STATUS EFIAPI shim_WriteBlocks(IN EFI_BLOCK_IO *This, IN UINT32 MediaId, IN EFI_LBA LBA,
+                                          IN UINTN BufferSize, IN VOID *Buffer)
+{
+    return EFI_WRITE_PROTECTED;
+}
+
+static EFI_STATUS EFIAPI shim_FlushBlocks(IN EFI_BLOCK_IO *This)
+{
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI shim_Cancel(IN REFIND_EFI_DISK_IO2_PROTOCOL *This)
+{
+    return EFI_UNSUPPORTED;
+}
+
+static EFI_STATUS EFIAPI shim_ReadDiskEx(IN REFIND_EFI_DISK_IO2_PROTOCOL *This, IN UINT32 MediaId,
+                                         IN UINT64 Offset, IN OUT REFIND_EFI_DISK_IO2_TOKEN *Token,
+                                         IN UINTN BufferSize, OUT VOID *Buffer)
+{
+    SHIM_DISK   *Disk = SHIM_DISK_FROM_DISK_IO2(This);
+    SHIM_EVENT  *Event;
+    struct aiocb *Request;
+    EFI_STATUS  Status;
+
+    Status = shim_check_request(Disk, MediaId, Offset, BufferSize, Buffer);
+    if (EFI_ERROR(Status))
+        return Status;
+
+    // without a token (or its event), the request is blocking
+    if (Token == NULL || Token->Event == NULL) {
+        Disk->Stats.ReadDiskCalls++;
+        Disk->Stats.ReadDiskBytes += BufferSize;
+        return shim_pread(Disk, Offset, BufferSize, Buffer);
+    }
+
+    Event = (SHIM_EVENT *) Token->Event;
+    if (Event->Request != NULL)
+        return EFI_INVALID_PARAMETER;
+    Request = calloc(1, sizeof(struct aiocb));
+    if (Request == NULL)
+        return EFI_OUT_OF_RESOURCES;
+    Request->aio_fildes = Disk->fd;
+    Request->aio_offset = (off_t) Offset;
+    Request->aio_buf    = Buffer;
+    Request->aio_nbytes = BufferSize;
+    if (aio_read(Request) != 0) {
+        free(Request);
+        return EFI_DEVICE_ERROR;
+    }
+    Disk->Stats.ReadDiskExCalls++;
+    Disk->Stats.ReadDiskExBytes += BufferSize;
+    Event->Signaled = FALSE;
+    Event->Request  = Request;
+    Event->Token    = Token;
+    Event->Length   = BufferSize;
+    return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI shim_WriteDiskEx(IN REFIND_EFI_DISK_IO2_PROTOCOL *This, IN UINT32 MediaId,
+                                          IN UINT64 Offset, IN OUT REFIND_EFI_DISK_IO2_TOKEN *Token,
+                                          IN UINTN BufferSize, IN VOID *Buffer)
+{
+    return EFI_WRITE_PROTECTED;
+}
+
+static EFI_STATUS EFIAPI shim_FlushDiskEx(IN REFIND_EFI_DISK_IO2_PROTOCOL *This,
+                                          IN OUT REFIND_EFI_DISK_IO2_TOKEN *Token)
+{
+    if (Token != NULL && Token->Event != NULL) {
+        Token->TransactionStatus = EFI_SUCCESS;
+        ((SHIM_EVENT *) Token->Event)->Signaled = TRUE;
+    }
+    return EFI_SUCCESS;
+}
+
+/**
+ * Open a disk image and create a controller handle for it, carrying the Block
+ * I/O and Disk I/O protocols and, if requested, Disk I/O 2. The image size is
+ * rounded down to whole blocks of the given size.
+ */
+
+EFI_STATUS fsw_efi_shim_open_image(IN const char *path, IN UINT32 BlockSize, IN BOOLEAN WithDiskIo2,
+                                   OUT EFI_HANDLE *ControllerHandle)
+{
+    SHIM_DISK   *Disk;
+    struct stat sb;
+    EFI_STATUS  Status;
+
+    if (BlockSize == 0)
+        return EFI_INVALID_PARAMETER;
+    Disk = calloc(1, sizeof(SHIM_DISK));
+    if (Disk == NULL)
+        return EFI_OUT_OF_RESOURCES;
+    Disk->fd = open(path, O_RDONLY);
+    if (Disk->fd < 0 || fstat(Disk->fd, &sb) < 0 || sb.st_size < BlockSize) {
+        if (Disk->fd >= 0)
+            close(Disk->fd);
+        free(Disk);
+        return EFI_NOT_FOUND;
+    }
+    Disk->Size = ((UINT64) sb.st_size / BlockSize) * BlockSize;
+
+    Disk->Media.MediaId         = 1;
+    Disk->Media.MediaPresent    = TRUE;
+    Disk->Media.ReadOnly        = TRUE;
+    Disk->Media.BlockSize       = BlockSize;
+    Disk->Media.LastBlock       = Disk->Size / BlockSize - 1;
+
+    Disk->BlockIo.Revision      = EFI_BLOCK_IO_INTERFACE_REVISION;
+    Disk->BlockIo.Media         = &Disk->Media;
+    Disk->BlockIo.Reset         = shim_Reset;
+    Disk->BlockIo.ReadBlocks    = shim_ReadBlocks;
+    Disk->BlockIo.WriteBlocks   = shim_WriteBlocks;
+    Disk->BlockIo.FlushBlocks   = shim_FlushBlocks;
+
+    Disk->DiskIo.Revision       = EFI_DISK_IO_INTERFACE_REVISION;
+    Disk->DiskIo.ReadDisk       = shim_ReadDisk;
+    Disk->DiskIo.WriteDisk      = shim_WriteDisk;
+
+    Disk->DiskIo2.Revision      = 0x00020000;
+    Disk->DiskIo2.Cancel        = shim_Cancel;
+    Disk->DiskIo2.ReadDiskEx    = shim_ReadDiskEx;
+    Disk->DiskIo2.WriteDiskEx   = shim_WriteDiskEx;
+    Disk->DiskIo2.FlushDiskEx   = shim_FlushDiskEx;
+    Disk->WithDiskIo2           = WithDiskIo2;
+
+    Disk->Handle = NULL;
+    Status = shim_InstallMultipleProtocolInterfaces(&Disk->Handle,
+                                                    &BlockIoProtocol, &Disk->BlockIo,
+                                                    &DiskIoProtocol, &Disk->DiskIo,
+                                                    NULL);
+    if (!EFI_ERROR(Status) && WithDiskIo2)
+        Status = shim_InstallProtocolInterface(&Disk->Handle, &ShimDiskIo2ProtocolGuid,
+                                               EFI_NATIVE_INTERFACE, &Disk->DiskIo2);
+    if (EFI_ERROR(Status)) {
+        close(Disk->fd);
+        free(Disk);
+        return Status;
+    }
+
+    *ControllerHandle = Disk->Handle;
+    return EFI_SUCCESS;
+}
+
+static SHIM_DISK *shim_find_disk(EFI_HANDLE ControllerHandle)
+{
+    SHIM_PROTOCOL *p;
+
+    p = shim_find_protocol(shim_find_handle(ControllerHandle), &DiskIoProtocol);
+    if (p == NULL || ((EFI_DISK_IO *) p->Interface)->ReadDisk != shim_ReadDisk)
+        return NULL;
+    return SHIM_DISK_FROM_DISK_IO(p->Interface);
+}
+
+/**
+ * Get the counters of the requests that reached an image.
+ */
+
+EFI_STATUS fsw_efi_shim_get_disk_stats(IN EFI_HANDLE ControllerHandle, OUT FSW_EFI_SHIM_DISK_STATS *Stats)
+{
+    SHIM_DISK   *Disk = shim_find_disk(ControllerHandle);
+
+    if (Disk == NULL || Stats == NULL)
+        return EFI_INVALID_PARAMETER;
+    *Stats = Disk->Stats;
+    return EFI_SUCCESS;
+}
+
+/**
+ * Ask the operating system to drop its cached pages of an image, so that the
+ * next reads actually go to the disk.
+ */
+
+EFI_STATUS fsw_efi_shim_drop_os_cache(IN EFI_HANDLE ControllerHandle)
+{
+    SHIM_DISK   *Disk = shim_find_disk(ControllerHandle);
+
+    if (Disk == NULL)
+        return EFI_INVALID_PARAMETER;
+    if (posix_fadvise(Disk->fd, 0, 0, POSIX_FADV_DONTNEED) != 0)
+        return EFI_UNSUPPORTED;
+    return EFI_SUCCESS;
+}
+
+/**
+ * Remove the disk protocols from an image's handle and close the image.
+ * Fails with EFI_ACCESS_DENIED while a driver still has the disk open or has
+ * left protocols of its own on the handle.
+ */
+
+EFI_STATUS fsw_efi_shim_close_image(IN EFI_HANDLE ControllerHandle)
+{
+    SHIM_DISK   *Disk = shim_find_disk(ControllerHandle);
+    SHIM_HANDLE *h = shim_find_handle(ControllerHandle);
+    EFI_STATUS  Status;
+
+    if (Disk == NULL)
+        return EFI_INVALID_PARAMETER;
+    if (h->Count != (Disk->WithDiskIo2 ? 3 : 2))
+        return EFI_ACCESS_DENIED;
+    Status = shim_UninstallMultipleProtocolInterfaces(ControllerHandle,
+                                                      &BlockIoProtocol, &Disk->BlockIo,
+                                                      &DiskIoProtocol, &Disk->DiskIo,
+                                                      NULL);
+    if (!EFI_ERROR(Status) && Disk->WithDiskIo2)
+        Status = shim_uninstall(h, &ShimDiskIo2ProtocolGuid, &Disk->DiskIo2);
+    if (EFI_ERROR(Status))
+        return Status;
+    fsw_efi_shim_destroy_handle(ControllerHandle);
+    close(Disk->fd);
+    free(Disk);
+    return EFI_SUCCESS;
+}
+
+//
+// library functions
+//
+
+VOID InitializeLib(IN EFI_HANDLE ImageHandle, IN EFI_SYSTEM_TABLE *SystemTable)
+{
+    ST = SystemTable;
+    BS = SystemTable->BootServices;
+}
+
+VOID *AllocatePool(IN UINTN Size)
+{
+    return malloc(Size > 0 ? Size : 1);
+}
+
+VOID *AllocateZeroPool(IN UINTN Size)
+{
+    return calloc(1, Size > 0 ? Size : 1);
+}
+
+VOID FreePool(IN VOID *p)
+{
+    free(p);
+}
+
+VOID CopyMem(IN VOID *Dest, IN CONST VOID *Src, IN UINTN len)
+{
+    memmove(Dest, Src, len);
+}
+
+VOID ZeroMem(IN VOID *Buffer, IN UINTN Size)
+{
+    memset(Buffer, 0, Size);
+}
+
+INTN CompareMem(IN CONST VOID *Dest, IN CONST VOID *Src, IN UINTN len)
+{
+    return memcmp(Dest, Src, len);
+}
+
+INTN CompareGuid(IN EFI_GUID *Guid1, IN EFI_GUID *Guid2)
+{
+    return memcmp(Guid1, Guid2, sizeof(EFI_GUID));
+}
+
+UINTN StrLen(IN CONST CHAR16 *s1)
+{
+    UINTN       len;
+
+    for (len = 0; s1[len]; len++)
+        ;
+    return len;
+}
+
+UINTN StrSize(IN CONST CHAR16 *s1)
+{
+    return (StrLen(s1) + 1) * sizeof(CHAR16);
+}
+
+INTN StrCmp(IN CONST CHAR16 *s1, IN CONST CHAR16 *s2)
+{
+    while (*s1 && *s1 == *s2) {
+        s1++;
+        s2++;
+    }
+    return (INTN) *s1 - (INTN) *s2;
+}
+
+static VOID shim_put_str16(CONST CHAR16 *s)
+{
+    if (s == NULL) {
+        fputs("(null)", stdout);
+        return;
+    }
+    for (; *s; s++)
+        putchar(*s < 0x80 ? (int) *s : '?');
+}
+
+/**
+ * Formatted output with the GNU-EFI conventions: the format string and %s
+ * arguments are UCS-2, %a takes an ASCII string, an 'l' size modifier selects
+ * 64-bit integers and %r prints an EFI_STATUS.
+ */
+
+UINTN Print(IN CONST CHAR16 *fmt, ...)
+{
+    va_list     args;
+    char        spec[16];
+    UINTN       n;
+    BOOLEAN     Long;
+    UINT64      Value;
+
+    va_start(args, fmt);
+    for (; *fmt; fmt++) {
+        if (*fmt != '%') {
+            putchar(*fmt < 0x80 ? (int) *fmt : '?');
+            continue;
+        }
+        // collect flags and width, which printf understands the same way
+        n = 0;
+        spec[n++] = '%';
+        for (fmt++; *fmt && strchr("-+ #0123456789.", (int) *fmt) && n < sizeof(spec) - 4; fmt++)
+            spec[n++] = (char) *fmt;
+        Long = FALSE;
+        while (*fmt == 'l') {
+            Long = TRUE;
+            fmt++;
+        }
+        switch (*fmt) {
+            case 'd':
+            case 'u':
+            case 'x':
+            case 'X':
+                Value = Long ? va_arg(args, UINT64) : (UINT64) va_arg(args, UINT32);
+                if (*fmt == 'd' && !Long)
+                    Value = (UINT64) (INT64) (INT32) Value;
+                spec[n++] = 'l';
+                spec[n++] = 'l';
+                spec[n++] = (char) *fmt;
+                spec[n] = 0;
+                printf(spec, (unsigned long long) Value);
+                break;
+            case 'r':
+                printf("0x%llx", (unsigned long long) va_arg(args, EFI_STATUS));
+                break;
+            case 's':
+            case 'S':
+                shim_put_str16(va_arg(args, CHAR16 *));
+                break;
+            case 'a':
+                fputs(va_arg(args, char *), stdout);
+                break;
+            case 'c':
+                putchar(va_arg(args, int));
+                break;
+            case '%':
+                putchar('%');
+                break;
+            case 0:
+                fmt--;
+                break;
+            default:
+                putchar('%');
+                putchar(*fmt < 0x80 ? (int) *fmt : '?');
+                break;
+        }
+    }
+    va_end(args);
+    return 0;
+}
+
+UINT64 LShiftU64(IN UINT64 Operand, IN UINTN Count)
+{
+    return Operand << Count;
+}
+
+UINT64 RShiftU64(IN UINT64 Operand, IN UINTN Count)
+{
+    return Operand >> Count;
+}
+
+UINT64 MultU64x32(IN UINT64 Multiplicand, IN UINTN Multiplier)
+{
+    return Multiplicand * Multiplier;
+}
+
+UINT64 DivU64x32(IN UINT64 Dividend, IN UINTN Divisor, OUT UINTN *Remainder OPTIONAL)
+{
+    if (Remainder != NULL)
+        *Remainder = (UINTN) (Dividend % Divisor);
+    return Dividend / Divisor;
+}
@@ -0,0 +1,68 @@
+/**
+ * \file fsw_efi_shim.h
+ * Linux stand-ins for the UEFI boot services and disk protocols, used to run
+ * the EFI host (fsw_efi.c) as a user space program.
+ */
+
+/*-
+ * Copyright (c) 2026 rEFInd contributors
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *  * Neither the name of the copyright holders nor the names of the
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _FSW_EFI_SHIM_H_
+#define _FSW_EFI_SHIM_H_
+
+#include "fsw_efi.h"
+
+
+/**
+ * EFI Shim: Counters of the requests that reached the image file.
+ */
+
+typedef struct {
+    UINT64      ReadDiskCalls;      //!< Synchronous Disk I/O reads
+    UINT64      ReadDiskBytes;      //!< Bytes read synchronously
+    UINT64      ReadDiskExCalls;    //!< Non-blocking Disk I/O 2 reads
+    UINT64      ReadDiskExBytes;    //!< Bytes read by non-blocking requests
+} FSW_EFI_SHIM_DISK_STATS;
+
+// functions
+
+EFI_HANDLE fsw_efi_shim_create_handle(VOID);
+EFI_STATUS fsw_efi_shim_destroy_handle(IN EFI_HANDLE Handle);
+EFI_STATUS fsw_efi_shim_open_image(IN const char *path, IN UINT32 BlockSize, IN BOOLEAN WithDiskIo2,
+                                   OUT EFI_HANDLE *ControllerHandle);
+EFI_STATUS fsw_efi_shim_close_image(IN EFI_HANDLE ControllerHandle);
+EFI_STATUS fsw_efi_shim_drop_os_cache(IN EFI_HANDLE ControllerHandle);
+EFI_STATUS fsw_efi_shim_get_disk_stats(IN EFI_HANDLE ControllerHandle, OUT FSW_EFI_SHIM_DISK_STATS *Stats);
+
+extern EFI_SYSTEM_TABLE fsw_efi_shim_system_table;
+
+#endif
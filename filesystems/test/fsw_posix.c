@@ -52,7 +52,14 @@ fsw_status_t fsw_posix_open_dno(struct fsw_posix_volume *pvol, const char *path,
 void fsw_posix_change_blocksize(struct fsw_volume *vol,
                               fsw_u32 old_phys_blocksize, fsw_u32 old_log_blocksize,
                               fsw_u32 new_phys_blocksize, fsw_u32 new_log_blocksize);
-fsw_status_t fsw_posix_read_block(struct fsw_volume *vol, fsw_u32 phys_bno, void *buffer);
+fsw_status_t fsw_posix_read_block(struct fsw_volume *vol, fsw_u64 phys_bno, void *buffer);
+fsw_status_t fsw_posix_read_blocks(struct fsw_volume *vol, fsw_u64 phys_bno, fsw_u32 count, void *buffer);
+fsw_status_t fsw_posix_read_blocks_async(struct fsw_volume *vol, fsw_u64 phys_bno, fsw_u32 count, void *buffer,
+                                         void **token_out);
+fsw_status_t fsw_posix_read_wait(struct fsw_volume *vol, void *token);
+fsw_status_t fsw_posix_mmap_read_blocks(struct fsw_volume *vol, fsw_u64 phys_bno, fsw_u32 count, void *buffer);
+fsw_status_t fsw_posix_mmap_read_block(struct fsw_volume *vol, fsw_u64 phys_bno, void *buffer);
+fsw_status_t fsw_posix_mmap_borrow_block(struct fsw_volume *vol, fsw_u64 phys_bno, void **buffer_out);
 
 /**
  * Dispatch table for our FSW host driver.
@@ -62,20 +69,46 @@ struct fsw_host_table   fsw_posix_host_table = {
     FSW_STRING_TYPE_ISO88591,
 
     fsw_posix_change_blocksize,
-    fsw_posix_read_block
+    fsw_posix_read_block,
+    fsw_posix_read_blocks,
+    fsw_posix_read_blocks_async,
+    fsw_posix_read_wait
+};
+
+/**
+ * Dispatch table for volumes mounted with FSW_POSIX_MOUNT_MMAP. Reads are plain
+ * copies out of the mapping, so there is nothing to gain from background reads,
+ * and the block cache borrows pointers into the mapping instead of copying.
+ */
+
+struct fsw_host_table   fsw_posix_mmap_host_table = {
+    FSW_STRING_TYPE_ISO88591,
+
+    fsw_posix_change_blocksize,
+    fsw_posix_mmap_read_block,
+    fsw_posix_mmap_read_blocks,
+    NULL,
+    NULL,
+    fsw_posix_mmap_borrow_block,
+    NULL
 };
 
 extern struct fsw_fstype_table   FSW_FSTYPE_TABLE_NAME(FSTYPE);
 
 
 /**
- * Mount function.
+ * Mount function. With FSW_POSIX_MOUNT_MMAP in flags the whole image is mapped
+ * into memory and blocks are copied out of the mapping instead of being read
+ * with a system call each.
  */
 
-struct fsw_posix_volume * fsw_posix_mount(const char *path, struct fsw_fstype_table *fstype_table)
+struct fsw_posix_volume * fsw_posix_mount(const char *path, struct fsw_fstype_table *fstype_table, int flags)
 {
     fsw_status_t        status;
     struct fsw_posix_volume *pvol;
+    struct fsw_host_table *host_table = &fsw_posix_host_table;
+    off_t               size;
+    void                *map;
 
     // allocate volume structure
     status = fsw_alloc_zero(sizeof(struct fsw_posix_volume), (void **)&pvol);
@@ -91,13 +124,30 @@ struct fsw_posix_volume * fsw_posix_mount(const char *path, struct fsw_fstype_ta
         return NULL;
     }
 
+    // map it, lseek also gives the size of block devices where fstat does not
+    if (flags & FSW_POSIX_MOUNT_MMAP) {
+        size = lseek(pvol->fd, 0, SEEK_END);
+        map = MAP_FAILED;
+        if (size > 0)
+            map = mmap(NULL, (size_t)size, PROT_READ, MAP_SHARED, pvol->fd, 0);
+        if (map == MAP_FAILED) {
+            fprintf(stderr, "fsw_posix_mount: %s: cannot map: %s\n", path, size > 0 ? strerror(errno) : "empty");
+            close(pvol->fd);
+            fsw_free(pvol);
+            return NULL;
+        }
+        pvol->map = map;
+        pvol->map_size = (fsw_u64)size;
+        host_table = &fsw_posix_mmap_host_table;
+    }
+
     // mount the filesystem
     if (fstype_table == NULL)
         fstype_table = &FSW_FSTYPE_TABLE_NAME(FSTYPE);
-    status = fsw_mount(pvol, &fsw_posix_host_table, fstype_table, &pvol->vol);
+    status = fsw_mount(pvol, host_table, fstype_table, &pvol->vol);
     if (status) {
         fprintf(stderr, "fsw_posix_mount: fsw_mount returned %d\n", status);
-        fsw_free(pvol);
+        fsw_posix_unmount(pvol);
         return NULL;
     }
 
@@ -112,10 +162,45 @@ int fsw_posix_unmount(struct fsw_posix_volume *pvol)
 {
     if (pvol->vol != NULL)
         fsw_unmount(pvol->vol);
+    if (pvol->map != NULL)
+        munmap(pvol->map, (size_t)pvol->map_size);
+    if (pvol->fd >= 0)
+        close(pvol->fd);
     fsw_free(pvol);
     return 0;
 }
 
+/**
+ * Print the I/O and cache statistics of a volume. Times are in microseconds.
+ */
+
+void fsw_posix_print_stats(struct fsw_posix_volume *pvol, FILE *f)
+{
+    struct fsw_io_stats stats;
+    int                 i;
+
+    fsw_volume_get_io_stats(pvol->vol, &stats);
+
+    fprintf(f, "block cache:");
+    for (i = 0; i <= MAX_CACHE_LEVEL; i++)
+        fprintf(f, " L%d %llu/%llu", i,
+                (unsigned long long)stats.bcache_hits[i], (unsigned long long)stats.bcache_misses[i]);
+    fprintf(f, " (hits/misses), %llu evictions, %llu borrowed\n", (unsigned long long)stats.bcache_evictions,
+            (unsigned long long)stats.bcache_borrowed);
+    fprintf(f, "read_block:  %llu calls, %llu bytes\n",
+            (unsigned long long)stats.read_block_calls, (unsigned long long)stats.read_block_bytes);
+    fprintf(f, "get_extent:  %llu calls, %llu us, %llu extent map hits\n",
+            (unsigned long long)stats.get_extent_calls, (unsigned long long)stats.get_extent_ticks / 1000,
+            (unsigned long long)stats.extent_map_hits);
+    fprintf(f, "dir_lookup:  %llu calls, %llu us, %llu lookup cache hits\n",
+            (unsigned long long)stats.dir_lookup_calls, (unsigned long long)stats.dir_lookup_ticks / 1000,
+            (unsigned long long)stats.dcache_hits);
+    fprintf(f, "dir_read:    %llu calls, %llu us\n",
+            (unsigned long long)stats.dir_read_calls, (unsigned long long)stats.dir_read_ticks / 1000);
+    fprintf(f, "async read:  %llu calls, %llu us waiting\n",
+            (unsigned long long)stats.async_read_calls, (unsigned long long)stats.async_wait_ticks / 1000);
+}
+
 /**
  * Open a named regular file.
  */
@@ -229,7 +314,7 @@ struct dirent * fsw_posix_readdir(struct fsw_posix_dir *dir)
 {
     fsw_status_t        status;
     struct fsw_dnode    *dno;
-    static struct dirent dent;
+    struct dirent       *dent = &dir->dent;
 
     // get next entry from file system
     status = fsw_dnode_dir_read(&dir->shand, &dno);
@@ -246,29 +331,30 @@ struct dirent * fsw_posix_readdir(struct fsw_posix_dir *dir)
     }
 
     // fill dirent structure
-    dent.d_fileno = dno->dnode_id;
-    dent.d_reclen = 8 + dno->name.size + 1;
+    dent->d_fileno = dno->dnode_id;
+    dent->d_reclen = 8 + dno->name.size + 1;
     switch (dno->type) {
         case FSW_DNODE_TYPE_FILE:
-            dent.d_type = DT_REG;
+            dent->d_type = DT_REG;
             break;
         case FSW_DNODE_TYPE_DIR:
-            dent.d_type = DT_DIR;
+            dent->d_type = DT_DIR;
             break;
         case FSW_DNODE_TYPE_SYMLINK:
-            dent.d_type = DT_LNK;
+            dent->d_type = DT_LNK;
             break;
         default:
-            dent.d_type = DT_UNKNOWN;
+            dent->d_type = DT_UNKNOWN;
             break;
     }
 #if 0
-    dent.d_namlen = dno->name.size;
+    dent->d_namlen = dno->name.size;
 #endif
-    memcpy(dent.d_name, dno->name.data, dno->name.size);
-    dent.d_name[dno->name.size] = 0;
+    memcpy(dent->d_name, dno->name.data, dno->name.size);
+    dent->d_name[dno->name.size] = 0;
 
-    return &dent;
+    fsw_dnode_release(dno);
+    return dent;
 }
 
 /**
@@ -362,26 +448,188 @@ void fsw_posix_change_blocksize(struct fsw_volume *vol,
  * to read a block of data from the device. The buffer is allocated by the core code.
  */
 
-fsw_status_t fsw_posix_read_block(struct fsw_volume *vol, fsw_u32 phys_bno, void *buffer)
+fsw_status_t fsw_posix_read_block(struct fsw_volume *vol, fsw_u64 phys_bno, void *buffer)
+{
+    return fsw_posix_read_blocks(vol, phys_bno, 1, buffer);
+}
+
+/**
+ * FSW interface function to read a run of consecutive data blocks with a single
+ * system call. This function is called by the FSW core for bulk file data.
+ */
+
+fsw_status_t fsw_posix_read_blocks(struct fsw_volume *vol, fsw_u64 phys_bno, fsw_u32 count, void *buffer)
 {
     struct fsw_posix_volume *pvol = (struct fsw_posix_volume *)vol->host_data;
-    off_t           block_offset, seek_result;
+    off_t           block_offset;
     ssize_t         read_result;
+    size_t          read_size, done;
 
-    FSW_MSG_DEBUGV((FSW_MSGSTR("fsw_posix_read_block: %d  (%d)\n"), phys_bno, vol->phys_blocksize));
+    FSW_MSG_DEBUGV((FSW_MSGSTR("fsw_posix_read_blocks: %llu +%u  (%d)\n"),
+                    (unsigned long long)phys_bno, count, vol->phys_blocksize));
 
-    // read from disk
+    // read from disk, pread may return short counts on devices and for large requests
     block_offset = (off_t)phys_bno * vol->phys_blocksize;
-    seek_result = lseek(pvol->fd, block_offset, SEEK_SET);
-    if (seek_result != block_offset)
+    read_size = (size_t)count * vol->phys_blocksize;
+    for (done = 0; done < read_size; done += read_result) {
+        read_result = pread(pvol->fd, (char *)buffer + done, read_size - done, block_offset + done);
+        if (read_result < 0 && errno == EINTR) {
+            read_result = 0;
+            continue;
+        }
+        if (read_result <= 0)
+            return FSW_IO_ERROR;
+    }
+
+    return FSW_SUCCESS;
+}
+
+/**
+ * FSW interface function to read a data block from a mapped image.
+ */
+
+fsw_status_t fsw_posix_mmap_read_block(struct fsw_volume *vol, fsw_u64 phys_bno, void *buffer)
+{
+    return fsw_posix_mmap_read_blocks(vol, phys_bno, 1, buffer);
+}
+
+/**
+ * FSW interface function to read a run of consecutive data blocks from a mapped
+ * image. Requests reaching past the end of the image fail like a short read does.
+ */
+
+fsw_status_t fsw_posix_mmap_read_blocks(struct fsw_volume *vol, fsw_u64 phys_bno, fsw_u32 count, void *buffer)
+{
+    struct fsw_posix_volume *pvol = (struct fsw_posix_volume *)vol->host_data;
+    fsw_u64         block_offset, read_size;
+
+    FSW_MSG_DEBUGV((FSW_MSGSTR("fsw_posix_mmap_read_blocks: %llu +%u  (%d)\n"),
+                    (unsigned long long)phys_bno, count, vol->phys_blocksize));
+
+    read_size = (fsw_u64)count * vol->phys_blocksize;
+    if (phys_bno >= pvol->map_size / vol->phys_blocksize)
         return FSW_IO_ERROR;
-    read_result = read(pvol->fd, buffer, vol->phys_blocksize);
-    if (read_result != vol->phys_blocksize)
+    block_offset = phys_bno * vol->phys_blocksize;
+    if (read_size > pvol->map_size - block_offset)
         return FSW_IO_ERROR;
+    fsw_memcpy(buffer, pvol->map + block_offset, (size_t)read_size);
 
     return FSW_SUCCESS;
 }
 
+/**
+ * FSW interface function to lend a block of a mapped image to the block cache. The
+ * mapping stays until unmount, so the pointer needs no release.
+ */
+
+fsw_status_t fsw_posix_mmap_borrow_block(struct fsw_volume *vol, fsw_u64 phys_bno, void **buffer_out)
+{
+    struct fsw_posix_volume *pvol = (struct fsw_posix_volume *)vol->host_data;
+
+    if (phys_bno >= pvol->map_size / vol->phys_blocksize)
+        return FSW_IO_ERROR;
+    *buffer_out = pvol->map + phys_bno * vol->phys_blocksize;
+    return FSW_SUCCESS;
+}
+
+/**
+ * FSW interface function to start reading a run of consecutive data blocks in the
+ * background. This is the POSIX stand-in for the DiskIo2 ReadDiskEx call of the EFI
+ * host and uses POSIX asynchronous I/O; the token is the request's control block.
+ */
+
+fsw_status_t fsw_posix_read_blocks_async(struct fsw_volume *vol, fsw_u64 phys_bno, fsw_u32 count, void *buffer,
+                                         void **token_out)
+{
+    struct fsw_posix_volume *pvol = (struct fsw_posix_volume *)vol->host_data;
+    struct aiocb    *cb;
+
+    FSW_MSG_DEBUGV((FSW_MSGSTR("fsw_posix_read_blocks_async: %llu +%u  (%d)\n"),
+                    (unsigned long long)phys_bno, count, vol->phys_blocksize));
+
+    if (fsw_alloc_zero(sizeof(struct aiocb), (void **)&cb))
+        return FSW_OUT_OF_MEMORY;
+    cb->aio_fildes = pvol->fd;
+    cb->aio_offset = (off_t)phys_bno * vol->phys_blocksize;
+    cb->aio_buf = buffer;
+    cb->aio_nbytes = (size_t)count * vol->phys_blocksize;
+    cb->aio_sigevent.sigev_notify = SIGEV_NONE;
+    if (aio_read(cb) != 0) {
+        fsw_free(cb);
+        return FSW_IO_ERROR;
+    }
+
+    *token_out = cb;
+    return FSW_SUCCESS;
+}
+
+/**
+ * FSW interface function to wait for a background read and free its control block.
+ */
+
+fsw_status_t fsw_posix_read_wait(struct fsw_volume *vol, void *token)
+{
+    struct aiocb    *cb = (struct aiocb *)token;
+    const struct aiocb *list[1];
+    ssize_t         read_result;
+    size_t          read_size = cb->aio_nbytes;
+
+    list[0] = cb;
+    while (aio_error(cb) == EINPROGRESS)
+        aio_suspend(list, 1, NULL);
+    read_result = aio_return(cb);
+    fsw_free(cb);
+    if (read_result < 0 || (size_t)read_result != read_size)
+        return FSW_IO_ERROR;
+
+    return FSW_SUCCESS;
+}
+
+/**
+ * Time mapping callback for the fsw_dnode_stat call. If the caller passed a
+ * struct stat in host_data, the timestamp is stored there.
+ */
+
+void fsw_store_time_posix(struct fsw_dnode_stat *sb, int which, fsw_u32 posix_time)
+{
+    struct stat         *st = (struct stat *)sb->host_data;
+
+    if (st == NULL)
+        return;
+    if (which == FSW_DNODE_STAT_CTIME)
+        st->st_ctime = posix_time;
+    else if (which == FSW_DNODE_STAT_MTIME)
+        st->st_mtime = posix_time;
+    else if (which == FSW_DNODE_STAT_ATIME)
+        st->st_atime = posix_time;
+}
+
+/**
+ * Mode mapping callback for the fsw_dnode_stat call. If the caller passed a
+ * struct stat in host_data, the mode is stored there.
+ */
+
+void fsw_store_attr_posix(struct fsw_dnode_stat *sb, fsw_u16 posix_mode)
+{
+    struct stat         *st = (struct stat *)sb->host_data;
+
+    if (st != NULL)
+        st->st_mode = posix_mode;
+}
+
+/**
+ * Attribute mapping callback for file systems that store EFI/DOS style attributes.
+ * Only the read-only bit has a POSIX equivalent.
+ */
+
+void fsw_store_attr_efi(struct fsw_dnode_stat *sb, fsw_u16 attr)
+{
+    struct stat         *st = (struct stat *)sb->host_data;
+
+    if (st != NULL && (attr & 0x01))    // EFI_FILE_READ_ONLY
+        st->st_mode &= ~(S_IWUSR | S_IWGRP | S_IWOTH);
+}
+
 
 /**
  * Time mapping callback for the fsw_dnode_stat call. This function converts
@@ -41,7 +41,9 @@
 #include "fsw_core.h"
 
 #include <fcntl.h>
+#include <aio.h>
 #include <sys/types.h>
+#include <sys/mman.h>
 #include <sys/dir.h>
 
 
@@ -53,9 +55,14 @@ struct fsw_posix_volume {
     struct fsw_volume           *vol;           //!< FSW volume structure
 
     int                         fd;             //!< System file descriptor for data access
+    fsw_u8                      *map;           //!< Mapping of the whole image with FSW_POSIX_MOUNT_MMAP, or NULL
+    fsw_u64                     map_size;       //!< Size of the mapping in bytes
 
 };
 
+/** fsw_posix_mount flag: map the image and copy blocks out of the mapping. */
+#define FSW_POSIX_MOUNT_MMAP    (1)
+
 /**
  * POSIX Host: Private structure for an open file.
  */
@@ -75,14 +82,16 @@ struct fsw_posix_dir {
     struct fsw_posix_volume     *pvol;          //!< POSIX host volume structure
 
     struct fsw_shandle          shand;          //!< FSW handle for this file
+    struct dirent               dent;           //!< Entry returned by the last fsw_posix_readdir
 
 };
 
 
 /* functions */
 
-struct fsw_posix_volume * fsw_posix_mount(const char *path, struct fsw_fstype_table *fstype_table);
+struct fsw_posix_volume * fsw_posix_mount(const char *path, struct fsw_fstype_table *fstype_table, int flags);
 int fsw_posix_unmount(struct fsw_posix_volume *pvol);
+void fsw_posix_print_stats(struct fsw_posix_volume *pvol, FILE *f);
 
 struct fsw_posix_file * fsw_posix_open(struct fsw_posix_volume *pvol, const char *path, int flags, mode_t mode);
 ssize_t fsw_posix_read(struct fsw_posix_file *file, void *buf, size_t nbytes);
@@ -45,10 +45,18 @@
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
+#include <sys/stat.h>
+#include <time.h>
 
 #define FSW_LITTLE_ENDIAN (1)
 // TODO: use info from the headers to define FSW_LITTLE_ENDIAN or FSW_BIG_ENDIAN
 
+// calling convention of the host table functions (only relevant for EFI)
+
+#ifndef EFIAPI
+#define EFIAPI
+#endif
+
 
 // types
 
@@ -87,4 +95,38 @@ typedef uint64_t            fsw_u64;
 #define RShiftU64(val, shift) ((val) >> (shift))
 #define LShiftU64(val, shift) ((val) << (shift))
 
+// tick counter for the I/O statistics, in nanoseconds
+
+static inline fsw_u64 fsw_posix_get_ticks(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (fsw_u64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+#define FSW_GET_TICKS() fsw_posix_get_ticks()
+
+// volume locks for hosts that use the core from several threads. They must be
+//  recursive because drivers call back into the core while holding the lock.
+
+#ifdef FSW_POSIX_THREADS
+#include <pthread.h>
+
+static inline void fsw_posix_lock_init(pthread_mutex_t *lock)
+{
+    pthread_mutexattr_t attr;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+#define FSW_LOCK_TYPE pthread_mutex_t
+#define FSW_LOCK_INIT(lock) fsw_posix_lock_init(lock)
+#define FSW_LOCK_DESTROY(lock) pthread_mutex_destroy(lock)
+#define FSW_LOCK_ACQUIRE(lock) pthread_mutex_lock(lock)
+#define FSW_LOCK_RELEASE(lock) pthread_mutex_unlock(lock)
+#endif
+
 #endif
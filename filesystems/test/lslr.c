@@ -108,15 +108,20 @@ static int catfile(struct fsw_posix_volume *vol, char *path)
 int main(int argc, char **argv)
 {
     struct fsw_posix_volume *vol;
-    int i;
+    int i, flags = 0;
 
+    if (argc == 3 && strcmp(argv[1], "-m") == 0) {
+        flags |= FSW_POSIX_MOUNT_MMAP;
+        argc--;
+        argv++;
+    }
     if (argc != 2) {
-        fprintf(stderr, "Usage: lslr <file/device>\n");
+        fprintf(stderr, "Usage: lslr [-m] <file/device>\n");
         return 1;
     }
 
     for (i = 0; fstypes[i]; i++) {
-        vol = fsw_posix_mount(argv[1], fstypes[i]);
+        vol = fsw_posix_mount(argv[1], fstypes[i], flags);
         if (vol != NULL) {
             fprintf(stderr, "Mounted as '%s'.\n", fstypes[i]->name.data);
             break;
@@ -130,6 +135,7 @@ int main(int argc, char **argv)
     listdir(vol, "/boot/", 0);
     catfile(vol, "/boot/testfile.txt");
 
+    fsw_posix_print_stats(vol, stderr);
     fsw_posix_unmount(vol);
 
     return 0;
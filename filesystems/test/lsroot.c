@@ -57,7 +57,7 @@ int main(int argc, char **argv)
 
     //vol = fsw_posix_mount(argv[1], &FSW_FSTYPE_TABLE_NAME(ext2));
     //vol = fsw_posix_mount(argv[1], &FSW_FSTYPE_TABLE_NAME(reiserfs));
-    vol = fsw_posix_mount(argv[1], &FSW_FSTYPE_TABLE_NAME(FSTYPE));
+    vol = fsw_posix_mount(argv[1], &FSW_FSTYPE_TABLE_NAME(FSTYPE), 0);
     if (vol == NULL) {
         fprintf(stderr, "Mounting failed.\n");
         return 1;
@@ -72,6 +72,7 @@ int main(int argc, char **argv)
         fprintf(stderr, "- %s\n", dent->d_name);
     }
     fsw_posix_closedir(dir);
+    fsw_posix_print_stats(vol, stderr);
     fsw_posix_unmount(vol);
 
     return 0;
@@ -0,0 +1,279 @@
+#!/bin/sh
+#
+# Build a reproducible corpus of file system images for fsw_bench.
+#
+# Usage: mkcorpus.sh [<output directory>]
+#
+# Each image is named <driver>-<variant>.img after the driver meant to read
+# it. File contents come from fixed seeds and all timestamps and UUIDs are
+# fixed, so the ext2/ext4, btrfs and ISO images come out the same on every
+# run with the same tool versions. Images whose tools are missing are
+# skipped. HFS+, NTFS and ReiserFS cannot be populated without mounting them,
+# so they are only built when running as root with loop mounts available,
+# and their timestamps are not reproducible.
+#
+# Needs e2fsprogs (mkfs.ext2/ext4, debugfs, e2fsck) and openssl; optionally
+# mkfs.btrfs, xorriso/genisoimage/mkisofs, mkfs.hfsplus, mkntfs with
+# ntfs-3g, mkreiserfs.
+#
+
+set -e
+
+OUT=${1:-corpus}
+UUID=2f6c9d1e-5b7a-4c38-9e21-0d4b6a8f3c17
+EPOCH=1500000000
+
+# reproducible timestamps for e2fsprogs, btrfs-progs and xorriso
+E2FSPROGS_FAKE_TIME=$EPOCH
+E2FSCK_TIME=$EPOCH
+SOURCE_DATE_EPOCH=$EPOCH
+export E2FSPROGS_FAKE_TIME E2FSCK_TIME SOURCE_DATE_EPOCH
+
+BUILT=""
+SKIPPED=""
+
+have() {
+    command -v "$1" >/dev/null 2>&1
+}
+
+built() {
+    BUILT="$BUILT $1"
+}
+
+skipped() {
+    SKIPPED="$SKIPPED $1($2)"
+}
+
+# gen_random <file> <bytes> <seed>: incompressible data
+gen_random() {
+    key=$(printf '%s' "$3" | md5sum | cut -c1-32)
+    head -c "$2" /dev/zero | openssl enc -aes-128-ctr -nosalt -K "$key" \
+        -iv 00000000000000000000000000000000 > "$1"
+}
+
+# gen_text <file> <lines> <seed>: compressible text
+gen_text() {
+    awk -v n="$2" -v seed="$3" 'BEGIN {
+        srand(length(seed) * 7919);
+        for (i = 0; i < n; i++)
+            printf("%s %08d %s kernel: fsw test line with some repeated words %d\n",
+                   seed, i, (i % 3) ? "info" : "warn", int(rand() * 100000));
+    }' > "$1"
+}
+
+# make_tree <dir>: the common file tree of all images
+make_tree() {
+    mkdir -p "$1/boot/grub" "$1/EFI/BOOT" "$1/data" "$1/usr/share/doc"
+    gen_random "$1/boot/vmlinuz" 8388608 vmlinuz
+    gen_random "$1/boot/initrd.img" 16777216 initrd
+    gen_text "$1/boot/grub/grub.cfg" 200 grub
+    gen_random "$1/EFI/BOOT/BOOTX64.EFI" 1048576 bootx64
+    gen_text "$1/data/text.log" 120000 log
+    ln -s vmlinuz "$1/boot/vmlinuz.link"
+
+    # many small files in a few hundred directories
+    i=0
+    while [ $i -lt 300 ]; do
+        d=$(printf '%s/usr/share/doc/pkg%03d' "$1" $i)
+        mkdir -p "$d"
+        gen_text "$d/README" $((i % 40 + 5)) "readme$i"
+        gen_text "$d/copyright" 20 "copyright$i"
+        gen_text "$d/changelog" $((i % 200 + 10)) "changelog$i"
+        i=$((i + 1))
+    done
+
+    # a deep path for lookups
+    d="$1/deep"
+    i=0
+    while [ $i -lt 16 ]; do
+        d="$d/level$i"
+        i=$((i + 1))
+    done
+    mkdir -p "$d"
+    gen_text "$d/file" 10 deep
+}
+
+# make_bigdir <dir> <entries>: one directory with many empty files
+make_bigdir() {
+    mkdir -p "$1/bigdir"
+    awk -v n="$2" -v d="$1/bigdir" 'BEGIN {
+        for (i = 0; i < n; i++)
+            printf("%s/entry-%06d-%x\n", d, i, (i * 2654435761) % 4294967296);
+    }' | xargs touch
+}
+
+# fix_times <dir>: set all timestamps to the fixed epoch
+fix_times() {
+    find "$1" -exec touch -h -d "@$EPOCH" {} +
+}
+
+# mkfs_ext <image> <size> <mkfs command and options...>: ext image of the tree in $TREE
+mkfs_ext() {
+    img=$1
+    size=$2
+    shift 2
+    rm -f "$img"
+    truncate -s "$size" "$img"
+    "$@" -q -F -U "$UUID" -E hash_seed="$UUID" -L fswbench -d "$TREE" "$img" || return 1
+
+    # mkfs copies ctime and atime from the staging tree, where they can't be set
+    (cd "$TREE" && find . -mindepth 1) |
+        sed -e 's|^\.\(.*\)|sif \1 ctime @'$EPOCH'\nsif \1 atime @'$EPOCH'|' > "$OUT/debugfs.cmd"
+    printf 'sif / ctime @%s\nsif / atime @%s\n' $EPOCH $EPOCH >> "$OUT/debugfs.cmd"
+    debugfs -w -f "$OUT/debugfs.cmd" "$img" >/dev/null 2>&1
+    rm -f "$OUT/debugfs.cmd"
+}
+
+# fragment <image> <size>: delete every other fill file, then write a file into the holes
+fragment() {
+    cmds="$OUT/debugfs.cmd"
+    : > "$cmds"
+    odd=0
+    for f in "$TREE/fill/"*; do
+        [ $odd -eq 1 ] && echo "rm /fill/${f##*/}" >> "$cmds"
+        odd=$((1 - odd))
+    done
+    gen_random "$OUT/frag.bin" "$2" fragmented
+    echo "write $OUT/frag.bin /frag.bin" >> "$cmds"
+    for t in atime ctime mtime crtime; do
+        echo "sif /frag.bin $t @$EPOCH" >> "$cmds"
+    done
+    debugfs -w -f "$cmds" "$1" >/dev/null 2>&1
+    rm -f "$cmds" "$OUT/frag.bin"
+}
+
+# populate_mounted <image> <mount type>: copy the tree in $TREE into a loop mount
+populate_mounted() {
+    mnt="$OUT/mnt"
+    mkdir -p "$mnt"
+    mount -o loop -t "$2" "$1" "$mnt" || return 1
+    cp -a "$TREE/." "$mnt/" || { umount "$mnt"; return 1; }
+    umount "$mnt"
+    rmdir "$mnt"
+}
+
+can_mount() {
+    [ "$(id -u)" -eq 0 ] && have mount && have losetup
+}
+
+have mkfs.ext4 && have debugfs && have e2fsck && have openssl || {
+    echo "mkcorpus.sh: needs e2fsprogs and openssl" >&2
+    exit 1
+}
+
+mkdir -p "$OUT"
+STAGE="$OUT/stage"
+rm -rf "$STAGE"
+mkdir -p "$STAGE"
+
+# the common tree
+TREE="$STAGE/tree"
+make_tree "$TREE"
+fix_times "$TREE"
+
+# the tree plus a directory with many entries
+TREE="$STAGE/bigdir"
+mkdir -p "$TREE"
+cp -a "$STAGE/tree/boot" "$TREE/"
+make_bigdir "$TREE" 20000
+fix_times "$TREE"
+
+# a small tree plus fill files, for fragmenting
+TREE="$STAGE/fill"
+mkdir -p "$TREE/fill"
+cp -a "$STAGE/tree/boot/grub" "$TREE/"
+gen_random "$STAGE/fill.bin" $((1200 * 32768)) fill
+split -b 32768 -a 4 -d "$STAGE/fill.bin" "$TREE/fill/f-"
+rm -f "$STAGE/fill.bin"
+fix_times "$TREE"
+
+# ext2 and ext4
+TREE="$STAGE/tree"
+mkfs_ext "$OUT/ext2-1k.img" 128M mkfs.ext2 -b 1024 && built ext2-1k
+mkfs_ext "$OUT/ext2-4k.img" 128M mkfs.ext2 -b 4096 && built ext2-4k
+mkfs_ext "$OUT/ext4-4k.img" 128M mkfs.ext4 -b 4096 && built ext4-4k
+mkfs_ext "$OUT/ext4-1k.img" 128M mkfs.ext4 -b 1024 && built ext4-1k
+mkfs_ext "$OUT/ext4-noextent.img" 128M mkfs.ext4 -b 4096 -O ^extent,^64bit && built ext4-noextent
+mkfs_ext "$OUT/ext4-noflexbg.img" 128M mkfs.ext4 -b 4096 -O ^flex_bg && built ext4-noflexbg
+
+# fragmented files: indirect blocks on ext2, a deep extent tree on ext4
+TREE="$STAGE/fill"
+mkfs_ext "$OUT/ext2-frag.img" 64M mkfs.ext2 -b 1024 && fragment "$OUT/ext2-frag.img" 16777216 && built ext2-frag
+mkfs_ext "$OUT/ext4-frag.img" 64M mkfs.ext4 -b 1024 && fragment "$OUT/ext4-frag.img" 16777216 && built ext4-frag
+
+# huge directories: hashed (indexed by e2fsck) and linear
+TREE="$STAGE/bigdir"
+if mkfs_ext "$OUT/ext4-bigdir.img" 128M mkfs.ext4 -b 4096 -N 32768 -O dir_index; then
+    # e2fsck returns 1 when it changed the file system; the amount of data it
+    #  writes varies, so clear the lifetime write counter afterwards
+    e2fsck -fyD "$OUT/ext4-bigdir.img" >/dev/null 2>&1 || [ $? -eq 1 ]
+    debugfs -w -R "ssv kbytes_written 0" "$OUT/ext4-bigdir.img" >/dev/null 2>&1
+    built ext4-bigdir
+fi
+mkfs_ext "$OUT/ext2-bigdir.img" 128M mkfs.ext2 -b 4096 -N 32768 -O ^dir_index && built ext2-bigdir
+
+# btrfs, plain and compressed
+TREE="$STAGE/tree"
+if have mkfs.btrfs && mkfs.btrfs --help 2>&1 | grep -q -- --rootdir; then
+    for c in none zlib lzo; do
+        img="$OUT/btrfs-$c.img"
+        rm -f "$img"
+        truncate -s 256M "$img"
+        if [ $c = none ]; then
+            mkfs.btrfs -q -f -U "$UUID" -L fswbench --rootdir "$TREE" "$img" && built btrfs-$c
+        elif mkfs.btrfs --help 2>&1 | grep -q -- --compress; then
+            mkfs.btrfs -q -f -U "$UUID" -L fswbench --rootdir "$TREE" --compress $c "$img" && built btrfs-$c
+        else
+            rm -f "$img"
+            skipped btrfs-$c "mkfs.btrfs without --compress"
+        fi
+    done
+else
+    skipped btrfs "no mkfs.btrfs with --rootdir"
+fi
+
+# ISO 9660 with Rock Ridge and Joliet
+if have xorriso; then
+    xorriso -as mkisofs -quiet -R -J -V FSWBENCH -o "$OUT/iso9660-rr.img" "$TREE" && built iso9660-rr
+elif have genisoimage; then
+    genisoimage -quiet -R -J -V FSWBENCH -o "$OUT/iso9660-rr.img" "$TREE" && built iso9660-rr
+elif have mkisofs; then
+    mkisofs -quiet -R -J -V FSWBENCH -o "$OUT/iso9660-rr.img" "$TREE" && built iso9660-rr
+else
+    skipped iso9660 "no xorriso, genisoimage or mkisofs"
+fi
+
+# file systems that need a loop mount to be populated
+if can_mount; then
+    if have mkfs.hfsplus; then
+        rm -f "$OUT/hfs-plus.img"
+        truncate -s 128M "$OUT/hfs-plus.img"
+        mkfs.hfsplus -v fswbench "$OUT/hfs-plus.img" >/dev/null &&
+            populate_mounted "$OUT/hfs-plus.img" hfsplus && built hfs-plus || skipped hfs "mount failed"
+    else
+        skipped hfs "no mkfs.hfsplus"
+    fi
+    if have mkntfs && have ntfs-3g; then
+        rm -f "$OUT/ntfs-plain.img"
+        truncate -s 128M "$OUT/ntfs-plain.img"
+        mkntfs -q -F -Q -L fswbench "$OUT/ntfs-plain.img" &&
+            populate_mounted "$OUT/ntfs-plain.img" ntfs-3g && built ntfs-plain || skipped ntfs "mount failed"
+    else
+        skipped ntfs "no mkntfs or ntfs-3g"
+    fi
+    if have mkreiserfs; then
+        rm -f "$OUT/reiserfs-plain.img"
+        truncate -s 128M "$OUT/reiserfs-plain.img"
+        mkreiserfs -q -f -u "$UUID" -l fswbench "$OUT/reiserfs-plain.img" >/dev/null 2>&1 &&
+            populate_mounted "$OUT/reiserfs-plain.img" reiserfs && built reiserfs-plain || skipped reiserfs "mount failed"
+    else
+        skipped reiserfs "no mkreiserfs"
+    fi
+else
+    skipped "hfs,ntfs,reiserfs" "need root and loop mounts"
+fi
+
+rm -rf "$STAGE"
+
+echo "built in $OUT:$BUILT"
+[ -z "$SKIPPED" ] || echo "skipped:$SKIPPED"
@@ -0,0 +1,290 @@
+/**
+ * \file mtread.c
+ * Test program for using the core from several threads. Mounts one or more
+ * images with the POSIX host built with FSW_POSIX_THREADS, reads every regular
+ * file once to record its checksum, then lets a number of threads look up and
+ * read all files of all volumes at the same time and compares the results.
+ */
+
+/*-
+ * Copyright (c) 2026 rEFInd contributors
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the
+ *    distribution.
+ *
+ *  * Neither the name of the copyright holders nor the names of the
+ *    contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "fsw_posix.h"
+
+#ifndef FSW_POSIX_THREADS
+#error "mtread must be built with -DFSW_POSIX_THREADS"
+#endif
+
+#define MAX_VOLUMES (16)
+#define MAX_THREADS (64)
+
+/** One regular file found while scanning a volume. */
+typedef struct {
+    int         volume;
+    char        *path;
+    fsw_u64     sum;
+} FILE_ENTRY;
+
+static struct fsw_posix_volume *volumes[MAX_VOLUMES];
+static FILE_ENTRY *files = NULL;
+static size_t file_count = 0, file_alloc = 0;
+static size_t read_chunk = 65536;
+static int thread_count = 4;
+static int rounds = 1;
+
+/** Per-thread state and results. */
+typedef struct {
+    pthread_t   thread;
+    int         index;
+    fsw_u64     bytes;
+    int         errors;
+} THREAD_STATE;
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Read a whole file and return its FNV-1a checksum, or -1 in *bytes on errors.
+ */
+
+static fsw_u64 checksum_file(struct fsw_posix_volume *vol, const char *path, char *buf, fsw_s64 *bytes)
+{
+    struct fsw_posix_file *file;
+    fsw_u64     sum = 0xcbf29ce484222325ULL;
+    ssize_t     r, i;
+
+    *bytes = 0;
+    file = fsw_posix_open(vol, path, 0, 0);
+    if (file == NULL) {
+        *bytes = -1;
+        return 0;
+    }
+    while ((r = fsw_posix_read(file, buf, read_chunk)) > 0) {
+        for (i = 0; i < r; i++)
+            sum = (sum ^ (fsw_u8)buf[i]) * 0x100000001b3ULL;
+        *bytes += r;
+    }
+    if (r < 0)
+        *bytes = -1;
+    fsw_posix_close(file);
+    return sum;
+}
+
+/**
+ * Collect the regular files below path.
+ */
+
+static int scan_dir(int volume, const char *path)
+{
+    struct fsw_posix_dir *dir;
+    struct dirent *dent;
+    char        subpath[4096];
+    int         err = 0;
+
+    dir = fsw_posix_opendir(volumes[volume], path);
+    if (dir == NULL)
+        return 1;
+    while ((dent = fsw_posix_readdir(dir)) != NULL) {
+        snprintf(subpath, sizeof(subpath), "%s%s", path, dent->d_name);
+        if (dent->d_type == DT_DIR) {
+            strncat(subpath, "/", sizeof(subpath) - strlen(subpath) - 1);
+            err |= scan_dir(volume, subpath);
+        } else if (dent->d_type == DT_REG) {
+            if (file_count == file_alloc) {
+                file_alloc = file_alloc ? file_alloc * 2 : 256;
+                files = realloc(files, file_alloc * sizeof(FILE_ENTRY));
+                if (files == NULL) {
+                    fprintf(stderr, "Out of memory.\n");
+                    exit(1);
+                }
+            }
+            files[file_count].volume = volume;
+            files[file_count].path = strdup(subpath);
+            files[file_count].sum = 0;
+            file_count++;
+        }
+    }
+    fsw_posix_closedir(dir);
+    return err;
+}
+
+/**
+ * Thread body: read all files, each thread starting at a different one, and
+ * check them against the reference checksums.
+ */
+
+static void *reader(void *arg)
+{
+    THREAD_STATE *ts = arg;
+    char        *buf;
+    size_t      n, i;
+    fsw_s64     bytes;
+    fsw_u64     sum;
+    int         round;
+
+    buf = malloc(read_chunk);
+    if (buf == NULL) {
+        ts->errors++;
+        return NULL;
+    }
+    for (round = 0; round < rounds; round++) {
+        for (n = 0; n < file_count; n++) {
+            i = (n + (size_t)ts->index * file_count / thread_count) % file_count;
+            sum = checksum_file(volumes[files[i].volume], files[i].path, buf, &bytes);
+            if (bytes < 0 || sum != files[i].sum) {
+                fprintf(stderr, "thread %d: %s on volume %d %s\n", ts->index, files[i].path,
+                        files[i].volume, bytes < 0 ? "failed" : "differs");
+                ts->errors++;
+            } else {
+                ts->bytes += bytes;
+            }
+        }
+    }
+    free(buf);
+    return NULL;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "Usage: mtread [-t <threads>] [-n <rounds>] [-c <chunk>] [-m] <file/device>...\n"
+            "  -t  number of reader threads (default 4)\n"
+            "  -n  number of times each thread reads all files (default 1)\n"
+            "  -c  size of each read call (default 65536)\n"
+            "  -m  map the images instead of reading them with pread\n");
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    THREAD_STATE threads[MAX_THREADS];
+    int         opt, flags = 0, volume_count = 0, errors = 0, i;
+    size_t      n;
+    char        *buf;
+    fsw_s64     bytes;
+    fsw_u64     total = 0, thread_bytes = 0;
+    double      start, single, multi;
+
+    while ((opt = getopt(argc, argv, "t:n:c:m")) != -1) {
+        switch (opt) {
+            case 't':
+                thread_count = atoi(optarg);
+                break;
+            case 'n':
+                rounds = atoi(optarg);
+                break;
+            case 'c':
+                read_chunk = strtoul(optarg, NULL, 0);
+                break;
+            case 'm':
+                flags |= FSW_POSIX_MOUNT_MMAP;
+                break;
+            default:
+                usage();
+        }
+    }
+    if (optind >= argc || argc - optind > MAX_VOLUMES || thread_count < 1 || thread_count > MAX_THREADS ||
+        rounds < 1 || read_chunk == 0)
+        usage();
+
+    for (; optind < argc; optind++) {
+        volumes[volume_count] = fsw_posix_mount(argv[optind], NULL, flags);
+        if (volumes[volume_count] == NULL) {
+            fprintf(stderr, "Mounting %s failed.\n", argv[optind]);
+            return 1;
+        }
+        if (scan_dir(volume_count, "/"))
+            errors++;
+        volume_count++;
+    }
+    if (file_count == 0) {
+        fprintf(stderr, "No files found.\n");
+        return 1;
+    }
+
+    // reference pass on a single thread
+    buf = malloc(read_chunk);
+    if (buf == NULL) {
+        fprintf(stderr, "Out of memory.\n");
+        return 1;
+    }
+    start = now();
+    for (n = 0; n < file_count; n++) {
+        files[n].sum = checksum_file(volumes[files[n].volume], files[n].path, buf, &bytes);
+        if (bytes < 0) {
+            fprintf(stderr, "%s on volume %d failed\n", files[n].path, files[n].volume);
+            errors++;
+        } else {
+            total += bytes;
+        }
+    }
+    single = now() - start;
+    free(buf);
+
+    // the same files from all threads at once
+    start = now();
+    for (i = 0; i < thread_count; i++) {
+        memset(&threads[i], 0, sizeof(THREAD_STATE));
+        threads[i].index = i;
+        if (pthread_create(&threads[i].thread, NULL, reader, &threads[i]) != 0) {
+            fprintf(stderr, "Creating thread %d failed.\n", i);
+            return 1;
+        }
+    }
+    for (i = 0; i < thread_count; i++) {
+        pthread_join(threads[i].thread, NULL);
+        errors += threads[i].errors;
+        thread_bytes += threads[i].bytes;
+    }
+    multi = now() - start;
+
+    printf("%d volumes, %llu files, %llu bytes\n", volume_count, (unsigned long long)file_count,
+           (unsigned long long)total);
+    printf("1 thread:   %.3f s\n", single);
+    printf("%d threads: %.3f s for %d rounds each, %.1f MB/s total\n", thread_count, multi, rounds,
+           thread_bytes / multi / 1e6);
+    printf("%d errors\n", errors);
+
+    for (i = 0; i < volume_count; i++)
+        fsw_posix_unmount(volumes[i]);
+    for (n = 0; n < file_count; n++)
+        free(files[n].path);
+    free(files);
+
+    return errors ? 1 : 0;
+}
+
+// EOF